@@ -16,6 +16,29 @@ bool comparePair (pair<int,short> p1, pair<int, short> p2)
   return false;
 }
 
+//------------------------------------------------------------------------------
+// order rows read out of position order
+//------------------------------------------------------------------------------
+static void sortBed(vector<int> & p, vector<short> & l)
+{
+  pair <int,short>  q1;
+  list < pair <int,short> > q;
+  list < pair <int,short> >::iterator iq;
+  for (int i=0; i<int(p.size()); i++) {
+    q1.first=p[i];
+    q1.second=l[i];
+    q.push_back(q1);
+  }
+
+  q.sort(comparePair);
+
+  int i=0;
+  for (iq=q.begin(); iq!=q.end() ; iq++) {
+    p[i]=(*iq).first;
+    l[i]=(*iq).second;
+    i++;
+  }
+}
 
 //------------------------------------------------------------------------------
 // Bed class constructor 
@@ -97,24 +120,7 @@ C_BedChr::C_BedChr(string & fn, string &chr1)  { // load  bed record for chr
   bed.close();
  
   if (sort) {
-     
-     pair <int,short>  q1;
-     list < pair <int,short> > q;
-     list < pair <int,short> >::iterator iq;
-     for (int i=0; i<int(p.size()); i++) {
-       q1.first=p[i];
-       q1.second=l[i];
-       q.push_back(q1);
-     }
-  
-     q.sort(comparePair);
-     
-     int i=0;
-     for (iq=q.begin(); iq!=q.end() ; iq++) {
-       p[i]=(*iq).first;
-       l[i]=(*iq).second;
-       i++;
-     }
+     sortBed(p,l);
   }
   N=p.size();     
 }
@@ -134,3 +140,110 @@ C_BedChr& C_BedChr::operator=(const C_BedChr &rhs) {
 }
 
 
+//------------------------------------------------------------------------------
+// Bed registry: one pass over each file for all chromosomes
+//------------------------------------------------------------------------------
+static C_BedRegistry registry;
+
+C_BedRegistry & bedRegistry() {
+  return registry;
+}
+
+C_BedRegistry::C_BedRegistry() {
+  pthread_mutex_init(&lock, NULL);
+}
+
+C_BedRegistry::~C_BedRegistry() {
+  pthread_mutex_destroy(&lock);
+}
+
+const C_BedChr & C_BedRegistry::get(const string & fn, const string & chr1) {
+  pthread_mutex_lock(&lock);
+  if (files.find(fn)==files.end()) {
+    load(fn);
+  }
+  map<string, C_BedChr> & f = files[fn];
+  map<string, C_BedChr>::iterator ic = f.find(chr1);
+  const C_BedChr & b = (ic==f.end()? none: ic->second);
+  pthread_mutex_unlock(&lock);
+  return b;
+}
+
+void C_BedRegistry::load(const string & fn) {
+
+  map<string, C_BedChr> & f = files[fn];
+  if (fn.length()==0) {
+     return;
+  }
+
+  ifstream bed(fn.c_str(), ios::in);
+  
+  if (!bed) {
+    cerr << "Unable to open file: " << fn << endl;
+    exit(1);
+  }
+  
+  string header = "";
+  map<string, bool> sort;
+  // last chromosome seen: rows of one chromosome are usually contiguous
+  C_BedChr * b = NULL;
+  string line;
+  
+  while (getline(bed, line)) {
+
+    if (line.compare(0,3,"chr") != 0) {
+       header=header+"\n"+line;
+       continue;
+    }
+    
+    // first three whitespace separated fields
+    size_t t0[3], t1[3];
+    size_t k=0;
+    int nf=0;
+    while (nf<3) {
+      while ((k<line.size())&&isspace(line[k])) k++;
+      if (k>=line.size()) break;
+      t0[nf]=k;
+      while ((k<line.size())&&(!isspace(line[k]))) k++;
+      t1[nf]=k;
+      nf++;
+    }
+    
+    if (nf<3) {
+        cerr << fn << " too few fields:\n " << line << endl;
+        continue;
+    }
+
+    string c=line.substr(t0[0]+3, t1[0]-t0[0]-3);
+    if ((b==NULL)||(b->chr!=c)) {
+      b = &f[c];
+      if (b->chr!=c) {
+        b->chr=c;
+        b->filename=fn;
+        sort[c]=false;
+      }
+    }
+    int p1=  atoi(line.c_str()+t0[1]);
+    int p2=  atoi(line.c_str()+t0[2]);
+    int l1 = p2-p1;
+    if (b->p.size()>0) {
+      if (p1<b->p[b->p.size()-1]) { sort[c]=true;};
+    }
+    b->p.push_back(p1);
+    b->l.push_back(l1);
+    if (p1<b->plim[0]) { b->plim[0]=p1;};
+    if (p2>b->plim[1]) { b->plim[1]=p2;};
+  }
+  
+  bed.close();
+ 
+  map<string, C_BedChr>::iterator ic;
+  for (ic=f.begin(); ic!=f.end(); ic++) {
+    C_BedChr & b1 = ic->second;
+    if (sort[ic->first]) {
+      sortBed(b1.p,b1.l);
+    }
+    b1.header=header;
+    b1.N=b1.p.size();
+  }
+}
@@ -20,7 +20,9 @@
 #include <iterator>
 #include <sstream>
 #include <algorithm>
+#include <map>
 #include <limits.h>
+#include <pthread.h>
 
 
 using namespace std;
@@ -47,6 +49,26 @@ class C_BedChr {
     vector<short> l;
 };    
 
+//------------------------------------------------------------------------------
+// BED files parsed once for all contigs: each file is read and split into
+// per-chromosome C_BedChr (sorted like C_BedChr(file,chr) sorts) the first
+// time it is asked for, then served by reference. Entries are never removed,
+// so references stay valid. Loading is locked for concurrent contig threads
+//------------------------------------------------------------------------------
+class C_BedRegistry {
+  public:
+    C_BedRegistry();
+    ~C_BedRegistry();
+    const C_BedChr & get(const string &, const string &);  // file, chr (empty if no rows)
+  private:
+    void load(const string &);
+    map<string, map<string, C_BedChr> > files;
+    C_BedChr none;
+    pthread_mutex_t lock;
+};
+
+C_BedRegistry & bedRegistry();          // process-wide registry
+
 /*
 // structure for Bed File
 class C_BedFile {
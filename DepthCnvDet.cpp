@@ -358,6 +358,7 @@ C_UniqueCoverage::C_UniqueCoverage(C_contig & c1,  RunControlParameters & pars)
     // RDreference model
     string RDreferencefile=pars.getRDreferenceFile();
     a = c1.loadDepth(RDreferencefile) ;
+    a.inflate();
     light_t info;
     bool depthRef=a.pos1>a.pos0;
     if (depthRef) {
@@ -386,7 +387,7 @@ C_UniqueCoverage::C_UniqueCoverage(C_contig & c1,  RunControlParameters & pars)
     //-------------------------------------------------------------
     // if coverage is too low, rebin until r.nzMedian exceeds pars.RDminMedian
     //-------------------------------------------------------------
-    rebin(pars);
+    rebin(c1, pars);
     // fetch binzie from r readcount object
     info.i64=r.light;
     binsize=info.i16[0];
@@ -431,7 +432,7 @@ C_UniqueCoverage::C_UniqueCoverage(C_contig & c1,  RunControlParameters & pars)
 // Collapse bins until the median non-zero 
 // count of reads exceeds RDminMedian
 //-----------------------------------------------------------------------
-int C_UniqueCoverage::rebin(RunControlParameters & pars) {
+int C_UniqueCoverage::rebin(C_contig & c1, RunControlParameters & pars) {
   // minimum number of expected reads per bin
   int minExp=pars.getRDminMedian();
   // array of rebinning factors
@@ -459,18 +460,27 @@ int C_UniqueCoverage::rebin(RunControlParameters & pars) {
   a.n.resize(N);
   for (int b0 = 0; b0<N0; b0++) {
     int b1=int(floor((0.01+(float(b0)/W1) )));
-    a.n[b1]+=n0[b0];
+    if (b1<N) a.n[b1]+=n0[b0];
   }     
   a.calcStats();
 
-  // rebin r - read counts 
+  // rebin r - read counts (from the contig's read start pyramid if it has
+  // this bin size)
+  int binsize1=binsize*int(W1);
+  if (c1.pyramid.has(binsize1)) {
+    r = c1.pyramid.get(binsize1);
+    r.light=info.i64;
+    r.n.resize(N);
+    r.calcStats();
+    return int(W1);
+  }
   n0 = r.n;
   r.light=info.i64;
   r.n.clear();
   r.n.resize(N);
   for (int b0 = 0; b0<N0; b0++) {
     int b1=int(floor((0.01+(float(b0)/W1) )));
-    r.n[b1]+=n0[b0];
+    if (b1<N) r.n[b1]+=n0[b0];
   }     
   r.calcStats();
   return int(W1);
@@ -62,7 +62,7 @@ class C_UniqueCoverage {
     //int abintotal;
     int slope;
     void write(C_contig &, string &);
-    int rebin(RunControlParameters &);
+    int rebin(C_contig &, RunControlParameters &);
     int gc_correctionFactor();
 };
 
@@ -210,6 +210,72 @@ void HistObj::Fill1(int x1) {
     this->Fill1(double(x1));
 }
 
+//========================================================================
+// Fill1 of value x1, k times (same bin as Fill1)
+//========================================================================
+void HistObj::FillCount(double x1, double k) {
+    // initialize
+    if (this->Nbin < 1) {
+        cerr << "Histogram not initialized for FillCount" << endl;
+    }
+    this->Ntot += k;
+    int bin = int(floor((x1 - this->xlow) / this->dx));
+    if (bin < 0) {
+        this->Nunder += k;
+    } else if (bin >= this->Nbin) {
+        this->Nover += k;
+    } else {
+        this->Nin += k;
+        this->n[bin] += k;
+        this->sumx += k*x1;
+        this->sumxx += k*pow(x1, 2);
+    }
+}
+
+//========================================================================
+// integer valued arrays (depth of coverage) are counted per value first, 
+// so the bins are filled once per distinct value rather than per element 
+//========================================================================
+const int HISTARRAYRANGE = 1<<24;
+
+static bool countValues(const vector<float> & x, int & vmin, vector<long long> & cnt)
+{
+    size_t L = x.size();
+    vmin = 0;
+    cnt.clear();
+    if (L == 0) return true;
+    float lo = x[0];
+    float hi = x[0];
+    bool integral = true;
+    for (size_t i = 0; i<L; i++) {
+        float v = x[i];
+        lo = (v < lo ? v : lo);
+        hi = (v > hi ? v : hi);
+        integral = integral && (v == floorf(v));
+    }
+    if ((!integral) || (lo < -HISTARRAYRANGE) || (hi > HISTARRAYRANGE) || (hi - lo > HISTARRAYRANGE)) {
+        return false;
+    }
+    vmin = int(lo);
+    cnt.assign(int(hi) - vmin + 1, 0);
+    for (size_t i = 0; i<L; i++) {
+        cnt[int(x[i]) - vmin]++;
+    }
+    return true;
+}
+
+void HistObj::FillArray(const vector<float> & x) {
+    int vmin;
+    vector<long long> cnt;
+    if (!countValues(x, vmin, cnt)) {
+        for (size_t i = 0; i<x.size(); i++) this->Fill1(double(x[i]));
+        return;
+    }
+    for (int j = 0; j<int(cnt.size()); j++) {
+        if (cnt[j] > 0) this->FillCount(double(vmin + j), double(cnt[j]));
+    }
+}
+
 void HistObj::Fill1(short x1) {
     this->Fill1(double(x1));
 }
@@ -848,6 +914,32 @@ void StatObj::Fill1(int x1) {
 void StatObj::Fill1(short x1) {
     this->Fill1(double(x1));
 }
+// for arrays (see HistObj::FillArray)
+
+void StatObj::FillArray(const vector<float> & x) {
+    int vmin;
+    vector<long long> cnt;
+    if (!countValues(x, vmin, cnt)) {
+        for (size_t i = 0; i<x.size(); i++) this->Fill1(double(x[i]));
+        return;
+    }
+    this->FillCounts(vmin, cnt);
+}
+
+void StatObj::FillCounts(int vmin, const vector<long long> & cnt) {
+    long long sx = 0;
+    double sxx = 0;
+    for (int j = 0; j<int(cnt.size()); j++) {
+        if (cnt[j] == 0) continue;
+        long long v = vmin + j;
+        sx += cnt[j]*v;
+        sxx += double(cnt[j])*double(v*v);
+        this->h.FillCount(double(v), double(cnt[j]));
+        this->N += cnt[j];
+    }
+    this->sumx += double(sx);
+    this->sumxx += sxx;
+}
 //========================================================================
 // Finalize
 //========================================================================
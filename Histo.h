@@ -35,6 +35,8 @@ class HistObj {
     void Fill1(const double);  
     void Fill1(const int);  
     void Fill1(const short);  
+    void FillCount(const double, const double);  // Fill1 of value x, k times
+    void FillArray(const vector<float> &);       // Fill1 of each element 
     void setTitle(const string &);
     void setXlabel(const string &);
     void setBinLabels(vector<string> &);
@@ -106,6 +108,8 @@ class StatObj {
     void Fill1(const double);  
     void Fill1(const int);  
     void Fill1(const short);  
+    void FillArray(const vector<float> &);       // Fill1 of each element 
+    void FillCounts(int, const vector<long long> &);  // cnt[j] entries of value vmin+j
     void Finalize();  
     int N;
     double mean;
@@ -191,7 +191,7 @@ C_anchorinfo::C_anchorinfo(string & anchorfile) {              // constructor
   //string patternLine("(\\d+)\\.\\s+(\\S+)\\s+(\\d+)\\s*$");
 	string patternLine("^\\s*(\\d+)\\.\\s+(\\w+)\\s+(\\d+)\\s*$");
   source=anchorfile;
-  fstream file1;
+  C_spanInput file1;
   file1.open(anchorfile.c_str(), ios::in);	
   if (!file1) {
     cerr << "Unable to open anchor file: " << anchorfile << endl;
@@ -603,7 +603,7 @@ C_libraries::C_libraries()              // constructor
 //------------------------------------------------------------------------------
 C_libraries::C_libraries(string & infilename)      // load lib info 
 {
-  fstream input(infilename.c_str(), ios::in  | ios::binary);
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
   if (!input) {
       cerr << "Unable to open library.span file: " << infilename << endl;
   }
@@ -1628,12 +1628,8 @@ void C_depth::calcStats(int Nbin, float x1, float x2) {
   this->Stats.Initialize(Nbin,x1,x2);  
   this->Stats.h.setTitle("RD count of reads/base ");
   this->Stats.h.setXlabel("bases");
-  int L = n.size();
-  for (int p=0; p<L; p++) {
-    this->Stats.Fill1(this->n[p]);  
-  }
+  this->fillStats();  
   this->Stats.Finalize();     
-  L = this->Stats.h.Nbin;
   nzMedian=0;
   double cumu=0.0;
   nzbins=int(Stats.h.Ntot-Stats.h.Nunder-Stats.h.n[0]);
@@ -1646,6 +1642,63 @@ void C_depth::calcStats(int Nbin, float x1, float x2) {
   }
 }
 
+//-----------------------------------------------------------------------------
+// compact depth: integer counts held in 1, 2 or 4 bytes per base 
+//-----------------------------------------------------------------------------
+bool C_depth::compact() {
+  if (n.size()==0) return (packed.size()>0);
+  if (!packed.pack(n)) return false;
+  vector<float>().swap(n);
+  return true;
+}
+
+void C_depth::inflate() {
+  if ((n.size()>0)||(packed.size()==0)) return;
+  packed.unpack(n);
+  packed.clear();
+}
+
+// add the first L counts of d (prefix sums of d if sums) to the depth held,
+// packed directly from the integers. d is released 
+void C_depth::setCounts(vector<int> & d, int L, bool sums) {
+  int L0 = (size()<L? size(): L);
+  for (int p=0; p<L0; p++) {
+    int v = int(at(p));
+    d[p]+=v;
+    if (sums) d[p+1]-=v;
+  }
+  vector<float>().swap(n);
+  if (!packed.pack(d, L, sums)) {
+    packed.clear();
+    n.resize(L,0);
+    int s=0;
+    for (int p=0; p<L; p++) {
+      s = (sums? s+d[p]: d[p]);
+      n[p]=s;
+    }
+  }
+  vector<int>().swap(d);
+}
+
+float C_depth::at(int i) const {
+  return (n.size()>0? n[i]: packed.get(i));
+}
+
+int C_depth::size() const {
+  return (n.size()>0? int(n.size()): packed.size());
+}
+
+void C_depth::fillStats() {
+  vector<long long> cnt;
+  if (n.size()>0) {
+    Stats.FillArray(n);
+  } else if (packed.tally(cnt)) {
+    Stats.FillCounts(0, cnt);
+  } else {
+    for (int i=0; i<packed.size(); i++) Stats.Fill1(double(packed.get(i)));
+  }
+}
+
 
 ostream &operator<<(ostream &output, C_depth & d1)
 {
@@ -1661,6 +1714,119 @@ C_marker::C_marker(int L1) {                            // constructor
   x.resize(L1,false); //=x1;
 }
 
+//-----------------------------------------------------------------------------
+// sorted read start index
+//-----------------------------------------------------------------------------
+C_startIndex::C_startIndex() {
+  ok=false;
+}
+
+void C_startIndex::clear() {
+  vector<int>().swap(p);
+  ok=false;
+}
+
+void C_startIndex::build(const C_depth & d) {
+  p.clear();
+  size_t N=0;
+  int L=d.size();
+  for (int i=0; i<L; i++) {
+    if (d.at(i)>=1) N+=size_t(d.at(i));
+  }
+  p.reserve(N);
+  // starts in position order: no sort needed
+  for (int i=0; i<L; i++) {
+    int k=int(d.at(i));
+    for (int j=0; j<k; j++) p.push_back(d.pos0+i);
+  }
+  ok=true;
+}
+
+void C_startIndex::add(int p0) {
+  p.push_back(p0);
+}
+
+void C_startIndex::sort() {
+  std::sort(p.begin(),p.end());
+  ok=true;
+}
+
+long long C_startIndex::count(int p0, int p1) const {
+  if (p1<p0) return 0;
+  vector<int>::const_iterator a = lower_bound(p.begin(),p.end(),p0);
+  vector<int>::const_iterator b = upper_bound(a,p.end(),p1);
+  return (b-a);
+}
+
+long long C_startIndex::size() const {
+  return p.size();
+}
+
+//-----------------------------------------------------------------------------
+// multi-resolution read start counts
+//-----------------------------------------------------------------------------
+C_depthPyramid::C_depthPyramid() {
+  L=0;
+  sets=0;
+  ok=false;
+}
+
+void C_depthPyramid::clear() {
+  level.clear();
+  L=0;
+  ok=false;
+}
+
+void C_depthPyramid::init(int L1) {
+  L=L1;
+  level.resize(DPYRLEVELS);
+  for (int l=0; l<DPYRLEVELS; l++) {
+    C_depth d(1+L/DPYRBIN[l]);
+    level[l]=d;
+  }
+  ok=false;
+}
+
+void C_depthPyramid::add(int p0) {
+  if ((p0<0)||(p0>=L)) return;
+  level[0].n[p0/DPYRBIN[0]]+=1;
+}
+
+void C_depthPyramid::finish() {
+  for (int l=1; l<DPYRLEVELS; l++) {
+    int m = DPYRBIN[l]/DPYRBIN[l-1];
+    vector<float> & n0 = level[l-1].n;
+    vector<float> & n1 = level[l].n;
+    for (int b=0; b<int(n0.size()); b++) {
+      n1[b/m]+=n0[b];
+    }
+  }
+  ok=true;
+}
+
+bool C_depthPyramid::has(int binsize) const {
+  return ok&&(binsize>0)&&((binsize%DPYRBIN[0])==0);
+}
+
+// same layout (and header light) as C_contig::countReads(binsize)
+C_depth C_depthPyramid::get(int binsize) const {
+  int l=DPYRLEVELS-1;
+  while ((l>0)&&((binsize%DPYRBIN[l])!=0)) l--;
+  int m = binsize/DPYRBIN[l];
+  C_depth c(1+L/binsize);
+  light_t info;
+  info.i64=0;  
+  info.i16[0]=binsize;
+  info.i16[1]=0;  
+  c.light = info.i64;
+  const vector<float> & n0 = level[l].n;
+  for (int b=0; b<int(n0.size()); b++) {
+    c.n[b/m]+=n0[b];
+  }
+  c.calcStats();
+  return c;
+}
+
 //-----------------------------------------------------------------------------
 // add fasta file repeat annotations to marking vector x
 //-----------------------------------------------------------------------------
@@ -1923,37 +2089,47 @@ void C_contig::calcStats() {
      //-------------------------------------------------------------------------
      // Don't waste time making histogram of empty list...
      //-------------------------------------------------------------------------
-     unsigned int L = repeat.n.size();  
+     // repeat mask from repeat counts, or as loaded from .mask.span 
+     bool doRepeats = (repeat.Stats.N>0);
+     if (repeat.n.size()>0) {
+       repeatMask = C_mask(repeat.n);
+     } else if (repeat.size()>0) {
+       repeatMask = C_mask(repeat.size());
+       for (int i=0; i<repeat.size(); i++) {
+         if (repeat.at(i)>0) repeatMask.set(i);
+       }
+       repeatMask.index();
+     } else {
+       doRepeats = (repeatMask.size()>0);
+     }
+     int L = repeatMask.size();  
      if (repeat.Stats.N>0) {
        this->repeat.Stats.Initialize(101,-0.5,1000.5);  
        repeat.Stats.h.setTitle("NA count of bases with repeats");
        repeat.Stats.h.setXlabel("rpt");
-       for (unsigned int i=0; i<L; i++) {
-          this->repeat.Stats.Fill1(this->repeat.n[i]);  
-          // bump repeat base count
-          totalRepeatBases+=(repeat.n[i]>0);
-          // check for first base with a repeat
-          if ((totalNoCovBases<1.0)&&(repeat.n[i]>0)) {
-             totalNoCovBases=double(i)-1.0;
-          }
-       }
+       this->repeat.fillStats();  
        this->repeat.Stats.Finalize();    
+       // multiplicity counts kept in 1-4 bytes/base
+       this->repeat.compact();
      } else {
        this->repeat.Stats.Initialize(2,-0.5,1.5);  
        repeat.Stats.h.setTitle("NA count of bases with repeats");
        repeat.Stats.h.setXlabel("rpt");
        this->repeat.Stats.Finalize();    
      }
+     if (doRepeats) {
+       // repeat base count
+       totalRepeatBases=repeatMask.count();
+       // check for first base with a repeat
+       for (int i=repeatMask.next(0); (i>=0)&&(totalNoCovBases<1.0); i=repeatMask.next(i+1)) {
+          totalNoCovBases=double(i)-1.0;
+       }
+     }
      // check for last base with a repeat
      // --i should start at L-1, but it doesnt...
-     
      if (L>0) { 
-       for (unsigned int i=(L-1); i>0; --i) {
-          totalNoCovBases++;
-          if (repeat.n[i]>0) {
-            break;
-          }
-       }
+       int i = repeatMask.prev(L-1);
+       totalNoCovBases+= (i>0? L-i: L-1);
      } 
      
      this->pairStats.Initialize(10001,-0.5,10000.5);       
@@ -2026,11 +2202,41 @@ int C_contig::setLengthFromAnchor() {      // set contig Length from anchor[cont
 }
 
 
+//------------------------------------------------------------------------------
+// depth arrays are filled from difference arrays: +1 at the first base and 
+// -1 past the last base of each interval, then one prefix-sum pass
+//------------------------------------------------------------------------------
+// add interval [p0,p1) clipped to [0,L); false if it reached outside
+static inline bool addInterval(vector<int> & d, int p0, int p1, int L)
+{
+  bool within = ((p0>=0)&&(p1<=L));
+  if (p0<0) p0=0;
+  if (p1>L) p1=L;
+  if (p1>p0) {
+    d[p0]++;
+    d[p1]--;
+  }
+  return within;
+}
+
+// add prefix sums of d to depth n 
+static void addDepth(vector<float> & n, const vector<int> & d)
+{
+  int s=0;
+  int L=n.size();
+  for (int p=0; p<L; p++) {
+    s+=d[p];
+    n[p]+=s;
+  }
+}
+
 void C_contig::calcDepth(int Qmin) {
-  // initialize depth arrays (this can take a while)
-  read_depth.n.resize(Length,0);
-  read_start.n.resize(Length,0);
-  frag_depth.n.resize(Length,0);
+  startIndex.clear();
+  // integer counts, packed into the depth arrays once filled 
+  vector<int> rs(Length,0);
+  vector<int> dr(Length+1,0);
+  vector<int> df(Length+1,0);
+  int nout[5]={0,0,0,0,0};
   //
   // mapping quality minumum?  
   // int Qmin=pars.getQmin();
@@ -2038,7 +2244,6 @@ void C_contig::calcDepth(int Qmin) {
   int p0=0;
   int p1=0;
   // fill depth from local pairs
-  unsigned int N = localpairs.size();
   list<C_localpair>::iterator i;
   // loop over pairs
   for(i=localpairs.begin(); i != localpairs.end(); ++i) {
@@ -2059,14 +2264,8 @@ void C_contig::calcDepth(int Qmin) {
           p0 = (*i).pos+(*i).lm-(*i).len2;
           p1 = (*i).pos+(*i).lm;
       }
-      read_start.n[p0]+=1;
-      for (int p = p0; p<p1; p++) {
-        if ((p<0)|(p>Length)) { 
-          cerr << " bound problem in calcDepth pairs" << p << endl;
-        } else {
-          read_depth.n[p]+=1;
-        }
-      }
+      if ((p0>=0)&&(p0<Length)) rs[p0]+=1;
+      if (!addInterval(dr,p0,p1,Length)) nout[0]++;
     }
     // fragment depth
     int lm = (*i).lm;
@@ -2077,16 +2276,9 @@ void C_contig::calcDepth(int Qmin) {
       p1 = (*i).pos;
       p0 = p1+(*i).lm;
     }
-    for (int p = p0; p<p1; p++) {
-      if ((p<0)|(p>Length)) { 
-        cerr << " bound problem in calcDepth frag depth from pairs" << p << endl;
-      } else {
-        frag_depth.n[p]+=1;
-      }
-    }    
+    if (!addInterval(df,p0,p1,Length)) nout[1]++;
   }
   // fill depth from cross pairs (not so many...)
-  N = crosspairs.size();
   list<C_crosspair>::iterator i1;
   // loop over pairs
   for(i1=crosspairs.begin(); i1 != crosspairs.end(); ++i1) {
@@ -2094,64 +2286,45 @@ void C_contig::calcDepth(int Qmin) {
     if ((*i1).read[0].q<Qmin) {continue;} 
     p0 = (*i1).read[0].pos;
     p1 = p0+(*i1).read[0].len;
-    read_start.n[p0]+=1;
-    for (int p = p0; p<p1; p++) {
-      if ((p<0)|(p>Length)) { 
-        cerr << " bound problem in calcDepth cross" << p << endl;
-      } else {
-        read_depth.n[p]+=1;
-      }
-    }
+    if ((p0>=0)&&(p0<Length)) rs[p0]+=1;
+    if (!addInterval(dr,p0,p1,Length)) nout[2]++;
   }
   // fill depth from dangle starts 
-  N = dangle.size();
   list<C_singleEnd>::iterator i2; 
   for(i2=dangle.begin(); i2 != dangle.end(); ++i2) {
     //first end for read depth
     if ((*i2).q<Qmin) {continue;} 
     p0 = (*i2).pos;
     p1 = p0+(*i2).len;
-    read_start.n[p0]+=1;
-    for (int p = p0; p<p1; p++) {
-      if ((p<0)|(p>Length)) { 
-        cerr << " bound problem in calcDepth dangle" << p << endl;
-      } else {
-        read_depth.n[p]+=1;
-      }
-    }
+    if ((p0>=0)&&(p0<Length)) rs[p0]+=1;
+    if (!addInterval(dr,p0,p1,Length)) nout[3]++;
   }
   // fill depth from umpairs 
-  N = umpairs.size();
   list<C_umpair>::iterator i3;
   for(i3=umpairs.begin(); i3 != umpairs.end(); ++i3) {
     if ((*i3).read[0].q<Qmin) {continue;} 
     //first end for read depth
     p0 = (*i3).read[0].pos;
     p1 = p0+(*i3).read[0].len;
-    read_start.n[p0]+=1;
-    for (int p = p0; p<p1; p++) {
-      if ((p<0)|(p>Length)) { 
-        cerr << " bound problem in calcDepth umpairs " << p << endl;
-      } else {
-        read_depth.n[p]+=1;
-      }
-    }
+    if ((p0>=0)&&(p0<Length)) rs[p0]+=1;
+    if (!addInterval(dr,p0,p1,Length)) nout[4]++;
   }
   // fill depth from unique ends 
-  N = singleton.size();
   for(i2=singleton.begin(); i2 != singleton.end(); ++i2) {
     if ((*i2).q<Qmin) {continue;} 
     //first end for read depth
     p0 = (*i2).pos;
     p1 = p0+(*i2).len;
-    read_start.n[p0]+=1;
-    for (int p = p0; p<p1; p++) {
-      if ((p<0)|(p>Length)) { 
-        cerr << " bound problem in calcDepth singleton" << p << endl;
-      } else {
-        read_depth.n[p]+=1;
-      }
-    }
+    if ((p0>=0)&&(p0<Length)) rs[p0]+=1;
+    if (!addInterval(dr,p0,p1,Length)) nout[3]++;
+  }
+  read_start.setCounts(rs, Length, false);
+  read_depth.setCounts(dr, Length, true);
+  frag_depth.setCounts(df, Length, true);
+  if (nout[0]+nout[1]+nout[2]+nout[3]+nout[4]>0) {
+    cerr << " bound problem in calcDepth " << contigName << " (pairs, frag depth, cross,";
+    cerr << " ends, umpairs): " << nout[0] << " " << nout[1] << " " << nout[2];
+    cerr << " " << nout[3] << " " << nout[4] << endl;
   }
   this->read_depth.Stats.Initialize(5001,-0.5,5000.5);  
   read_depth.Stats.h.setTitle("RD count of reads/base ");
@@ -2162,20 +2335,25 @@ void C_contig::calcDepth(int Qmin) {
   this->frag_depth.Stats.Initialize(5001,-0.5,5000.5);  
   frag_depth.Stats.h.setTitle("FD count of fragments/base ");
   frag_depth.Stats.h.setXlabel("bases");
-  for (int p=0; p<Length; p++) {
-  //   if (this->repeat.n[i]==0) {
-        this->read_depth.Stats.Fill1(this->read_depth.n[p]);  
-        this->read_start.Stats.Fill1(this->read_start.n[p]);  
-        this->frag_depth.Stats.Fill1(this->frag_depth.n[p]);  
- //    }
-  }
+  this->read_depth.fillStats();  
+  this->read_start.fillStats();  
+  this->frag_depth.fillStats();  
   this->read_depth.Stats.Finalize();     
   this->read_start.Stats.Finalize();     
   this->frag_depth.Stats.Finalize();     
+  // packs any depth left as floats (negative counts)
+  read_depth.compact();
+  read_start.compact();
+  frag_depth.compact();
 }
 
+//------------------------------------------------------------------------------
+// depth in region [P0,P1]: arrays are indexed from P0, and only intervals 
+// entirely within the region are counted (boundlimit)
+//------------------------------------------------------------------------------
 void C_contig::calcDepth(int P0, int P1, int Qmin) {
-  // initialize depth arrays (this can take a while)
+  startIndex.clear();
+  // integer counts, packed into the depth arrays once filled 
   if (P1>=Length) P1=Length-1;
   int L = P1-P0;
   read_depth.pos0=P0;
@@ -2184,15 +2362,14 @@ void C_contig::calcDepth(int P0, int P1, int Qmin) {
   read_start.pos1=P1;
   frag_depth.pos0=P0;
   frag_depth.pos1=P1;
-  read_depth.n.resize(L,0);
-  read_start.n.resize(L,0);
-  frag_depth.n.resize(L,0);
+  vector<int> rs(L,0);
+  vector<int> dr(L+1,0);
+  vector<int> df(L+1,0);
   int pos0=P0;
   int pos1=P1;
   int p0=0;
   int p1=0;
   // fill depth from local pairs
-  unsigned int N = localpairs.size();
   list<C_localpair>::iterator i;
   // loop over pairs
   for(i=localpairs.begin(); i != localpairs.end(); ++i) {
@@ -2209,11 +2386,9 @@ void C_contig::calcDepth(int P0, int P1, int Qmin) {
           p0 = (*i).pos+(*i).lm-(*i).len2;
           p1 = (*i).pos+(*i).lm;
       }
-      if ((p0>=pos0)&&(p0<=pos1)) {read_start.n[p0-pos0]+=1;}
+      if ((p0>=pos0)&&(p0<pos1)) {rs[p0-pos0]+=1;}
       if (!boundlimit(p0,p1,pos0,pos1)) {continue;}
-      for (int p = p0; p<p1; p++) {
-          read_depth.n[p]+=1;
-      }
+      addInterval(dr,p0-pos0,p1-pos0,L);
     }
     // fragment depth
     int lm = (*i).lm;
@@ -2225,12 +2400,9 @@ void C_contig::calcDepth(int P0, int P1, int Qmin) {
       p0 = p1+(*i).lm;
     }
     if (!boundlimit(p0,p1,pos0,pos1)) {continue;}
-    for (int p = p0; p<p1; p++) {
-        frag_depth.n[p]+=1;
-    }    
+    addInterval(df,p0-pos0,p1-pos0,L);
   }
   // fill depth from cross pairs (not so many...)
-  N = crosspairs.size();
   list<C_crosspair>::iterator i1;
   // loop over pairs
   for(i1=crosspairs.begin(); i1 != crosspairs.end(); ++i1) {
@@ -2238,53 +2410,45 @@ void C_contig::calcDepth(int P0, int P1, int Qmin) {
     //first end for read depth
     p0 = (*i1).read[0].pos;
     p1 = p0+(*i1).read[0].len;
-    if ((p0>=pos0)&&(p0<=pos1)) {read_start.n[p0-pos0]+=1;}
+    if ((p0>=pos0)&&(p0<pos1)) {rs[p0-pos0]+=1;}
     if (!boundlimit(p0,p1,pos0,pos1)) {continue;}
-    for (int p = p0; p<p1; p++) {
-        read_depth.n[p]+=1;
-    }
+    addInterval(dr,p0-pos0,p1-pos0,L);
   }
   // fill depth from dangles 
-  N = dangle.size();
   list<C_singleEnd>::iterator i2; 
   for(i2=dangle.begin(); i2 != dangle.end(); ++i2) {
     if ((*i2).q<Qmin) {continue;} 
     //first end for read depth
     p0 = (*i2).pos;
     p1 = p0+(*i2).len;
-    if ((p0>=pos0)&&(p0<=pos1)) {read_start.n[p0-pos0]+=1;}
+    if ((p0>=pos0)&&(p0<pos1)) {rs[p0-pos0]+=1;}
     if (!boundlimit(p0,p1,pos0,pos1)) {continue;}
-    for (int p = p0; p<p1; p++) {
-        read_depth.n[p]+=1;
-    }
+    addInterval(dr,p0-pos0,p1-pos0,L);
   }
   // fill depth from unique ends 
-  N = umpairs.size();
   list<C_umpair>::iterator i3;
   for(i3=umpairs.begin(); i3 != umpairs.end(); ++i3) {
     if ((*i3).read[0].q<Qmin) {continue;} 
     //first end for read depth
     p0 = (*i3).read[0].pos;
     p1 = p0+(*i3).read[0].len;
-    if ((p0>=pos0)&&(p0<=pos1)) {read_start.n[p0-pos0]+=1;}
+    if ((p0>=pos0)&&(p0<pos1)) {rs[p0-pos0]+=1;}
     if (!boundlimit(p0,p1,pos0,pos1)) {continue;}
-    for (int p = p0; p<p1; p++) {
-        read_depth.n[p]+=1;
-    }
+    addInterval(dr,p0-pos0,p1-pos0,L);
   }
   // fill depth from unique ends 
-  N = singleton.size();
   for(i2=singleton.begin(); i2 != singleton.end(); ++i2) {
     if ((*i2).q<Qmin) {continue;} 
     //first end for read depth
     p0 = (*i2).pos;
     p1 = p0+(*i2).len;
-    if ((p0>=pos0)&&(p0<=pos1)) {read_start.n[p0-pos0]+=1;}
+    if ((p0>=pos0)&&(p0<pos1)) {rs[p0-pos0]+=1;}
     if (!boundlimit(p0,p1,pos0,pos1)) {continue;}
-    for (int p = p0; p<p1; p++) {
-        read_depth.n[p]+=1;
-    }
+    addInterval(dr,p0-pos0,p1-pos0,L);
   }
+  read_start.setCounts(rs, L, false);
+  read_depth.setCounts(dr, L, true);
+  frag_depth.setCounts(df, L, true);
   this->read_depth.Stats.Initialize(5001,-0.5,5000.5);  
   read_depth.Stats.h.setTitle("RD count of reads/base ");
   read_depth.Stats.h.setXlabel("bases");
@@ -2294,33 +2458,34 @@ void C_contig::calcDepth(int P0, int P1, int Qmin) {
   this->frag_depth.Stats.Initialize(5001,-0.5,5000.5);  
   frag_depth.Stats.h.setTitle("FD count of fragments/base ");
   frag_depth.Stats.h.setXlabel("bases");
-  for (int p=0; p<L; p++) {
- //    if (!this->repeat.x[i]) {
-        this->read_depth.Stats.Fill1(this->read_depth.n[p]);  
-        this->read_start.Stats.Fill1(this->read_start.n[p]);  
-        this->frag_depth.Stats.Fill1(this->frag_depth.n[p]);  
- //    }
-  }
+  this->read_depth.fillStats();  
+  this->read_start.fillStats();  
+  this->frag_depth.fillStats();  
   this->read_depth.Stats.Finalize();     
   this->read_start.Stats.Finalize();     
   this->frag_depth.Stats.Finalize();     
+  // packs any depth left as floats (negative counts)
+  read_depth.compact();
+  read_start.compact();
+  frag_depth.compact();
 }
 
 //------------------------------------------------------------------------------
 // Calculate UU Fragment coverage for this contig
 //------------------------------------------------------------------------------
 void C_contig::calcFragDepth(int lmLow, int lmHigh) {
-  // initialize depth arrays (this can take a while)
   calcFragDepth(0,Length,lmLow,lmHigh);
 }
 
 void C_contig::calcFragDepth(int P0, int P1, int lmLow, int lmHigh) {
-  // initialize depth arrays (this can take a while)
+  // initialize depth arrays 
   if (P1>=Length) P1=Length-1;
   int L = P1-P0;
+  frag_depth.inflate();
   frag_depth.n.resize(L,0);
   frag_depth.pos0=P0;
   frag_depth.pos1=P1;
+  vector<int> df(L+1,0);
   //int lmLow = int(pars.getFragmentLengthLo());
   //int lmHigh = int(pars.getFragmentLengthHi());    
   int pos0=P0;
@@ -2328,7 +2493,6 @@ void C_contig::calcFragDepth(int P0, int P1, int lmLow, int lmHigh) {
   int p0=0;
   int p1=0;
   // fill depth from local pairs
-  //unsigned int N = localpairs.size();
   list<C_localpair>::iterator i;
   // loop over pairs
   for(i=localpairs.begin(); i != localpairs.end(); ++i) {
@@ -2340,26 +2504,26 @@ void C_contig::calcFragDepth(int P0, int P1, int lmLow, int lmHigh) {
     p0 = (*i).pos+(*i).len1;
     p1 = p0+(*i).lm-(*i).len2;
     if (!boundlimit(p0,p1,pos0,pos1)) {continue;}
-    for (int p = p0; p<p1; p++) {
-        frag_depth.n[p]+=1;
-    }    
+    addInterval(df,p0-pos0,p1-pos0,L);
   }
+  addDepth(frag_depth.n, df);
   this->frag_depth.Stats.Initialize(5001,-0.5,5000.5);  
   frag_depth.Stats.h.setTitle("FD count of fragments/base ");
   frag_depth.Stats.h.setXlabel("bases");
-  for (int p=0; p<L; p++) {
-        this->frag_depth.Stats.Fill1(this->frag_depth.n[p]);  
-  }
+  this->frag_depth.fillStats();  
   this->frag_depth.Stats.Finalize();     
+  frag_depth.compact();
 }
 
 
 
 
 void C_contig::calcStarts(int Qmin) {
+  startIndex.clear();
   // check if read starts already done 
   if (read_start.Stats.N>0) return;
   // initialize depth arrays (this can take a while)
+  read_start.inflate();
   read_start.n.resize(Length,0);
   int p0=0;
   // fill depth from local pairs
@@ -2414,14 +2578,39 @@ void C_contig::calcStarts(int Qmin) {
   this->read_start.Stats.Initialize(5001,-0.5,5000.5);  
   read_start.Stats.h.setTitle("SD count of starts/base ");
   read_start.Stats.h.setXlabel("bases");
-  for (int p=0; p<Length; p++) {
-     //if (!this->repeat.x[i]) {
-        this->read_start.Stats.Fill1(this->read_start.n[p]);  
-     //} else {
-     //   this->read_start.Stats.Fill1(-1);  
-     //}
-  }
+  this->read_start.fillStats();  
   this->read_start.Stats.Finalize();     
+  read_start.compact();
+}
+
+//------------------------------------------------------------------------------
+// read start pyramid: same starts as countReads(binsize) at the DPYRBIN sizes
+//------------------------------------------------------------------------------
+void C_contig::calcPyramid() {
+  pyramid.clear();
+  pyramid.init(Length);
+  list<C_localpair>::iterator i;
+  for(i=localpairs.begin(); i != localpairs.end(); ++i) {
+    // skip an end if was found by constraint  
+    if (((*i).constrain&1)==0) pyramid.add((*i).pos);
+    if (((*i).constrain&2)==0) pyramid.add((*i).pos+(*i).lm-(*i).len2);
+  }
+  list<C_crosspair>::iterator i1;
+  for(i1=crosspairs.begin(); i1 != crosspairs.end(); ++i1) {
+    pyramid.add((*i1).read[0].pos);
+  }
+  list<C_singleEnd>::iterator i2; 
+  for(i2=dangle.begin(); i2 != dangle.end(); ++i2) {
+    pyramid.add((*i2).pos);
+  }
+  list<C_umpair>::iterator i3;
+  for(i3=umpairs.begin(); i3 != umpairs.end(); ++i3) {
+    pyramid.add((*i3).read[0].pos);
+  }
+  for(i2=singleton.begin(); i2 != singleton.end(); ++i2) {
+    pyramid.add((*i2).pos);
+  }
+  pyramid.finish();
 }
 
 C_depth  C_contig::countReads(int binsize) {
@@ -2430,6 +2619,9 @@ C_depth  C_contig::countReads(int binsize) {
     C_depth c0;
     return c0;
   }
+  // bin sizes on the pyramid are summed from its levels
+  if (!pyramid.ok) calcPyramid();
+  if (pyramid.has(binsize)) return pyramid.get(binsize);
   int nbin = 1+(Length/binsize);
   // initialize depth arrays (this can take a while)
   C_depth c(nbin);
@@ -2520,89 +2712,41 @@ unsigned short C_contig::getAnchorIndex() {
 }
 
 long long C_contig::countReads(int P0, int P1) {
-  // initialize depth arrays (this can take a while)
   if (P1>=Length) P1=Length-1;
   if (P0<0) P0=0;
-  int p0, p1;
-  long long Nread = 0;
-  // fill depth from local pairs
-  unsigned int N = localpairs.size();
-  list<C_localpair>::iterator i;
-  // 
-  cout << " countReads " << contigName << " " << P0 << " " << P1 << " " << N << endl; 
-  // loop over pairs
-  for(i=localpairs.begin(); i != localpairs.end(); ++i) {
-    //loop over ends for read depth
-    for (int e=0; e<2; e++) {
-      switch (e) {
-        case 0: 
-          p0 = (*i).pos;
-          p1 = p0+(*i).len1;
-          break;
-        case 1:
-          p0 = (*i).pos+(*i).lm-(*i).len2;
-          p1 = (*i).pos+(*i).lm;
-      }
-      if ((p0>=P0)&&(p0<=P1)) {
-       Nread+=1;
-      }
+  if (!readIndex.ok) {
+    // index start of each listed read once; later windows are binary searches
+    readIndex.clear();
+    list<C_localpair>::iterator i;
+    for(i=localpairs.begin(); i != localpairs.end(); ++i) {
+      readIndex.add((*i).pos);
+      readIndex.add((*i).pos+(*i).lm-(*i).len2);
     }
-  }
-  //
-  cout << " countReads pairs " << Nread << endl;
-    
-  // fill depth from cross pairs (not so many...)
-  N = crosspairs.size();
-  list<C_crosspair>::iterator i1;
-  // loop over pairs
-  for(i1=crosspairs.begin(); i1 != crosspairs.end(); ++i1) {
-    //first end for read depth
-    p0 = (*i1).read[0].pos;
-    p1 = p0+(*i1).read[0].len;
-    if ((p0>=P0)&&(p0<=P1)) {
-      Nread+=1;
-    } else if (p0>P1) {
-      break;
+    list<C_crosspair>::iterator i1;
+    for(i1=crosspairs.begin(); i1 != crosspairs.end(); ++i1) {
+      readIndex.add((*i1).read[0].pos);
     }
-  }
-  // fill depth from dangles
-  N = dangle.size();
-  list<C_singleEnd>::iterator i2; 
-  for(i2=dangle.begin(); i2 != dangle.end(); ++i2) {
-    //first end for read depth
-    p0 = (*i2).pos;
-    if ((p0>=P0)&&(p0<=P1)) {
-      Nread+=1;
-    } else if (p0>P1) {
-      break;
+    list<C_singleEnd>::iterator i2; 
+    for(i2=dangle.begin(); i2 != dangle.end(); ++i2) {
+      readIndex.add((*i2).pos);
     }
-  }
-  // fill depth from unique ends 
-  N = umpairs.size();
-  list<C_umpair>::iterator i3;
-  for(i3=umpairs.begin(); i3 != umpairs.end(); ++i3) {
-    //first end for read depth
-    p0 = (*i3).read[0].pos;
-    p1 = p0+(*i3).read[0].len;
-    if ((p0>=P0)&&(p0<=P1)) {
-      Nread+=1;
-    } else if (p0>P1) {
-      break;
+    list<C_umpair>::iterator i3;
+    for(i3=umpairs.begin(); i3 != umpairs.end(); ++i3) {
+      readIndex.add((*i3).read[0].pos);
     }
-  }
-  // fill depth from unique ends 
-  N = singleton.size();
-  for(i2=singleton.begin(); i2 != singleton.end(); ++i2) {
-    //first end for read depth
-    p0 = (*i2).pos;
-    p1 = p0+(*i2).len;
-    if ((p0>=P0)&&(p0<=P1)) {
-      Nread+=1;
-    } else if (p0>P1) {
-      break;
+    for(i2=singleton.begin(); i2 != singleton.end(); ++i2) {
+      readIndex.add((*i2).pos);
     }
+    readIndex.sort();
+  }
+  return readIndex.count(P0,P1);
+}
+
+long long C_contig::countStarts(int P0, int P1) {
+  if (!startIndex.ok) {
+    startIndex.build(read_start);
   }
-  return Nread;
+  return startIndex.count(P0,P1);
 }
 
 
@@ -2612,22 +2756,23 @@ int C_contig::howFar(int p0, int Nnu) {
   // with Nnu non-repeat bases
   //---------------------------------------------------------------------------
   if (p0<0) p0=0;
-  int inu = 0;
   int n;
-  if (repeat.n.size()<1)  {
+  if (repeatMask.size()<1)  {
      n=p0+Nnu;
      n = (n>=Length? Length-1: n);
      return n;
   }
-  // loop over repeats until reaching Nnu non-repeats
-  for(n=p0; n < (Length-1); n++) {
-      inu+=1-int(repeat.n[n]>0);
-      if (inu == Nnu) { break; }
+  if (p0>=(Length-1)) return p0;
+  if (Nnu<1) {
+     return ((Nnu==0)&&repeatMask.test(p0)? p0: Length-1);
   }
-  return n;
+  // Nnu-th non-repeat base at or after p0
+  n = repeatMask.select0(p0-repeatMask.rank(p0)+Nnu);
+  return ((n<0)||(n>(Length-1))? Length-1: n);
 }
 
 void C_contig::sort() {
+  readIndex.clear();
 
     // check if already done, bug out if done
     if (uniquified>0) return;
@@ -2642,6 +2787,7 @@ void C_contig::sort() {
 }
 
 void C_contig::uniquify() {
+  readIndex.clear();
 
     // check if already done, bug out if done
     if (uniquified>1) return;    
@@ -2650,10 +2796,12 @@ void C_contig::uniquify() {
     localpairs.unique(isRedundantPair);               
     int NU = localpairs.size();
     printf(" remove %d of %d (%5.2f%%) localpairs\n",N0-NU,N0,100.*double(N0-NU)/N0);               
+    if (NU<N0) pyramid.clear();
     N0 = crosspairs.size();               
     crosspairs.unique(isRedundantCross);               
     NU = crosspairs.size();               
     printf(" remove %d of %d (%5.2f%%) crosspairs\n",N0-NU,N0,100.*double(N0-NU)/N0);               
+    if (NU<N0) pyramid.clear();
     //-------------------------------------------------------------
     // single reads redundant? 
     // remove only for variable read length platforms (454 / Helicos)
@@ -2663,14 +2811,17 @@ void C_contig::uniquify() {
       dangle.unique(isRedundantRead);               
       NU = dangle.size();               
       printf(" remove %d of %d (%5.2f%%) dangles\n",N0-NU,N0,100.*double(N0-NU)/N0);               
+      if (NU<N0) pyramid.clear();
       N0 = singleton.size();               
       singleton.unique(isRedundantRead);               
       NU = singleton.size();               
       printf(" remove %d of %d (%5.2f%%) singletons\n",N0-NU,N0,100.*double(N0-NU)/N0);               
+      if (NU<N0) pyramid.clear();
       N0 = umpairs.size();               
       umpairs.unique(isRedundantMulti);               
       NU = umpairs.size();               
       printf(" remove %d of %d (%5.2f%%) U-M\n",N0-NU,N0,100.*double(N0-NU)/N0);               
+      if (NU<N0) pyramid.clear();
     }
     uniquified=2;
     
@@ -2715,49 +2866,43 @@ void C_contig::uniquifyBam() {
 // I/O function for contigset
 void C_contig::writePairs(string & outfilename) //const
 {
-  // format: optimized to loadFragments.m matlab script  
   // open output binary file. bomb if unable to open
-  fstream output(outfilename.c_str(), ios::out | ios::binary);
-  if (!output) {
-      cerr << "Unable to open file: " << outfilename << endl;
-      return;
-  }
+  C_spanBuffer output(outfilename, false);
+  if (!output.ok) return;
+  writePairs(output);
+  output.close();
+}
+
+// serialise local pairs into staging buffer 
+void C_contig::writePairs(C_spanBuffer & output)
+{
+  // format: optimized to loadFragments.m matlab script  
   C_headerSpan h;
   h.setName = setName;
   h.contigName = contigName;
   int t =0;
-  while(outfilename.find(h.spanext[t])==string::npos) t++;
+  while(output.filename.find(h.spanext[t])==string::npos) t++;
   h.typeName = h.spanext[t];
   h.reclen =   3*sizeof(int)+2*sizeof(short)+6*sizeof(char);
   h.N = this->localpairs.size();
-  h.write(output);
+  string hb = h.pack();
+  output.append(hb.data(), hb.size());
+  S_pairRecord r;
   list<C_localpair>::iterator i;
   for(i=localpairs.begin(); i != localpairs.end(); ++i) {
-    unsigned int pos = (*i).pos;  
-    int lm = (*i).lm;  
-    char o = (*i).orient;  
-    char q1 = (*i).q1;  
-    char q2 = (*i).q2;  
-    char mm1 = (*i).mm1;  
-    char mm2 = (*i).mm2;  
-    short len1 = (*i).len1;  
-    short len2 = (*i).len2;  
-    char constrain = (*i).constrain;  
-    unsigned int ReadGroupCode0 = (*i).ReadGroupCode;  
-    
-    output.write(reinterpret_cast<const char *>(&pos), sizeof(int));
-    output.write(reinterpret_cast<const char *>(&lm), sizeof(int));
-    output.write(reinterpret_cast<const char *>(&o), sizeof(char));
-    output.write(reinterpret_cast<const char *>(&len1), sizeof(short));
-    output.write(reinterpret_cast<const char *>(&len2), sizeof(short));
-    output.write(reinterpret_cast<const char *>(&q1), sizeof(char));    
-    output.write(reinterpret_cast<const char *>(&q2), sizeof(char));    
-    output.write(reinterpret_cast<const char *>(&mm1), sizeof(char));    
-    output.write(reinterpret_cast<const char *>(&mm2), sizeof(char));    
-    output.write(reinterpret_cast<const char *>(&constrain), sizeof(char));    
-    output.write(reinterpret_cast<const char *>(&ReadGroupCode0), sizeof(unsigned int));    
+    r.pos = (*i).pos;  
+    r.lm = (*i).lm;  
+    r.orient = (*i).orient;  
+    r.len1 = (*i).len1;  
+    r.len2 = (*i).len2;  
+    r.q1 = (*i).q1;  
+    r.q2 = (*i).q2;  
+    r.mm1 = (*i).mm1;  
+    r.mm2 = (*i).mm2;  
+    r.constrain = (*i).constrain;  
+    r.ReadGroupCode = (*i).ReadGroupCode;  
+    output.put(r);
   }
-  output.close();
 }
 
 // I/O function for contigset
@@ -2893,99 +3038,265 @@ void C_contig::printStats(string & outfilename) //const
 void C_contig::writeCross(string & outfilename) //const
 {
   // open output binary file. bomb if unable to open
+  C_spanBuffer output(outfilename, false);
+  if (!output.ok) return;
+  writeCross(output);
+  output.close();
+}
+
+// serialise cross pairs into staging buffer 
+void C_contig::writeCross(C_spanBuffer & output)
+{
+  C_headerSpan h;
+  h.typeName = "cross";
+  h.setName = setName;
+  h.contigName = contigName;
+  int t =0;
+  while(output.filename.find(h.spanext[t])==string::npos) t++;
+  h.typeName = h.spanext[t];
+  h.reclen =   2*(sizeof(int)+2*sizeof(short)+3*sizeof(char))+sizeof(int);
+  h.N = this->crosspairs.size();
+  string hb = h.pack();  // write version 
+  output.append(hb.data(), hb.size());
+  //
+  S_crossRecord r;
+  list<C_crosspair>::iterator i;
+  for(i=crosspairs.begin(); i != crosspairs.end(); ++i) {
+    for (int e=0; e<2; e++) {
+      r.read[e].pos = (*i).read[e].pos;
+      r.read[e].len = (*i).read[e].len;          // length of this read aligment 
+      r.read[e].anchor = (*i).read[e].anchor;    // anchor index  
+      r.read[e].sense = (*i).read[e].sense;      // sense
+      r.read[e].q = (*i).read[e].q;              // quality
+      r.read[e].mm = (*i).read[e].mm;            // mismatches
+    }
+    r.ReadGroupCode = (*i).ReadGroupCode;
+    output.put(r);
+  }
+}
+
+void C_contig::writeEnd(string & outfilename, list<C_singleEnd> &  reads) 
+{
+  // open output binary file. bomb if unable to open
+  C_spanBuffer output(outfilename, false);
+  if (!output.ok) return;
+  writeEnd(output, reads);
+  output.close();
+}
+
+// serialise single ends into staging buffer 
+void C_contig::writeEnd(C_spanBuffer & output, list<C_singleEnd> &  reads) 
+{
+  C_headerSpan h;
+  h.typeName = "End";
+  h.setName = setName;
+  h.contigName = contigName;
+  int t =0;
+  while(output.filename.find(h.spanext[t])==string::npos) t++;
+  h.typeName = h.spanext[t];
+  //
+  h.reclen = 2*sizeof(int)+2*sizeof(short)+3*sizeof(char);
+  h.N = reads.size();
+  string hb = h.pack();
+  output.append(hb.data(), hb.size());
+
+  S_endRecord r;
+  list<C_singleEnd>::iterator i;
+  for(i=reads.begin(); i != reads.end(); ++i) {
+    r.read.pos = (*i).pos;
+    r.read.len = (*i).len;                        // length of this read aligment 
+    r.read.anchor = (*i).anchor;                  // anchor index  
+    r.read.sense = (*i).sense;                    // sense  
+    r.read.q = (*i).q;                            // quality index  
+    r.read.mm = (*i).mm;                          // mismatch  
+    r.ReadGroupCode = (*i).ReadGroupCode;         // library  index  
+    output.put(r);
+  }
+}
+
+void C_contig::writeMulti(string & outfilename, list<C_umpair> &  um) 
+{
+  // open output binary file. bomb if unable to open
+  C_spanBuffer output(outfilename, false);
+  if (!output.ok) return;
+  writeMulti(output, um);
+  output.close();
+}
+
+// serialise U-M pairs into staging buffer 
+void C_contig::writeMulti(C_spanBuffer & output, list<C_umpair> &  um) 
+{
+  C_headerSpan h;
+  h.typeName = "Multi";
+  h.setName = setName;
+  h.contigName = contigName;
+  int Nt=h.spanext.size(),t;
+  for (t=0; t<Nt; t++) {
+    if (output.filename.find(h.spanext[t])!=string::npos) { break;}
+  }
+  if (t<Nt) { 
+    h.typeName = h.spanext[t];
+  } else {
+    h.typeName = "multi.span";
+  }  
+  // two reads + nmap
+  h.reclen =3*sizeof(int)+2*(sizeof(int)+2*sizeof(short)+3*sizeof(char));
+  h.N = um.size();
+  string hb = h.pack();
+  output.append(hb.data(), hb.size());
+  // loop
+  S_multiRecord r;
+  list<C_umpair>::iterator i;
+  for(i=um.begin(); i != um.end(); ++i) {
+    for (int e=0; e<2; e++) {
+      r.read[e].pos = (*i).read[e].pos;
+      r.read[e].len = (*i).read[e].len;          // length of this read aligment 
+      r.read[e].anchor = (*i).read[e].anchor;    // anchor index  
+      r.read[e].sense = (*i).read[e].sense;      // sense 
+      r.read[e].q = (*i).read[e].q;              // quality
+      r.read[e].mm = (*i).read[e].mm;            // mm  
+    }
+    r.nmap = (*i).nmap;                          //nmapped positions
+    r.elements = (*i).elements;                  //element bits
+    r.ReadGroupCode = (*i).ReadGroupCode;        //library index 
+    output.put(r);
+  }  
+}
+
+//------------------------------------------------------------------------------
+// block-indexed (v2) writers: same records as the flat writers, grouped into 
+// position-ordered compressed column blocks with a footer index (blockSpan.h).
+// key positions are delta coded, ReadGroupCode goes through the file dictionary
+// and the remaining columns are frame of reference bit-packed
+//------------------------------------------------------------------------------
+void C_contig::writePairsBlock(string & outfilename)
+{
+  fstream output(outfilename.c_str(), ios::out | ios::binary);
+  if (!output) {
+      cerr << "Unable to open file: " << outfilename << endl;
+      return;
+  }
+  C_headerSpan h;
+  h.V = SPANCODEDVERSION;
+  h.setName = setName;
+  h.contigName = contigName;
+  int t =0;
+  while(outfilename.find(h.spanext[t])==string::npos) t++;
+  h.typeName = h.spanext[t];
+  h.reclen =   3*sizeof(int)+2*sizeof(short)+6*sizeof(char);
+  h.light = SPANBLOCKSIZE;
+  h.N = this->localpairs.size();
+  h.write(output);
+  // columns: pos lm orient len1 len2 q1 q2 mm1 mm2 constrain ReadGroupCode
+  C_spanBlockWriter w(output,11,true);
+  w.cols.encode(0,SPANCODEDELTA);
+  w.cols.encode(10,SPANCODEDICT);
+  list<C_localpair>::iterator i;
+  for(i=localpairs.begin(); i != localpairs.end(); ++i) {
+    w.cols.put(0,(*i).pos);
+    w.cols.put(1,(*i).lm);
+    w.cols.put(2,(*i).orient);
+    w.cols.put(3,(*i).len1);
+    w.cols.put(4,(*i).len2);
+    w.cols.put(5,(*i).q1);
+    w.cols.put(6,(*i).q2);
+    w.cols.put(7,(*i).mm1);
+    w.cols.put(8,(*i).mm2);
+    w.cols.put(9,(*i).constrain);
+    w.cols.put(10,(*i).ReadGroupCode);
+    w.add((*i).pos);
+  }
+  w.finish();
+  output.close();
+}
+
+void C_contig::writeCrossBlock(string & outfilename)
+{
   fstream output(outfilename.c_str(), ios::out | ios::binary);
   if (!output) {
       cerr << "Unable to open Cross output file: " << outfilename << endl;
       return;
   }
   C_headerSpan h;
-  h.typeName = "cross";
+  h.V = SPANCODEDVERSION;
   h.setName = setName;
   h.contigName = contigName;
   int t =0;
   while(outfilename.find(h.spanext[t])==string::npos) t++;
   h.typeName = h.spanext[t];
   h.reclen =   2*(sizeof(int)+2*sizeof(short)+3*sizeof(char))+sizeof(int);
+  h.light = SPANBLOCKSIZE;
   h.N = this->crosspairs.size();
-  h.write(output);  // write version 
-  //
+  h.write(output);
+  // columns: 6 per read (pos len anchor sense q mm) + ReadGroupCode
+  C_spanBlockWriter w(output,13,true);
+  w.cols.encode(0,SPANCODEDELTA);
+  w.cols.encode(12,SPANCODEDICT);
   list<C_crosspair>::iterator i;
   for(i=crosspairs.begin(); i != crosspairs.end(); ++i) {
     for (int e=0; e<2; e++) {
-      unsigned int p0 = (*i).read[e].pos;
-      unsigned short l0 = (*i).read[e].len;          // length of this read aligment 
-      unsigned short a0 = (*i).read[e].anchor;    // anchor index  
-      char  s0 = (*i).read[e].sense;    // anchor index  
-      char  q0 = (*i).read[e].q;    // anchor index  
-      char  mm0 = (*i).read[e].mm;    // anchor index  
-      //position
-      output.write(reinterpret_cast<const char *>(&p0), sizeof(int));
-      //length
-      output.write(reinterpret_cast<const char *>(&l0), sizeof(short));
-      output.write(reinterpret_cast<const char *>(&a0), sizeof(short));
-      output.write(reinterpret_cast<const char *>(&s0), sizeof(char));
-      output.write(reinterpret_cast<const char *>(&q0), sizeof(char));
-      output.write(reinterpret_cast<const char *>(&mm0), sizeof(char));
+      w.cols.put(6*e,(*i).read[e].pos);
+      w.cols.put(6*e+1,(*i).read[e].len);
+      w.cols.put(6*e+2,(*i).read[e].anchor);
+      w.cols.put(6*e+3,(*i).read[e].sense);
+      w.cols.put(6*e+4,(*i).read[e].q);
+      char mm0 = (*i).read[e].mm;
+      w.cols.put(6*e+5,mm0);
     }
-    unsigned int ReadGroupCode0 = (*i).ReadGroupCode;
-    output.write(reinterpret_cast<const char *>(&ReadGroupCode0), sizeof(int));
-    
+    w.cols.put(12,(*i).ReadGroupCode);
+    w.add((*i).read[0].pos);
   }
+  w.finish();
   output.close();
 }
 
-void C_contig::writeEnd(string & outfilename, list<C_singleEnd> &  reads) 
-  {
-  // open output binary file. bomb if unable to open
+void C_contig::writeEndBlock(string & outfilename, list<C_singleEnd> &  reads) 
+{
   fstream output(outfilename.c_str(), ios::out | ios::binary);
   if (!output) {
       cerr << "Unable to open End output file: " << outfilename << endl;
       return;
   }
   C_headerSpan h;
-  h.typeName = "End";
+  h.V = SPANCODEDVERSION;
   h.setName = setName;
   h.contigName = contigName;
   int t =0;
   while(outfilename.find(h.spanext[t])==string::npos) t++;
   h.typeName = h.spanext[t];
-  //
   h.reclen = 2*sizeof(int)+2*sizeof(short)+3*sizeof(char);
+  h.light = SPANBLOCKSIZE;
   h.N = reads.size();
   h.write(output);
-
+  // columns: pos len anchor sense q mm ReadGroupCode
+  C_spanBlockWriter w(output,7,true);
+  w.cols.encode(0,SPANCODEDELTA);
+  w.cols.encode(6,SPANCODEDICT);
   list<C_singleEnd>::iterator i;
   for(i=reads.begin(); i != reads.end(); ++i) {
-    unsigned int p0 = (*i).pos;
-    unsigned short l0 = (*i).len;                 // length of this read aligment 
-    unsigned short a0 = (*i).anchor;              // anchor index  
-    char  s0 = (*i).sense;                        // sense  
-    char  q0 = (*i).q;                            // quality index  
-    char  mm0 = (*i).mm;                          // mismatch  
-    unsigned int ReadGroupCode0 = (*i).ReadGroupCode;    // library  index  
-    //position
-    output.write(reinterpret_cast<const char *>(&p0), sizeof(int));
-    //length
-    output.write(reinterpret_cast<const char *>(&l0), sizeof(short));
-    output.write(reinterpret_cast<const char *>(&a0), sizeof(short));
-    output.write(reinterpret_cast<const char *>(&s0), sizeof(char));
-    output.write(reinterpret_cast<const char *>(&q0), sizeof(char));
-    output.write(reinterpret_cast<const char *>(&mm0), sizeof(char));
-    output.write(reinterpret_cast<const char *>(&ReadGroupCode0), sizeof(int));
-  }
+    w.cols.put(0,(*i).pos);
+    w.cols.put(1,(*i).len);
+    w.cols.put(2,(*i).anchor);
+    w.cols.put(3,(*i).sense);
+    w.cols.put(4,(*i).q);
+    char mm0 = (*i).mm;
+    w.cols.put(5,mm0);
+    w.cols.put(6,(*i).ReadGroupCode);
+    w.add((*i).pos);
+  }
+  w.finish();
   output.close();
 }
 
-void C_contig::writeMulti(string & outfilename, list<C_umpair> &  um) 
-  {
-  // open output binary file. bomb if unable to open
+void C_contig::writeMultiBlock(string & outfilename, list<C_umpair> &  um) 
+{
   fstream output(outfilename.c_str(), ios::out | ios::binary);
   if (!output) {
       cerr << "Unable to open Retro output file: " << outfilename << endl;
       return;
   }
   C_headerSpan h;
-  h.typeName = "Multi";
+  h.V = SPANCODEDVERSION;
   h.setName = setName;
   h.contigName = contigName;
   int Nt=h.spanext.size(),t;
@@ -2997,36 +3308,31 @@ void C_contig::writeMulti(string & outfilename, list<C_umpair> &  um)
   } else {
     h.typeName = "multi.span";
   }  
-  // two reads + nmap
   h.reclen =3*sizeof(int)+2*(sizeof(int)+2*sizeof(short)+3*sizeof(char));
+  h.light = SPANBLOCKSIZE;
   h.N = um.size();
   h.write(output);
-  // loop
+  // columns: 6 per read (pos len anchor sense q mm) + nmap elements ReadGroupCode
+  C_spanBlockWriter w(output,15,true);
+  w.cols.encode(0,SPANCODEDELTA);
+  w.cols.encode(14,SPANCODEDICT);
   list<C_umpair>::iterator i;
   for(i=um.begin(); i != um.end(); ++i) {
     for (int e=0; e<2; e++) {
-      unsigned int p0 = (*i).read[e].pos;
-      unsigned short l0 = (*i).read[e].len;       // length of this read aligment 
-      unsigned short a0 = (*i).read[e].anchor;    // anchor index  
-      char  s0 = (*i).read[e].sense;              // sense 
-      char  q0 = (*i).read[e].q;                  // quality
-      char mm0 = (*i).read[e].mm;                 // mm  
-      //position
-      output.write(reinterpret_cast<const char *>(&p0), sizeof(int));
-      //length
-      output.write(reinterpret_cast<const char *>(&l0), sizeof(short));
-      output.write(reinterpret_cast<const char *>(&a0), sizeof(short));
-      output.write(reinterpret_cast<const char *>(&s0), sizeof(char));
-      output.write(reinterpret_cast<const char *>(&q0), sizeof(char));
-      output.write(reinterpret_cast<const char *>(&mm0), sizeof(char));
+      w.cols.put(6*e,(*i).read[e].pos);
+      w.cols.put(6*e+1,(*i).read[e].len);
+      w.cols.put(6*e+2,(*i).read[e].anchor);
+      w.cols.put(6*e+3,(*i).read[e].sense);
+      w.cols.put(6*e+4,(*i).read[e].q);
+      char mm0 = (*i).read[e].mm;
+      w.cols.put(6*e+5,mm0);
     }
-    int nmap= (*i).nmap;                          //nmapped positions
-    output.write(reinterpret_cast<const char *>(&nmap), sizeof(int));
-    int elements= (*i).elements;                  //nmapped positions
-    output.write(reinterpret_cast<const char *>(&elements), sizeof(int));
-    unsigned int ReadGroupCode= (*i).ReadGroupCode;   //library index 
-    output.write(reinterpret_cast<const char *>(&ReadGroupCode), sizeof(int));
-  }  
+    w.cols.put(12,(*i).nmap);
+    w.cols.put(13,(*i).elements);
+    w.cols.put(14,(*i).ReadGroupCode);
+    w.add((*i).read[0].pos);
+  }
+  w.finish();
   output.close();
 }
 
@@ -3079,6 +3385,192 @@ void C_contig::writeMarker(string & outfilename, C_marker & m1)
   output.close(); 
 }
 
+//------------------------------------------------------------------------------
+// compressed depth arrays: chunks of DPCOMPRESS entries are (de)compressed in 
+// parallel batches on a thread pool, and stored in chunk order as (p0,dp,nc,bytes)
+//------------------------------------------------------------------------------
+struct S_depthChunks {
+  const char * x;                  // array being written
+  char * y;                        // array being loaded
+  int w;                           // bytes per entry
+  bool real;                       // float entries (else unsigned integer)
+  vector<int> p0;                  // first entry of chunk in batch slot
+  vector<int> dp;                  // entries in chunk
+  vector<int> nc;                  // compressed bytes
+  vector< vector<char> > cbuf;     // compressed chunk buffers (reused per batch)
+  vector<long long> sum;           // sum of int(entries) per loaded chunk
+  vector<char> ok;
+};
+
+static void compressDepthChunk(void * a, int k)
+{
+  S_depthChunks * c = reinterpret_cast<S_depthChunks *>(a);
+  int nb = c->dp[k]*c->w;
+  if (int(c->cbuf[k].size())<(nb+nb/16+128)) c->cbuf[k].resize(nb+nb/16+128);
+  c->nc[k] = fastlz_compress(c->x+size_t(c->p0[k])*c->w, nb, &c->cbuf[k][0]);
+}
+
+static void decompressDepthChunk(void * a, int k)
+{
+  S_depthChunks * c = reinterpret_cast<S_depthChunks *>(a);
+  int nb = c->dp[k]*c->w;
+  char * y = c->y+size_t(c->p0[k])*c->w;
+  int nd = fastlz_decompress(&c->cbuf[k][0], c->nc[k], y, nb);
+  c->ok[k] = (nd==nb);
+  long long s=0;
+  if (c->real) {
+    const float * f = reinterpret_cast<const float *>(y);
+    for (int p=0; p<c->dp[k]; p++) s+=int(f[p]);
+  } else if (c->w==1) {
+    const unsigned char * u = reinterpret_cast<const unsigned char *>(y);
+    for (int p=0; p<c->dp[k]; p++) s+=u[p];
+  } else if (c->w==2) {
+    const unsigned short * u = reinterpret_cast<const unsigned short *>(y);
+    for (int p=0; p<c->dp[k]; p++) s+=u[p];
+  } else {
+    const unsigned int * u = reinterpret_cast<const unsigned int *>(y);
+    for (int p=0; p<c->dp[k]; p++) s+=u[p];
+  }
+  c->sum[k]=s;
+}
+
+static void writeDepthChunks(fstream & output, const char * x, int w, int L)
+{
+  int Nchunk=(L+DPCOMPRESS-1)/DPCOMPRESS;
+  if (Nchunk==0) return;
+  C_threadPool pool(0);
+  int Nslot = 2*pool.size();
+  if (Nslot>Nchunk) Nslot=Nchunk;
+  S_depthChunks c;
+  c.x = x;
+  c.y = NULL;
+  c.w = w;
+  c.real = false;
+  c.p0.resize(Nslot);
+  c.dp.resize(Nslot);
+  c.nc.resize(Nslot);
+  c.cbuf.resize(Nslot);
+  for (int k0=0; k0<Nchunk; k0+=Nslot) {
+    int nk = Nchunk-k0;
+    if (nk>Nslot) nk=Nslot;
+    for (int k=0; k<nk; k++) {
+      c.p0[k] = (k0+k)*DPCOMPRESS;
+      c.dp[k] = DPCOMPRESS;
+      if ((c.p0[k]+c.dp[k])>L) c.dp[k] = L-c.p0[k];
+    }
+    pool.run(nk, compressDepthChunk, &c);
+    for (int k=0; k<nk; k++) {
+      output.write(reinterpret_cast<const char *>(&c.p0[k]), sizeof(int));
+      output.write(reinterpret_cast<const char *>(&c.dp[k]), sizeof(int));
+      output.write(reinterpret_cast<const char *>(&c.nc[k]), sizeof(int));
+      output.write(reinterpret_cast<const char *>(&c.cbuf[k][0]), c.nc[k]);
+    }
+  }
+}
+
+static void writeDepthChunks(fstream & output, const vector<float> & n)
+{
+  if (n.size()==0) return;
+  writeDepthChunks(output, reinterpret_cast<const char *>(&n[0]), sizeof(float), n.size());
+}
+
+static bool loadDepthChunks(istream & input, char * y, int w, bool real, int L, long long & sum)
+{
+  sum=0;
+  if (L==0) return true;
+  C_threadPool pool(0);
+  int Nslot = 2*pool.size();
+  S_depthChunks c;
+  c.x = NULL;
+  c.y = y;
+  c.w = w;
+  c.real = real;
+  c.p0.resize(Nslot);
+  c.dp.resize(Nslot);
+  c.nc.resize(Nslot);
+  c.cbuf.resize(Nslot);
+  c.sum.resize(Nslot);
+  c.ok.resize(Nslot);
+  int p1=0;
+  while (p1<L) {
+    // read next batch of compressed chunks 
+    int nk=0;
+    while ((nk<Nslot)&&(p1<L)) {
+      input.read(reinterpret_cast < char * > (&c.p0[nk]), sizeof(int));
+      input.read(reinterpret_cast < char * > (&c.dp[nk]), sizeof(int));
+      input.read(reinterpret_cast < char * > (&c.nc[nk]), sizeof(int));
+      if ((!input)||(c.p0[nk]<0)||(c.dp[nk]<1)||((c.p0[nk]+c.dp[nk])>L)||(c.nc[nk]<1)) {
+        return false;
+      }
+      c.cbuf[nk].resize(c.nc[nk]);
+      input.read(reinterpret_cast < char * > (&c.cbuf[nk][0]), c.nc[nk]);
+      if (!input) return false;
+      p1 = c.p0[nk]+c.dp[nk];
+      nk++;
+    }
+    pool.run(nk, decompressDepthChunk, &c);
+    for (int k=0; k<nk; k++) {
+      if (!c.ok[k]) return false;
+      sum+=c.sum[k];
+    }
+  }
+  return true;
+}
+
+static bool loadDepthChunks(istream & input, C_depth & d1)
+{
+  int L=d1.n.size();
+  if (L==0) return true;
+  long long sum;
+  if (!loadDepthChunks(input, reinterpret_cast<char *>(&d1.n[0]), sizeof(float), true, L, sum)) {
+    return false;
+  }
+  d1.Stats.N+=int(sum);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// depth array after the header: compact depths are written as unsigned 
+// 1 or 2 byte counts (reclen) under SPANDEPTHVERSION, so that readers 
+// expecting float depth do not take them for floats; float otherwise (reclen 4)
+//------------------------------------------------------------------------------
+static void writeDepthData(fstream & output, C_headerSpan & h, C_depth & d1)
+{
+  const C_depthStore & s1 = d1.packed;
+  bool typed = (d1.n.size()==0)&&(s1.size()>0)&&(s1.max()<=65535);
+  if (!typed) {
+    h.reclen = sizeof(float);
+    h.N = d1.size();
+    h.write(output);
+    if (d1.n.size()>0) {
+      writeDepthChunks(output, d1.n);
+    } else {
+      vector<float> n1;
+      s1.unpack(n1);
+      writeDepthChunks(output, n1);
+    }
+    return;
+  }
+  h.V = SPANDEPTHVERSION;
+  h.N = s1.size();
+  if ((s1.width()==1)&&(!s1.overflow())) {
+    h.reclen = 1;
+    h.write(output);
+    writeDepthChunks(output, s1.data(), 1, s1.size());
+  } else if (s1.width()==2) {
+    h.reclen = 2;
+    h.write(output);
+    writeDepthChunks(output, s1.data(), 2, s1.size());
+  } else {
+    // uint8 with side table: widen to uint16 on disk
+    vector<unsigned short> u(s1.size());
+    for (int i=0; i<s1.size(); i++) u[i]=(unsigned short)(s1.get(i));
+    h.reclen = 2;
+    h.write(output);
+    writeDepthChunks(output, reinterpret_cast<const char *>(&u[0]), 2, s1.size());
+  }
+}
+
 // I/O function for depth of coverage
 void C_contig::writeDepth(string & outfilename, C_depth & d1) 
 {
@@ -3117,31 +3609,13 @@ void C_contig::writeDepth(string & outfilename, C_depth & d1)
 
   }
   //
-  h.reclen = sizeof(float);
-  h.N = d1.n.size();
-  h.write(output);
-  int L=d1.n.size();
   //old version < 206
   /*
-  for (int i=0; i<L; i++)	{
+  for (int i=0; i<int(d1.n.size()); i++)	{
     output.write(reinterpret_cast<const char *>(&d1.n[i]), sizeof(float));
   }
   */
-  int dp = DPCOMPRESS;
-  float ibuf[dp];
-  char  cbuf[dp*sizeof(float)];
-  for (int p0=0; p0<L; p0+=dp)	{
-    int dp1 = dp;
-    if ((p0+dp1)>L) dp1 = L-p0;
-    for (int p=0; p<dp1; p++) {
-      ibuf[p]=d1.n[p0+p];
-    }
-    int nc = fastlz_compress(ibuf,dp1*sizeof(float), cbuf);	
-    output.write(reinterpret_cast<const char *>(&p0), sizeof(int));
-    output.write(reinterpret_cast<const char *>(&dp1), sizeof(int));
-    output.write(reinterpret_cast<const char *>(&nc), sizeof(int));
-    output.write(reinterpret_cast<const char *>(cbuf), nc);
-  }
+  writeDepthData(output, h, d1);
   output.close(); 
 }
 
@@ -3179,31 +3653,13 @@ void C_contig::writeDepth(string & outfilename, C_depth & d1, int binsize, int t
     cerr << " unknown write depth file extension " << outfilename << endl; 
   }
   //
-  h.reclen = sizeof(float);
-  h.N = d1.n.size();
-  h.write(output);
-  int L=d1.n.size();
   //old version < 206
-  /*
-  for (int i=0; i<L; i++)	{
-    output.write(reinterpret_cast<const char *>(&d1.n[i]), sizeof(float));
-  }
-  */
-  int dp = DPCOMPRESS;
-  float ibuf[dp];
-  char  cbuf[dp*sizeof(float)];
-  for (int p0=0; p0<L; p0+=dp)	{
-    int dp1 = dp;
-    if ((p0+dp1)>L) dp1 = L-p0;
-    for (int p=0; p<dp1; p++) {
-      ibuf[p]=d1.n[p0+p];
-    }
-    int nc = fastlz_compress(ibuf,dp1*sizeof(float), cbuf);	
-    output.write(reinterpret_cast<const char *>(&p0), sizeof(int));
-    output.write(reinterpret_cast<const char *>(&dp1), sizeof(int));
-    output.write(reinterpret_cast<const char *>(&nc), sizeof(int));
-    output.write(reinterpret_cast<const char *>(cbuf), nc);
+  /*
+  for (int i=0; i<int(d1.n.size()); i++)	{
+    output.write(reinterpret_cast<const char *>(&d1.n[i]), sizeof(float));
   }
+  */
+  writeDepthData(output, h, d1);
   output.close(); 
 }
 
@@ -3213,14 +3669,17 @@ C_depth  C_contig::loadDepth(string & infilename)
 {
    C_depth x1;
   // open output binary file. bomb if unable to open
-  fstream input(infilename.c_str(), ios::in  | ios::binary);
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
   if (!input) {
       cerr << "Unable to open Depth input file: " << infilename << endl;
       return x1;
   }
   C_headerSpan  h(input); 
   int L=h.N;
-  C_depth d1(L);
+  // integer counts go straight into packed storage
+  bool typed = (h.V==SPANDEPTHVERSION)&&((h.reclen==1)||(h.reclen==2));
+  C_depth d1(typed? 0: L);
+  d1.pos1=L-1;
   d1.light=h.light;
   float  n1=0;
   d1.Stats.N=0;
@@ -3230,26 +3689,19 @@ C_depth  C_contig::loadDepth(string & infilename)
       d1.n[i]=n1;
       d1.Stats.N+=int(n1);
     }
+  } else if (typed) { // compressed integer counts
+    long long sum;
+    char * y = d1.packed.alloc(h.reclen, L);
+    if (!loadDepthChunks(input, y, h.reclen, false, L, sum)) {
+      cerr << "Unable to decompress Depth input file: " << infilename << endl;
+      return x1;
+    }
+    d1.packed.loaded();
+    d1.Stats.N=int(sum);
   } else { // compressed 
-    float ibuf[DPCOMPRESS];
-    char  cbuf[DPCOMPRESS*sizeof(float)];
-    int p1=0; 
-    int p0, dp, nc;
-    while (p1<L) {
-      input.read(reinterpret_cast < char * > (&p0), sizeof(p0));
-      input.read(reinterpret_cast < char * > (&dp), sizeof(dp));
-      input.read(reinterpret_cast < char * > (&nc), sizeof(nc));
-      input.read(reinterpret_cast < char * > (cbuf), nc);
-      int nd = fastlz_decompress(cbuf,nc, ibuf,int(dp*1.1*sizeof(float)));	
-      p1 = p0+dp;
-      if (nd!=(dp*int(sizeof(float)))) {
-        cerr << "Unable to decompress Depth input file: " << infilename << endl;
-        return x1;
-      }
-      for (int p=0; p<dp; p++) {
-        d1.n[p0+p]=ibuf[p];
-        d1.Stats.N+=int(d1.n[p0+p]);
-      }
+    if (!loadDepthChunks(input, d1)) {
+      cerr << "Unable to decompress Depth input file: " << infilename << endl;
+      return x1;
     }
   }
   input.close(); 
@@ -3260,7 +3712,7 @@ C_marker   C_contig::loadMarker(string & infilename)
 {
   C_marker x1;
   // open output binary file. bomb if unable to open
-  fstream input(infilename.c_str(), ios::in  | ios::binary);
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
   if (!input) {
       cerr << "Unable to open Marker input file: " << infilename << endl;
       return x1;
@@ -3303,30 +3755,370 @@ C_marker   C_contig::loadMarker(string & infilename)
 void  C_contig::loadRepeat(string & infilename) 
 {
   C_depth r1=loadDepth(infilename);
-  if (repeat.n.size()==0) {
+  if (repeat.size()==0) {
      repeat = r1;
   } else {
-     if (repeat.n.size()==r1.n.size()) {
-        for (int i=0; i<int(r1.n.size()); i++) {
-          repeat.n[i]+=r1.n[i];
+     if (repeat.size()==r1.size()) {
+        repeat.inflate();
+        for (int i=0; i<r1.size(); i++) {
+          repeat.n[i]+=r1.at(i);
         }
         // stats??
      } else { 
        cerr << " mixed length repeat.span " << endl;
-       cerr << infilename << "\t length " << r1.n.size() << endl;
-       cerr << "existing repeat length " << repeat.n.size() << endl;
+       cerr << infilename << "\t length " << r1.size() << endl;
+       cerr << "existing repeat length " << repeat.size() << endl;
        exit(-1);
     }
   }
 }
 
+//------------------------------------------------------------------------------
+// repeat mask file: header (light=mask length, N=number of runs) followed by
+// N run starts and N run lengths 
+//------------------------------------------------------------------------------
+void C_contig::writeMask(string & outfilename, C_mask & m1) 
+{
+  fstream output(outfilename.c_str(), ios::out | ios::binary);
+  if (!output) {
+      cerr << "Unable to open Mask output file: " << outfilename << endl;
+      return;
+  }
+  vector<int> s1, n1;
+  m1.runs(s1,n1);
+  C_headerSpan h;
+  h.setName = setName;
+  h.contigName = contigName;
+  h.typeName = ".mask.span";
+  h.light = m1.size();
+  h.reclen = 2*sizeof(int);
+  h.N = s1.size();
+  h.write(output);
+  if (s1.size()>0) {
+    output.write(reinterpret_cast<const char *>(&s1[0]), s1.size()*sizeof(int));
+    output.write(reinterpret_cast<const char *>(&n1[0]), n1.size()*sizeof(int));
+  }
+  output.close(); 
+}
+
+void  C_contig::loadMask(string & infilename) 
+{
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
+  if (!input) {
+      cerr << "Unable to open Mask input file: " << infilename << endl;
+      return;
+  }
+  C_headerSpan h(input);
+  vector<int> s1(h.N), n1(h.N);
+  if (h.N>0) {
+    input.read(reinterpret_cast < char * > (&s1[0]), h.N*sizeof(int));
+    input.read(reinterpret_cast < char * > (&n1[0]), h.N*sizeof(int));
+  }
+  if (!input) {
+      cerr << "Unable to read Mask input file: " << infilename << endl;
+      return;
+  }
+  repeatMask.fromRuns(int(h.light), s1, n1);
+  input.close();
+}
+
+//------------------------------------------------------------------------------
+// pyramid file: span header (light contig length, N levels) then per level 
+// int binsize, int nbin and the compressed counts as in writeDepth
+//------------------------------------------------------------------------------
+void C_contig::writePyramid(string & outfilename) 
+{
+  fstream output(outfilename.c_str(), ios::out | ios::binary);
+  if (!output) {
+      cerr << "Unable to open Pyramid output file: " << outfilename << endl;
+      return;
+  }
+  C_headerSpan h;
+  h.setName = setName;
+  h.contigName = contigName;
+  h.typeName = ".read.pyramid.span";
+  h.light = pyramid.L;
+  h.reclen = sizeof(float);
+  h.N = pyramid.level.size();
+  h.write(output);
+  for (int l=0; l<int(pyramid.level.size()); l++) {
+    int nbin = pyramid.level[l].n.size();
+    output.write(reinterpret_cast<const char *>(&DPYRBIN[l]), sizeof(int));
+    output.write(reinterpret_cast<const char *>(&nbin), sizeof(int));
+    writeDepthChunks(output, pyramid.level[l].n);
+  }
+  output.close(); 
+}
+
+// only the first set loaded into a contig: later sets rebuild from the lists
+void  C_contig::loadPyramid(string & infilename) 
+{
+  if (pyramid.sets>1) {
+    pyramid.clear();
+    return;
+  }
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
+  if (!input) {
+      cerr << "Unable to open Pyramid input file: " << infilename << endl;
+      return;
+  }
+  C_headerSpan h(input);
+  if ((h.N!=DPYRLEVELS)||(h.light!=Length)) {
+      cerr << "Pyramid input file doesn't match contig: " << infilename << endl;
+      return;
+  }
+  pyramid.init(Length);
+  for (int l=0; l<DPYRLEVELS; l++) {
+    int b, nbin;
+    input.read(reinterpret_cast < char * > (&b), sizeof(int));
+    input.read(reinterpret_cast < char * > (&nbin), sizeof(int));
+    if ((!input)||(b!=DPYRBIN[l])||(nbin!=int(pyramid.level[l].n.size()))||
+        (!loadDepthChunks(input, pyramid.level[l]))) {
+      cerr << "Unable to read Pyramid input file: " << infilename << endl;
+      pyramid.clear();
+      return;
+    }
+  }
+  pyramid.ok=true;
+  input.close();
+}
+
+//------------------------------------------------------------------------------
+// aberrant pair classes (see SPANCLS*): same selection as the clusterer made
+// from the full pair lists, without the Qmin cut 
+//------------------------------------------------------------------------------
+int aberrantPairClass(const C_localpair & p, C_libraries & libraries)
+{
+  if (p.orient=='>') return SPANCLSINVERT5;
+  if (p.orient=='<') return SPANCLSINVERT3;
+  if (p.orient!='-') return -2;
+  // library based selection (7/19/2009)
+  C_librarymap::const_iterator il = libraries.libmap.find(p.ReadGroupCode);
+  if (il==libraries.libmap.end()) return -3;
+  if (p.lm>il->second.LMhigh) return SPANCLSLONG;
+  if (p.lm<il->second.LMlow) return SPANCLSSHORT;
+  return -1;
+}
+
+int aberrantCrossClass(const C_crosspair & p)
+{
+  if (p.read[0].sense=='F') return SPANCLSCROSS5;
+  if (p.read[0].sense=='R') return SPANCLSCROSS3;
+  return -2;
+}
+
+// FNV-1a over the record count and the library fragment windows 
+long long aberrantKey(long long N, C_libraries * libraries)
+{
+  unsigned long long k = 14695981039346656037ULL;
+  vector<long long> x(1,N);
+  if (libraries!=0) {
+    C_librarymap::iterator i;
+    for(i=libraries->libmap.begin(); i != libraries->libmap.end(); ++i) {
+      x.push_back(i->first);
+      x.push_back(i->second.LMlow);
+      x.push_back(i->second.LMhigh);
+    }
+  }
+  for (int j=0; j<int(x.size()); j++) {
+    for (int b=0; b<64; b+=8) {
+      k ^= (x[j]>>b)&0xff;
+      k *= 1099511628211ULL;
+    }
+  }
+  return (long long)k;
+}
+
+C_aberrant::C_aberrant() {
+  clear();
+}
+
+void C_aberrant::clear() {
+  for (int c=0; c<4; c++) pairs[c].clear();
+  for (int c=0; c<2; c++) cross[c].clear();
+  pairKey=0;
+  crossKey=0;
+  pairSets=0;
+  crossSets=0;
+}
+
+bool C_aberrant::pairsValid(C_libraries & libraries, int N)
+{
+  return ((pairSets==1)&&(pairKey==aberrantKey(N, &libraries)));
+}
+
+bool C_aberrant::crossValid(int N)
+{
+  return ((crossSets==1)&&(crossKey==aberrantKey(N, 0)));
+}
+
+//------------------------------------------------------------------------------
+// class files: flat records of the pair/cross type in pair order
+//------------------------------------------------------------------------------
+void C_contig::writeAberrant(string & basename, C_libraries & libraries, vector<string> & files)
+{
+  C_headerSpan h;
+  vector<C_localpair> p[4];
+  vector<C_crosspair> x[2];
+  list<C_localpair>::iterator i;
+  for(i=localpairs.begin(); i != localpairs.end(); ++i) {
+    int c = aberrantPairClass(*i, libraries);
+    if (c>=0) p[c].push_back(*i);
+  }
+  list<C_crosspair>::iterator ix;
+  for(ix=crosspairs.begin(); ix != crosspairs.end(); ++ix) {
+    int c = aberrantCrossClass(*ix);
+    if (c>=0) x[c-SPANCLSCROSS5].push_back(*ix);
+  }
+  long long pkey = aberrantKey(localpairs.size(), &libraries);
+  long long xkey = aberrantKey(crosspairs.size(), 0);
+  for (int c=0; c<int(h.spanextp.size()); c++) {
+    bool cross = ((c==SPANCLSCROSS5)||(c==SPANCLSCROSS3));
+    if ((c>SPANCLSINVERT3)&&(!cross)) continue;
+    string fname = basename+h.spanextp[c];
+    C_spanBuffer output(fname, false);
+    if (!output.ok) return;
+    h.setName = setName;
+    h.contigName = contigName;
+    h.typeName = h.spanextp[c];
+    if (cross) {
+      vector<C_crosspair> & v = x[c-SPANCLSCROSS5];
+      h.reclen = sizeof(S_crossRecord);
+      h.light = xkey;
+      h.N = v.size();
+      string hb = h.pack();
+      output.append(hb.data(), hb.size());
+      S_crossRecord r;
+      for (int k=0; k<int(v.size()); k++) {
+        for (int e=0; e<2; e++) {
+          r.read[e].pos = v[k].read[e].pos;
+          r.read[e].len = v[k].read[e].len;
+          r.read[e].anchor = v[k].read[e].anchor;
+          r.read[e].sense = v[k].read[e].sense;
+          r.read[e].q = v[k].read[e].q;
+          r.read[e].mm = v[k].read[e].mm;
+        }
+        r.ReadGroupCode = v[k].ReadGroupCode;
+        output.put(r);
+      }
+    } else {
+      vector<C_localpair> & v = p[c];
+      h.reclen = sizeof(S_pairRecord);
+      h.light = pkey;
+      h.N = v.size();
+      string hb = h.pack();
+      output.append(hb.data(), hb.size());
+      S_pairRecord r;
+      for (int k=0; k<int(v.size()); k++) {
+        r.pos = v[k].pos;  
+        r.lm = v[k].lm;  
+        r.orient = v[k].orient;  
+        r.len1 = v[k].len1;  
+        r.len2 = v[k].len2;  
+        r.q1 = v[k].q1;  
+        r.q2 = v[k].q2;  
+        r.mm1 = v[k].mm1;  
+        r.mm2 = v[k].mm2;  
+        r.constrain = v[k].constrain;  
+        r.ReadGroupCode = v[k].ReadGroupCode;  
+        output.put(r);
+      }
+    }
+    output.close();
+    files.push_back(fname);
+    cout << "\t " << fname << "\t " << h.N << endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+// load class files of pairs and cross pairs if all present.
+// A second set loaded into the same contig (several lanes) leaves the
+// classes unusable, as the merged pair lists are re-uniquified 
+//------------------------------------------------------------------------------
+void C_contig::loadAberrant(string & stub)
+{
+  C_headerSpan h;
+  for (int g=0; g<2; g++) {
+    bool cross = (g==1);
+    int c0 = (cross? SPANCLSCROSS5: SPANCLSSHORT);
+    int c1 = (cross? SPANCLSCROSS3: SPANCLSINVERT3);
+    int & sets = (cross? aberrant.crossSets: aberrant.pairSets);
+    long long & key = (cross? aberrant.crossKey: aberrant.pairKey);
+    sets++;
+    bool ok = (sets==1);
+    for (int c=c0; ok&&(c<=c1); c++) {
+      string fname = stub+h.spanextp[c];
+      if (cross) {
+        C_spanRecords<S_crossRecord> r(fname);
+        ok = r.ok&&((c==c0)||(r.h.light==key));
+        if (!ok) break;
+        key = r.h.light;
+        for (const S_crossRecord * x=r.begin(); x!=r.end(); x++) {
+          C_crosspair p1;
+          for (int e=0; e<2; e++) {
+            p1.read[e].pos = x->read[e].pos;
+            p1.read[e].len = x->read[e].len;
+            p1.read[e].anchor = x->read[e].anchor;
+            p1.read[e].sense = x->read[e].sense;
+            p1.read[e].q = x->read[e].q;
+            p1.read[e].mm = x->read[e].mm;
+          }
+          p1.ReadGroupCode = x->ReadGroupCode;
+          aberrant.cross[c-c0].push_back(p1);
+        }
+      } else {
+        C_spanRecords<S_pairRecord> r(fname);
+        ok = r.ok&&((c==c0)||(r.h.light==key));
+        if (!ok) break;
+        key = r.h.light;
+        for (const S_pairRecord * x=r.begin(); x!=r.end(); x++) {
+          aberrant.pairs[c].push_back(C_localpair(x->pos,x->lm,0,x->len1,x->len2,
+            x->orient,x->q1,x->q2,x->mm1,x->mm2,x->constrain,x->ReadGroupCode));
+        }
+      }
+    }
+    if (!ok) {
+      // missing or mismatched class files: clusterer classifies the full lists
+      for (int c=c0; c<=c1; c++) {
+        if (cross) aberrant.cross[c-c0].clear(); 
+        else aberrant.pairs[c].clear();
+      }
+      key=0;
+      sets=2;
+    }
+  }
+}
+
 void  C_contig::loadPairs(string & infilename) 
 {
-  fstream input(infilename.c_str(), ios::in  | ios::binary);
+  readIndex.clear();
+  pyramid.clear();
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
   if (!input) {
       cerr << "Unable to open local pairs input file: " << infilename << endl;
   }
   C_headerSpan h(input);
+  if (h.blocked()) {
+    input.close();
+    loadPairs(infilename, 0, INT_MAX);
+    return;
+  }
+  // current version: records used in place from the mapped file
+  if ((h.V==SPANVERSION)&&(h.reclen==sizeof(S_pairRecord))) {
+    input.close();
+    C_spanRecords<S_pairRecord> r(infilename);
+    if (r.ok) {
+      contigName=h.contigName;
+      setName=h.setName;
+      for (const S_pairRecord * x=r.begin(); x!=r.end(); x++) {
+        this->localpairs.push_back(C_localpair(x->pos,x->lm,0,x->len1,x->len2,
+          x->orient,x->q1,x->q2,x->mm1,x->mm2,x->constrain,x->ReadGroupCode));
+      }
+      return;
+    }
+    input.open(infilename.c_str(), ios::in  | ios::binary);
+    h = C_headerSpan(input);
+  }
 
   int N= h.N;
   contigName=h.contigName;
@@ -3366,11 +4158,41 @@ void  C_contig::loadPairs(string & infilename)
 
 void  C_contig::loadCross(string & infilename) 
 {
-  fstream input(infilename.c_str(), ios::in  | ios::binary);
+  readIndex.clear();
+  pyramid.clear();
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
   if (!input) {
       cerr << "Unable to open Cross input file: " << infilename << endl;
   }
   C_headerSpan h(input);
+  if (h.blocked()) {
+    input.close();
+    loadCross(infilename, 0, INT_MAX);
+    return;
+  }
+  // current version: records used in place from the mapped file
+  if ((h.V==SPANVERSION)&&(h.reclen==sizeof(S_crossRecord))) {
+    input.close();
+    C_spanRecords<S_crossRecord> r(infilename);
+    if (r.ok) {
+      for (const S_crossRecord * x=r.begin(); x!=r.end(); x++) {
+        C_crosspair c1;
+        for (int e=0; e<2; e++) {
+          c1.read[e].pos = x->read[e].pos;
+          c1.read[e].len = x->read[e].len;
+          c1.read[e].anchor = x->read[e].anchor;
+          c1.read[e].sense = x->read[e].sense;
+          c1.read[e].q = x->read[e].q;
+          c1.read[e].mm = x->read[e].mm;
+        }
+        c1.ReadGroupCode = x->ReadGroupCode;
+        this->crosspairs.push_back(c1);
+      }
+      return;
+    }
+    input.open(infilename.c_str(), ios::in  | ios::binary);
+    h = C_headerSpan(input);
+  }
 
   int N = h.N;
   //
@@ -3407,12 +4229,16 @@ void  C_contig::loadCross(string & infilename)
 
 void  C_contig::loadMultipairs(string & infilename) 
 {
+  readIndex.clear();
+  pyramid.clear();
   list<C_umpair> x1 =loadMulti(infilename);
   umpairs.merge(x1);
 }
 
 void  C_contig::loadDangle(string & infilename) 
 {
+  readIndex.clear();
+  pyramid.clear();
   list<C_singleEnd> x1 =loadEnd(infilename);
   dangle.merge(x1);
 }
@@ -3420,6 +4246,8 @@ void  C_contig::loadDangle(string & infilename)
 
 void  C_contig::loadSingleton(string & infilename) 
 {
+  readIndex.clear();
+  pyramid.clear();
   list<C_singleEnd> x1 =loadEnd(infilename);
   singleton.merge(x1);
 }
@@ -3523,12 +4351,30 @@ bool C_contig::isRedundantCross(const C_crosspair &p1, const C_crosspair &p2)
 list<C_singleEnd>   C_contig::loadEnd(string &   infilename) 
 {
   list<C_singleEnd> x1;
-  fstream input(infilename.c_str(), ios::in|ios::binary);
+  C_spanInput input(infilename.c_str(), ios::in|ios::binary);
   if (!input) {
       cerr << "Unable to open read end input file: " << infilename << endl;
       return x1;
   }
   C_headerSpan h(input);
+  if (h.blocked()) {
+    input.close();
+    return loadEnd(infilename, 0, INT_MAX);
+  }
+  // current version: records used in place from the mapped file
+  if ((h.V==SPANVERSION)&&(h.reclen==sizeof(S_endRecord))) {
+    input.close();
+    C_spanRecords<S_endRecord> r(infilename);
+    if (r.ok) {
+      for (const S_endRecord * x=r.begin(); x!=r.end(); x++) {
+        x1.push_back(C_singleEnd(x->read.pos,x->read.anchor,x->read.len,
+          x->read.sense,x->read.q,x->read.mm,x->ReadGroupCode));
+      }
+      return x1;
+    }
+    input.open(infilename.c_str(), ios::in  | ios::binary);
+    h = C_headerSpan(input);
+  }
   int N = h.N;
   for(int i=0; i<N; i++)  {
     C_singleEnd r1;
@@ -3555,12 +4401,41 @@ list<C_singleEnd>   C_contig::loadEnd(string &   infilename)
 list<C_umpair>   C_contig::loadMulti(string &   infilename) 
 {
   list<C_umpair> x1;
-  fstream input(infilename.c_str(), ios::in|ios::binary);
+  C_spanInput input(infilename.c_str(), ios::in|ios::binary);
   if (!input) {
       cerr << "Unable to open read retro input file: " << infilename << endl;
       return x1;
   }
   C_headerSpan h(input);
+  if (h.blocked()) {
+    input.close();
+    return loadMulti(infilename, 0, INT_MAX);
+  }
+  // current version: records used in place from the mapped file
+  if ((h.V==SPANVERSION)&&(h.reclen==sizeof(S_multiRecord))) {
+    input.close();
+    C_spanRecords<S_multiRecord> r(infilename);
+    if (r.ok) {
+      for (const S_multiRecord * x=r.begin(); x!=r.end(); x++) {
+        C_umpair c1;
+        for (int e=0; e<2; e++) {
+          c1.read[e].pos = x->read[e].pos;
+          c1.read[e].len = x->read[e].len;
+          c1.read[e].anchor = x->read[e].anchor;
+          c1.read[e].sense = x->read[e].sense;
+          c1.read[e].q = x->read[e].q;
+          c1.read[e].mm = x->read[e].mm;
+        }
+        c1.nmap = x->nmap;
+        c1.elements = x->elements;
+        c1.ReadGroupCode = x->ReadGroupCode;
+        x1.push_back(c1);
+      }
+      return x1;
+    }
+    input.open(infilename.c_str(), ios::in  | ios::binary);
+    h = C_headerSpan(input);
+  }
   int reclen0 =sizeof(int)+2*(sizeof(int)+2*sizeof(short)+2*sizeof(char));
   //int reclen1 =reclen0+sizeof(int);
   int N = h.N;
@@ -3605,6 +4480,225 @@ list<C_umpair>   C_contig::loadMulti(string &   infilename)
   return x1;
 }        
     
+//------------------------------------------------------------------------------
+// region loaders: records with key position in [start,end]
+// block-indexed (v2) files decode only the overlapping blocks, 
+// flat files are read whole and filtered 
+//------------------------------------------------------------------------------
+void  C_contig::loadPairs(string & infilename, int start, int end) 
+{
+  readIndex.clear();
+  pyramid.clear();
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
+  if (!input) {
+      cerr << "Unable to open local pairs input file: " << infilename << endl;
+      return;
+  }
+  C_headerSpan h(input);
+  contigName=h.contigName;
+  setName=h.setName;
+  if (!h.blocked()) {
+    input.close();
+    C_contig c1;
+    c1.loadPairs(infilename);
+    list<C_localpair>::iterator i;
+    for(i=c1.localpairs.begin(); i != c1.localpairs.end(); ++i) {
+      if ((int((*i).pos)>=start)&&(int((*i).pos)<=end)) {
+        this->localpairs.push_back(*i);
+      }
+    }
+    return;
+  }
+  C_spanBlockReader r(input, h.coded());
+  if (!r.ok) {
+      cerr << "Unable to read block index: " << infilename << endl;
+      return;
+  }
+  C_spanColumns c(11);
+  vector<int> ib = r.index.overlap(start,end);
+  for (int k=0; k<int(ib.size()); k++) {
+    if (!r.readBlock(ib[k],c)) {
+      cerr << "bad block " << ib[k] << " in " << infilename << endl;
+      break;
+    }
+    int nr = r.index.block[ib[k]].count;
+    for(int j=0; j<nr; j++)  {
+      C_localpair p1;
+      p1.pos = c.get<unsigned int>(0,j);
+      if ((int(p1.pos)<start)||(int(p1.pos)>end)) continue;
+      p1.lm = c.get<int>(1,j);
+      p1.orient = c.get<char>(2,j);
+      p1.len1 = c.get<unsigned short>(3,j);
+      p1.len2 = c.get<unsigned short>(4,j);
+      p1.q1 = c.get<char>(5,j);
+      p1.q2 = c.get<char>(6,j);
+      p1.mm1 = c.get<char>(7,j);
+      p1.mm2 = c.get<char>(8,j);
+      p1.constrain = c.get<char>(9,j);
+      p1.ReadGroupCode = c.get<unsigned int>(10,j);
+      this->localpairs.push_back(p1);
+    }
+  }
+  input.close();
+}
+
+void  C_contig::loadCross(string & infilename, int start, int end) 
+{
+  readIndex.clear();
+  pyramid.clear();
+  C_spanInput input(infilename.c_str(), ios::in  | ios::binary);
+  if (!input) {
+      cerr << "Unable to open Cross input file: " << infilename << endl;
+      return;
+  }
+  C_headerSpan h(input);
+  if (!h.blocked()) {
+    input.close();
+    C_contig c1;
+    c1.loadCross(infilename);
+    list<C_crosspair>::iterator i;
+    for(i=c1.crosspairs.begin(); i != c1.crosspairs.end(); ++i) {
+      if ((int((*i).read[0].pos)>=start)&&(int((*i).read[0].pos)<=end)) {
+        this->crosspairs.push_back(*i);
+      }
+    }
+    return;
+  }
+  C_spanBlockReader r(input, h.coded());
+  if (!r.ok) {
+      cerr << "Unable to read block index: " << infilename << endl;
+      return;
+  }
+  C_spanColumns c(13);
+  vector<int> ib = r.index.overlap(start,end);
+  for (int k=0; k<int(ib.size()); k++) {
+    if (!r.readBlock(ib[k],c)) {
+      cerr << "bad block " << ib[k] << " in " << infilename << endl;
+      break;
+    }
+    int nr = r.index.block[ib[k]].count;
+    for(int j=0; j<nr; j++)  {
+      C_crosspair c1;
+      for (int e=0; e<2; e++) {
+        c1.read[e].pos = c.get<unsigned int>(6*e,j);
+        c1.read[e].len = c.get<unsigned short>(6*e+1,j);
+        c1.read[e].anchor = c.get<unsigned short>(6*e+2,j);
+        c1.read[e].sense = c.get<char>(6*e+3,j);
+        c1.read[e].q = c.get<char>(6*e+4,j);
+        c1.read[e].mm = c.get<char>(6*e+5,j);
+      }
+      if ((int(c1.read[0].pos)<start)||(int(c1.read[0].pos)>end)) continue;
+      c1.ReadGroupCode = c.get<unsigned int>(12,j);
+      this->crosspairs.push_back(c1);
+    }
+  }
+  input.close();
+}
+
+list<C_singleEnd>   C_contig::loadEnd(string &   infilename, int start, int end) 
+{
+  list<C_singleEnd> x1;
+  C_spanInput input(infilename.c_str(), ios::in|ios::binary);
+  if (!input) {
+      cerr << "Unable to open read end input file: " << infilename << endl;
+      return x1;
+  }
+  C_headerSpan h(input);
+  if (!h.blocked()) {
+    input.close();
+    list<C_singleEnd> x0 = loadEnd(infilename);
+    list<C_singleEnd>::iterator i;
+    for(i=x0.begin(); i != x0.end(); ++i) {
+      if ((int((*i).pos)>=start)&&(int((*i).pos)<=end)) {
+        x1.push_back(*i);
+      }
+    }
+    return x1;
+  }
+  C_spanBlockReader r(input, h.coded());
+  if (!r.ok) {
+      cerr << "Unable to read block index: " << infilename << endl;
+      return x1;
+  }
+  C_spanColumns c(7);
+  vector<int> ib = r.index.overlap(start,end);
+  for (int k=0; k<int(ib.size()); k++) {
+    if (!r.readBlock(ib[k],c)) {
+      cerr << "bad block " << ib[k] << " in " << infilename << endl;
+      break;
+    }
+    int nr = r.index.block[ib[k]].count;
+    for(int j=0; j<nr; j++)  {
+      C_singleEnd r1;
+      r1.pos = c.get<unsigned int>(0,j);
+      if ((int(r1.pos)<start)||(int(r1.pos)>end)) continue;
+      r1.len = c.get<unsigned short>(1,j);
+      r1.anchor = c.get<unsigned short>(2,j);
+      r1.sense = c.get<char>(3,j);
+      r1.q = c.get<char>(4,j);
+      r1.mm = c.get<char>(5,j);
+      r1.ReadGroupCode = c.get<unsigned int>(6,j);
+      x1.push_back(r1);
+    }
+  }
+  input.close();
+  return x1;
+}        
+
+list<C_umpair>   C_contig::loadMulti(string &   infilename, int start, int end) 
+{
+  list<C_umpair> x1;
+  C_spanInput input(infilename.c_str(), ios::in|ios::binary);
+  if (!input) {
+      cerr << "Unable to open read retro input file: " << infilename << endl;
+      return x1;
+  }
+  C_headerSpan h(input);
+  if (!h.blocked()) {
+    input.close();
+    list<C_umpair> x0 = loadMulti(infilename);
+    list<C_umpair>::iterator i;
+    for(i=x0.begin(); i != x0.end(); ++i) {
+      if ((int((*i).read[0].pos)>=start)&&(int((*i).read[0].pos)<=end)) {
+        x1.push_back(*i);
+      }
+    }
+    return x1;
+  }
+  C_spanBlockReader r(input, h.coded());
+  if (!r.ok) {
+      cerr << "Unable to read block index: " << infilename << endl;
+      return x1;
+  }
+  C_spanColumns c(15);
+  vector<int> ib = r.index.overlap(start,end);
+  for (int k=0; k<int(ib.size()); k++) {
+    if (!r.readBlock(ib[k],c)) {
+      cerr << "bad block " << ib[k] << " in " << infilename << endl;
+      break;
+    }
+    int nr = r.index.block[ib[k]].count;
+    for(int j=0; j<nr; j++)  {
+      C_umpair c1;
+      for (int e=0; e<2; e++) {
+        c1.read[e].pos = c.get<unsigned int>(6*e,j);
+        c1.read[e].len = c.get<unsigned short>(6*e+1,j);
+        c1.read[e].anchor = c.get<unsigned short>(6*e+2,j);
+        c1.read[e].sense = c.get<char>(6*e+3,j);
+        c1.read[e].q = c.get<char>(6*e+4,j);
+        c1.read[e].mm = c.get<char>(6*e+5,j);
+      }
+      if ((int(c1.read[0].pos)<start)||(int(c1.read[0].pos)>end)) continue;
+      c1.nmap = c.get<int>(12,j);
+      c1.elements = c.get<int>(13,j);
+      c1.ReadGroupCode = c.get<unsigned int>(14,j);
+      x1.push_back(c1);
+    }
+  }
+  input.close();
+  return x1;
+}        
+
 C_set::C_set(string & setName1, RunControlParameters & pars1) {
   setSetName(setName1);  
   this->fileName = "";
@@ -4029,6 +5123,15 @@ void C_set::write() {
   cout << "\t " << fname << "\t " << libraries.libmap.size() << endl;
   libraries.writeLibraryInfo(fname,setName);
   
+  // span files of this set (optionally packed into one container at the end)
+  vector<string> spanfiles;
+  spanfiles.push_back(anchorfile);
+  spanfiles.push_back(fname);
+
+  // flat span files are serialised here and written out by a background 
+  // thread while the next contig is serialised
+  C_spanWriterThread writer;
+  
   for (iterContig = contig.begin();	iterContig != contig.end(); iterContig++) {
       string cn1 = iterContig->first;      
       string basename = area+prefix+sn1+cn1;
@@ -4043,23 +5146,87 @@ void C_set::write() {
   
       if (contig[cn1].Length>0) { 
         //cout << "write output for contig " << cn1 << endl;
+        // span format 2: block-indexed records
+        bool blocked = (pars.getSpanFormat()>1);
+        C_spanBuffer * b1;
         fname = basename+".pair.span";
+        spanfiles.push_back(fname);
         cout << "\t " << fname << "\t " << contig[cn1].localpairs.size() << endl;
-        contig[cn1].writePairs(fname);
+        if (blocked) {
+          contig[cn1].writePairsBlock(fname);
+        } else {
+          b1 = new C_spanBuffer(fname, true);
+          contig[cn1].writePairs(*b1);
+          writer.push(b1);
+        }
         fname = basename+".cross.span";
+        spanfiles.push_back(fname);
         cout << "\t " << fname << "\t " << contig[cn1].crosspairs.size() << endl;
-        contig[cn1].writeCross(fname);
+        if (blocked) {
+          contig[cn1].writeCrossBlock(fname);
+        } else {
+          b1 = new C_spanBuffer(fname, true);
+          contig[cn1].writeCross(*b1);
+          writer.push(b1);
+        }
         fname = basename+".repeat.span";
-        cout << "\t " << fname << "\t " << contig[cn1].repeat.n.size() << endl;
+        spanfiles.push_back(fname);
+        cout << "\t " << fname << "\t " << contig[cn1].repeat.size() << endl;
         contig[cn1].writeDepth(fname, contig[cn1].repeat);
+        if (contig[cn1].repeat.size()>0) {
+          fname = basename+".mask.span";
+          spanfiles.push_back(fname);
+          C_depth & r1 = contig[cn1].repeat;
+          C_mask m1(r1.n);
+          if (r1.n.size()==0) {
+            // compact repeat counts (calcStats made the mask from them)
+            m1 = contig[cn1].repeatMask;
+          }
+          cout << "\t " << fname << "\t " << m1.count() << endl;
+          contig[cn1].writeMask(fname, m1);
+        }
+        fname = basename+".read.pyramid.span";
+        spanfiles.push_back(fname);
+        if (!contig[cn1].pyramid.ok) contig[cn1].calcPyramid();
+        cout << "\t " << fname << "\t " << contig[cn1].pyramid.level[0].n.size() << endl;
+        contig[cn1].writePyramid(fname);
         fname = basename+".dangle.span";
+        spanfiles.push_back(fname);
         cout << "\t " << fname << "\t " << contig[cn1].dangle.size() << endl;
-        contig[cn1].writeEnd(fname, contig[cn1].dangle);
+        if (blocked) {
+          contig[cn1].writeEndBlock(fname, contig[cn1].dangle);
+        } else {
+          b1 = new C_spanBuffer(fname, true);
+          contig[cn1].writeEnd(*b1, contig[cn1].dangle);
+          writer.push(b1);
+        }
         fname = basename+".multi.span";
+        spanfiles.push_back(fname);
         cout << "\t " << fname << "\t " << contig[cn1].umpairs.size() << endl;
-        contig[cn1].writeMulti(fname, contig[cn1].umpairs);
+        if (blocked) {
+          contig[cn1].writeMultiBlock(fname, contig[cn1].umpairs);
+        } else {
+          b1 = new C_spanBuffer(fname, true);
+          contig[cn1].writeMulti(*b1, contig[cn1].umpairs);
+          writer.push(b1);
+        }
+        // aberrant pair classes for the clusterer 
+        contig[cn1].writeAberrant(basename, libraries, spanfiles);
       }
    }
+   writer.finish();
+   //---------------------------------------------------------------------------
+   // single-file container: one open and one index read per set at load time 
+   //---------------------------------------------------------------------------
+   if (pars.getSpanPack()>0) {
+     fname = area+prefix+sn1+"span.pack";
+     cout << "\t " << fname << "\t " << spanfiles.size() << endl;
+     if (C_spanPack::write(fname, spanfiles)) {
+       for (int i=0; i<int(spanfiles.size()); i++) {
+         remove(spanfiles[i].c_str());
+       }
+     }
+   }
 }
 
 void C_set::printOut() {
@@ -4155,15 +5322,15 @@ void C_set::writeDepth() {
       if (contig[cn1].Length>0) { 
         cout << "write output for read depth " << cn1 << endl;
         string fname = basename+".read.depth.span";
-        cout << "\t " << fname << "\t " << contig[cn1].read_depth.n.size() << endl;
+        cout << "\t " << fname << "\t " << contig[cn1].read_depth.size() << endl;
         contig[cn1].writeDepth(fname, contig[cn1].read_depth);
         cout << "write output for read start " << cn1 << endl;
         fname = basename+".read.start.span";
-        cout << "\t " << fname << "\t " << contig[cn1].read_start.n.size() << endl;
+        cout << "\t " << fname << "\t " << contig[cn1].read_start.size() << endl;
         contig[cn1].writeDepth(fname, contig[cn1].read_start);
         cout << "write output for frag depth " << cn1 << endl;
         fname = basename+".frag.depth.span";
-        cout << "\t " << fname << "\t " << contig[cn1].frag_depth.n.size() << endl;
+        cout << "\t " << fname << "\t " << contig[cn1].frag_depth.size() << endl;
         contig[cn1].writeDepth(fname, contig[cn1].frag_depth);
        }
   }
@@ -4790,7 +5957,7 @@ void C_pairedfiles::inputcheck( string & in1, RunControlParameters & pars)
             string filename = i->first;
             h1 = i->second;
             //cout  << filename << " \t " << h1 << endl;
-            ok = ok && ((h1.V>=201)|(h1.V<=207));
+            ok = ok && ((h1.V>=201)&&(h1.V<=SPANCODEDVERSION));
          }
          if (ok) { 
             // if all Spanner files are ok, then put the setName into vector as element 0
@@ -4944,6 +6111,10 @@ void C_pairedfiles::loadSpanner( string  & file1,  RunControlParameters & pars)
           break;
       }
   }
+  //---------------------------------------------------------------------------
+  // pre-partitioned aberrant pairs written at build time (if present)
+  //---------------------------------------------------------------------------
+  set[0].contig[contigname].loadAberrant(file1);
   //---------------------------------------------------------------------------
    set[0].contig[contigname].setLengthFromAnchor(); 
   //---------------------------------------------------------------------------
@@ -4960,8 +6131,28 @@ void C_pairedfiles::loadSpanner( string  & file1,  RunControlParameters & pars)
   string ReferenceFastaFilefile = pars.getReferenceFastaFile(); 
 
   if ( (ReferenceFastaFilefile.size()>0) and (pars.getDoMasking()) ) {
+    set[0].contig[contigname].repeat.inflate();
     set[0].contig[contigname].repeat.addMarks(ReferenceFastaFilefile, contigname,'N'); 
   }
+  //---------------------------------------------------------------------------
+  // optional run-length repeat mask 
+  //---------------------------------------------------------------------------
+  string maskfile = file1+".mask.span";
+  C_spanInput maskin(maskfile.c_str(), ios::in | ios::binary);
+  if (maskin) {
+    maskin.close();
+    set[0].contig[contigname].loadMask(maskfile);
+  }
+  //---------------------------------------------------------------------------
+  // binned read starts written at build time (if present)
+  //---------------------------------------------------------------------------
+  string pyramidfile = file1+".read.pyramid.span";
+  C_spanInput pyrin(pyramidfile.c_str(), ios::in | ios::binary);
+  set[0].contig[contigname].pyramid.sets++;
+  if (pyrin) {
+    pyrin.close();
+    set[0].contig[contigname].loadPyramid(pyramidfile);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -9859,6 +11050,17 @@ bool C_pairedfiles::checkSpannerFiles(string & fs1) {
   vector<string> ff;
   //C_libraries libs;
   int nf = selectfiles(ff,fs1);
+  // members of span containers next to the input prefix 
+  openSpanPacks(extractpath(fs1));
+  vector<string> fp;
+  spanPackFiles(fp, extractpath(fs1));
+  string name = extractfilename(fs1);
+  for (int i=0; i<int(fp.size()); i++) {
+    if (fp[i].substr(fp[i].find_last_of("/")+1).find(name)!=string::npos) {
+      ff.push_back(fp[i]);
+    }
+  }
+  nf = ff.size();
   if (nf<7) return false;
   //----------------------------------------------------------------------------
   // load anchor info  
@@ -9918,7 +11120,7 @@ bool C_pairedfiles::checkSpannerFiles(string & fs1) {
   int Nspanx = int(h1.spanext.size());
   for (int i=0; i<Nspanx; i++) {
      string f1 = fs1+h1.spanext[i];
-     fstream input(f1.c_str(), ios::in|ios::binary);
+     C_spanInput input(f1.c_str(), ios::in|ios::binary);
      if (!input) {
         cerr << "Unable to open input file: " << f1 << endl;
         headers.clear();
@@ -9938,6 +11140,7 @@ bool C_pairedfiles::checkSpannerDirectory(string & fs1) {
   // check all files in directory for *.pair.span
   // ---------------------------------------------------------------------------
   string patternReadSpan("(.+)\\.pair\\.span$");
+  string patternSpanPack("(.*)span\\.pack$");
   string match;
   string f;
   DIR  *d;
@@ -9953,10 +11156,25 @@ bool C_pairedfiles::checkSpannerDirectory(string & fs1) {
          f = match;
          printf("%s\n", f.c_str());
          SpannerFileNames.push_back(f);
+      } else if (RE2::FullMatch(filename.c_str(),patternSpanPack.c_str(),&match)) {      
+         // single-file span container: members are read from the container
+         openSpanPack(fs1+"/"+filename);
       }
     }
     closedir(d);
   }
+  // *.pair.span members of span containers in this directory 
+  vector<string> fp;
+  spanPackFiles(fp, fs1);
+  for (int i=0; i<int(fp.size()); i++) {
+    string filename = fp[i].substr(fp[i].find_last_of("/")+1);
+    if (RE2::FullMatch(filename.c_str(),patternReadSpan.c_str(),&match)) {      
+       f = match;
+       if (find(SpannerFileNames.begin(),SpannerFileNames.end(),f)!=SpannerFileNames.end()) continue;
+       printf("%s\n", f.c_str());
+       SpannerFileNames.push_back(f);
+    }
+  }
   return (SpannerFileNames.size()>0);  
 }
 
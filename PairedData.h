@@ -19,6 +19,7 @@
 #include <map>
 #include <iterator>
 #include <list>
+#include <algorithm>
 #include <math.h>
 #include <dirent.h> 
 #include <stdio.h> 
@@ -35,6 +36,12 @@
 #include "Function-Sequence.h"
 #include "MosaikAlignment.h"
 #include "headerSpan.h"
+#include "blockSpan.h"
+#include "mapSpan.h"
+#include "writeSpan.h"
+#include "maskSpan.h"
+#include "depthSpan.h"
+#include "threadPool.h"
 #include "api/BamMultiReader.h"
 #include "SHA1.h"
 
@@ -291,6 +298,7 @@ class C_depth {
     int pos1;
     long long light;
     vector<float> n;        // depth of coverage
+    C_depthStore packed;    // integer copy of n while compact (n then empty)
     int nzbins;
     double nzMedian;    
     StatObj Stats;          // summary stats for depth
@@ -300,6 +308,12 @@ class C_depth {
     int GCcontent(const string &,const string &); 
     void calcStats();              // default stat calculator
     void calcStats(int,float,float);     // specify bins
+    bool compact();                // move n into packed integer storage
+    void inflate();                // back to n
+    void setCounts(vector<int> &, int, bool);  // add counts (or prefix sums), frees them
+    float at(int) const;           // depth at index (n or packed)
+    int size() const;
+    void fillStats();              // Stats.Fill1 of every entry
  
 };
 
@@ -317,10 +331,87 @@ class C_marker {
     int addMarks(const string &,const string &, char); 
 };
 
+//------------------------------------------------------------------------------
+// sorted read start positions of a contig. Built once, then the number of 
+// starts in any [p0,p1] is two binary searches instead of a pass over the 
+// pair lists or the per-base start depth
+//------------------------------------------------------------------------------
+class C_startIndex {
+  public:
+    C_startIndex();
+    void clear();
+    void build(const C_depth &);             // int(n[i]) starts at pos0+i
+    void add(int);                           // unsorted start, then sort()
+    void sort();
+    long long count(int, int) const;         // starts in [p0,p1]
+    long long size() const;
+    bool ok;                                 // built for the current data
+  private:
+    vector<int> p;
+};
+
+//------------------------------------------------------------------------------
+// read start counts of a contig at 100bp, 1kb, 10kb and 100kb, filled in one
+// pass over the reads. Any bin size that is a multiple of a level is summed
+// from that level without per-base data. Written as *.read.pyramid.span
+//------------------------------------------------------------------------------
+const int DPYRLEVELS=4;
+const int DPYRBIN[DPYRLEVELS]={100,1000,10000,100000};
+
+class C_depthPyramid {
+  public:
+    C_depthPyramid();
+    void clear();                            // drop counts (sets unchanged)
+    void init(int);                          // contig length
+    void add(int);                           // one read start
+    void finish();                           // sum coarse levels from finest
+    bool has(int) const;                     // bin size served by a level
+    C_depth get(int) const;                  // counts per bin size
+    vector<C_depth> level;
+    int L;                                   // contig length
+    int sets;                                // pyramid files loaded (usable if one)
+    bool ok;
+};
+
 
 // pair map type
 typedef std::map<string, C_headerSpan, std::less<string> >  C_headers;
 
+//------------------------------------------------------------------------------
+// aberrant pair classes (index into C_headerSpan::spanextp) written at build 
+// time as separate "*.class.span" files in pair order. Each class file keeps
+// all qualities; Qmin is applied when the clusterer takes them. The header 
+// light is a key of the source record count (and the library fragment 
+// windows for local pairs) so stale classes are never used
+//------------------------------------------------------------------------------
+const int SPANCLSSHORT=0;
+const int SPANCLSLONG=1;
+const int SPANCLSINVERT5=2;
+const int SPANCLSINVERT3=3;
+const int SPANCLSCROSS5=6;
+const int SPANCLSCROSS3=7;
+// class of a local pair: SPANCLS* , -1 normal, -2 bad orientation, 
+// -3 ReadGroupCode not in libraries
+int aberrantPairClass(const C_localpair &, C_libraries &);
+// class of a cross pair: SPANCLSCROSS5/3, -2 bad orientation
+int aberrantCrossClass(const C_crosspair &);
+// key of the class files for N source records (libraries==0 for cross pairs) 
+long long aberrantKey(long long, C_libraries *);
+
+class C_aberrant {
+  public:
+    C_aberrant();
+    void clear();
+    bool pairsValid(C_libraries &, int);         // loaded from one set for these pairs 
+    bool crossValid(int);
+    vector<C_localpair> pairs[4];                // short, long, invert5, invert3 
+    vector<C_crosspair> cross[2];                // cross5, cross3 
+    long long pairKey;                           // header light of loaded class files
+    long long crossKey;
+    int pairSets;                                // class file sets seen (usable if one)
+    int crossSets;
+};
+
 //contig class
 class C_contig {
   friend ostream &operator<<(ostream &, const C_contig &);
@@ -335,6 +426,7 @@ class C_contig {
     void calcFragDepth(int,int,int,int);         // calculate fragment coverage in region
     void calcStarts(int);                        // calculate read starts
     long long countReads(int,int);               // count read start in range 
+    long long countStarts(int,int);              // read_start sum in range (indexed)
     int howFar(int,int);                         // end position of region with set number of non-repeat bases
     int setLengthFromAnchor();                   // set contig Length from anchor[contigName].L
     list<C_localpair> localpairs;                // local unique pair  map
@@ -348,7 +440,13 @@ class C_contig {
     C_depth  frag_depth;
     C_depth  read_start;                         // depth of read start positions (1/read)
     C_depth  repeat;                             // repeat map based on multiply aligned reads
+    C_mask   repeatMask;                         // bases with repeat>0 (from repeat or .mask.span)
+    C_aberrant aberrant;                         // pre-partitioned aberrant pairs (*.class.span)
     C_depth  read_counts;                        // count of reads per bin
+    C_startIndex readIndex;                      // starts of all listed reads (countReads)
+    C_startIndex startIndex;                     // starts in read_start (countStarts)
+    C_depthPyramid pyramid;                      // binned read starts (countReads(binsize))
+    void calcPyramid();
     StatObj pairStats;                           // summary stats for local fragment lenths 
     StatObj crossStats;                          // summary stats for cross fragments 
     StatObj dangleStats;                         // summary stats for cross fragments 
@@ -363,16 +461,27 @@ class C_contig {
     unsigned short getAnchorIndex(); 
     string setName;             // set name
     void writePairs(string & ); // const // odd that const kills the list writing...;
+    void writePairs(C_spanBuffer & );            // serialise into staging buffer
     void printPairs(string & ); // const // odd that const kills the list writing...;
     void writeEnd(string &, list<C_singleEnd> & ); // const // odd that const kills the list writing...;
+    void writeEnd(C_spanBuffer &, list<C_singleEnd> & );
     void printEnd(string &,  list<C_singleEnd> & ); 
     void writeCross(string & );
+    void writeCross(C_spanBuffer & );
     void printCross(string & );
     void writeMulti(string &, list<C_umpair> &);
+    void writeMulti(C_spanBuffer &, list<C_umpair> &);
     void printMulti(string &, list<C_umpair> &);
+    void writePairsBlock(string & );             // block-indexed v2 writers 
+    void writeCrossBlock(string & );
+    void writeEndBlock(string &, list<C_singleEnd> & );
+    void writeMultiBlock(string &, list<C_umpair> &);
     void writeDepth(string &, C_depth &);
     void writeDepth(string &, C_depth &, int binsize, int totbin);
     void writeMarker(string &, C_marker &);
+    void writeMask(string &, C_mask &);
+    void writePyramid(string &);
+    void writeAberrant(string &, C_libraries &, vector<string> &);  // *.class.span per class
     void writeStats(string & );
     void printStats(string & );
     C_headerSpan loadHeader(fstream &);
@@ -383,9 +492,16 @@ class C_contig {
     void loadPairs(string & ); 
     void loadCross(string & );  
     list<C_umpair> loadMulti(string &);  
+    list<C_singleEnd> loadEnd(string &, int, int);  // records starting in region 
+    void loadPairs(string &, int, int); 
+    void loadCross(string &, int, int);  
+    list<C_umpair> loadMulti(string &, int, int);  
     //void loadRetroStart(string &);  
     void loadMultipairs(string & );  
     void loadRepeat(string & );  
+    void loadMask(string & );  
+    void loadPyramid(string & );  
+    void loadAberrant(string &);                   // *.class.span if present
     //void loadUniqueEnd(string & );  
     void loadDangle(string & );  
     //void loadDangleEnd(string & );  
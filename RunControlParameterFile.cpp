@@ -97,6 +97,10 @@ RunControlParameters::RunControlParameters( const string & filename)
   setMobileElements(mobv);
   setMobiMaskFile("");
 	setBamZA(0);
+	setSpanFormat(1);
+	setSpanPack(0);
+	setDetectOnly("");
+	setClusterCache(0);
   
   // Regex Fragment Length Window 
   spatternFLWIN="FragmentLengthWindow";
@@ -186,6 +190,14 @@ RunControlParameters::RunControlParameters( const string & filename)
   spatternMobiMaskFile="MobiMaskFile";
   // Regex Bam ZA 
 	spatternBamZA="BamZA";
+  // Regex span output format 
+	spatternSpanFormat="SpanFormat";
+  // Regex single-file span container per set 
+	spatternSpanPack="SpanPack";
+  // Regex detectors to run, comma separated 
+	spatternDetectOnly="DetectOnly";
+  // Regex reuse of selected pairs & clusters 
+	spatternClusterCache="ClusterCache";
 
   // list of stuff to trim at ends of parameter strings 
   SPACES=" \t\r\n\"";  
@@ -234,6 +246,10 @@ RunControlParameters::RunControlParameters( const string & filename)
   string patternMobileElements("^"+spatternMobileElements+"=(\\S+)");
   string patternMobiMaskFile("^"+spatternMobiMaskFile+"=(\\S+)");
   string patternBamZA("^"+spatternBamZA+"=(\\d+)");
+  string patternSpanFormat("^"+spatternSpanFormat+"=(\\d+)");
+  string patternSpanPack("^"+spatternSpanPack+"=(\\d+)");
+  string patternDetectOnly("^"+spatternDetectOnly+"=(\\S+)");
+  string patternClusterCache("^"+spatternClusterCache+"=(\\d+)");
 
   //
   if (filename=="none") {
@@ -372,6 +388,14 @@ RunControlParameters::RunControlParameters( const string & filename)
       setMobiMaskFile(s);
  		} else if (RE2::FullMatch(line.c_str(),patternBamZA.c_str(),&match) ) {
       setBamZA(string2Int(match));
+ 		} else if (RE2::FullMatch(line.c_str(),patternSpanFormat.c_str(),&match) ) {
+      setSpanFormat(string2Int(match));
+ 		} else if (RE2::FullMatch(line.c_str(),patternSpanPack.c_str(),&match) ) {
+      setSpanPack(string2Int(match));
+ 		} else if (RE2::FullMatch(line.c_str(),patternDetectOnly.c_str(),&match) ) {
+      setDetectOnly(match);
+ 		} else if (RE2::FullMatch(line.c_str(),patternClusterCache.c_str(),&match) ) {
+      setClusterCache(string2Int(match));
     }
   }
 } 
@@ -427,6 +451,10 @@ RunControlParameters& RunControlParameters::operator=(const RunControlParameters
    MobileElements=rhs.MobileElements;
    MobiMaskFile=rhs.MobiMaskFile;
 	 BamZA=rhs.BamZA;
+	 SpanFormat=rhs.SpanFormat;
+	 SpanPack=rhs.SpanPack;
+	 DetectOnly=rhs.DetectOnly;
+	 ClusterCache=rhs.ClusterCache;
    return *this;
 }
 
@@ -916,6 +944,59 @@ void RunControlParameters::setSpannerMode(const int b1)
 	SpannerMode = b1;
 }
 
+// span output format
+int RunControlParameters::getSpanFormat() const 
+{
+  return SpanFormat;
+}  
+void RunControlParameters::setSpanFormat(const int f1)
+{
+	SpanFormat = f1;
+}
+
+// single-file span container per set (0=off, 1=on)
+int RunControlParameters::getSpanPack() const 
+{
+  return SpanPack;
+}  
+void RunControlParameters::setSpanPack(const int x1)
+{
+	SpanPack = x1;
+}
+
+// detectors to run, comma separated (del,dup,inv,cross,ret; empty=all)
+string RunControlParameters::getDetectOnly() const 
+{
+  return DetectOnly;
+}  
+void RunControlParameters::setDetectOnly(const string & x1)
+{
+	DetectOnly = x1;
+}
+// detector d enabled: DetectOnly empty or d in the comma separated list
+bool RunControlParameters::getDetect(const string & d) const 
+{
+  if (DetectOnly.size()==0) return true;
+  size_t p0=0;
+  while (p0<=DetectOnly.size()) {
+    size_t p1 = DetectOnly.find(',',p0);
+    if (p1==string::npos) p1=DetectOnly.size();
+    if (DetectOnly.substr(p0,p1-p0)==d) return true;
+    p0=p1+1;
+  }
+  return false;
+}  
+
+// reuse selected pairs & clusters of an earlier run (0=off, 1=on)
+int RunControlParameters::getClusterCache() const 
+{
+  return ClusterCache;
+}  
+void RunControlParameters::setClusterCache(const int x1)
+{
+	ClusterCache = x1;
+}
+
 
 /*
 void RunControlParameters::setFragmentLengthLimits() 
@@ -1032,6 +1113,14 @@ ostream &operator<<(ostream &output,  const RunControlParameters & p1)
 		output << p1.spatternMobiMaskFile << "=" <<  p1.getMobiMaskFile()  << endl;  
 	  output << "//\tBam ZA : " << endl;
 	  output << p1.spatternBamZA << "=""" << p1.getBamZA ()  << """" << endl;
+	  output << "//\tSpan output format : " << endl;
+	  output << p1.spatternSpanFormat << "=""" << p1.getSpanFormat ()  << """" << endl;
+	  output << "//\tSingle-file span container per set (0=off, 1=on) : " << endl;
+	  output << p1.spatternSpanPack << "=""" << p1.getSpanPack ()  << """" << endl;
+	  output << "//\tDetectors to run, comma separated (del,dup,inv,cross,ret; empty=all) : " << endl;
+	  output << p1.spatternDetectOnly << "=""" << p1.getDetectOnly ()  << """" << endl;
+	  output << "//\tReuse selected pairs & clusters of an earlier run (0=off, 1=on) : " << endl;
+	  output << p1.spatternClusterCache << "=""" << p1.getClusterCache ()  << """" << endl;
 	
     return output;
 }
@@ -1201,6 +1290,18 @@ void RunControlParameters::print() const
 	if (p1.getBamZA()!=getBamZA()  ) {
     cout << "\t" <<spatternBamZA << "=" << getBamZA()   << endl;
   }
+	if (p1.getSpanFormat()!=getSpanFormat()  ) {
+    cout << "\t" <<spatternSpanFormat << "=" << getSpanFormat()   << endl;
+  }
+	if (p1.getSpanPack()!=getSpanPack()  ) {
+    cout << "\t" <<spatternSpanPack << "=" << getSpanPack()   << endl;
+  }
+	if (p1.getDetectOnly()!=getDetectOnly()  ) {
+    cout << "\t" <<spatternDetectOnly << "=" << getDetectOnly()   << endl;
+  }
+	if (p1.getClusterCache()!=getClusterCache()  ) {
+    cout << "\t" <<spatternClusterCache << "=" << getClusterCache()   << endl;
+  }
 	
   cout << "\n" << flush;
 }
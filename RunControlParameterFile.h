@@ -141,6 +141,15 @@ public:
 	void setBamZA(const int) ;
 	int getSpannerMode() const;               // Spanner processing mode (scan, build, detect)
 	void setSpannerMode(const int); 
+	int getSpanFormat() const;                // span output format (1=flat records, 2=block-indexed)
+	void setSpanFormat(const int); 
+	int getSpanPack() const;                  // single-file span container per set (0=off, 1=on)
+	void setSpanPack(const int); 
+	string getDetectOnly() const;             // detectors to run, comma separated (del,dup,inv,cross,ret; empty=all)
+	void setDetectOnly(const string &); 
+	bool getDetect(const string &) const;     // detector enabled by DetectOnly
+	int getClusterCache() const;              // reuse selected pairs & clusters of an earlier run (0=off, 1=on)
+	void setClusterCache(const int); 
 	
   // Regex Fragment Length Window 
   string spatternFLWIN;
@@ -234,6 +243,14 @@ public:
 	string spatternBamZA;  
 	// Regex SpannerMode 
 	string spatternSpannerMode;  
+	// Regex SpanFormat 
+	string spatternSpanFormat;  
+	// Regex SpanPack 
+	string spatternSpanPack;  
+	// Regex DetectOnly 
+	string spatternDetectOnly;  
+	// Regex ClusterCache 
+	string spatternClusterCache;  
 
 	
 private:
@@ -287,6 +304,10 @@ private:
   string MobiMaskFile;                 // Mask file template (*) for element name 
   int BamZA;                           // Require ZA tag in bam file
 	int SpannerMode;                     // SpannerMode (0=scan, 1=build...)
+	int SpanFormat;                      // span output format (1=flat records, 2=block-indexed)
+	int SpanPack;                        // single-file span container per set (0=off, 1=on)
+	string DetectOnly;                   // detectors to run, comma separated (del,dup,inv,cross,ret; empty=all)
+	int ClusterCache;                    // reuse selected pairs & clusters of an earlier run (0=off, 1=on)
 	
   // parameter file strings
   // list of stuff to trim at ends of parameter strings 
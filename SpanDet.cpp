@@ -9,247 +9,301 @@
 
 #include "SpanDet.h"
 
+//------------------------------------------------------------------------------
+// with one thread (the default) every contig of every set is detected in set
+// and contig order on this detector. With more threads each contig is a task
+// with a fresh detector (libraries of its set) that writes only its own 
+// per-contig files. Event lists start empty for every contig either way, so
+// the output does not depend on the thread count. The largest contigs are 
+// handed out first, each to the next free thread. Threads left over when 
+// there are fewer contigs than threads go to clustering
+//------------------------------------------------------------------------------
+C_SpannerSV::C_SpannerSV() {
+}
+
 C_SpannerSV::C_SpannerSV(C_pairedfiles & data,  RunControlParameters & pars) {
-  C_contigs::const_iterator iterContig;   
+  C_contigs::iterator iterContig;   
   int Nset = data.set.size();
-      
+  S_detectTasks tasks;
+  tasks.data = &data;
+  tasks.pars = &pars;
+  vector<pair<double,int> > order;
   for (int iset = 0; iset< Nset; iset++) {
-    string setName = data.set[iset].getSetName();
-    
-    int Qmin = data.set[iset].pars.getQmin();
-
-    libraries = data.set[iset].libraries;
-    //readFractions=libraries.readFractionSamples();
-    for (iterContig = data.set[iset].contig.begin();	iterContig != data.set[iset].contig.end(); iterContig++) {
-      string name = iterContig->first;
-      
-      string area = pars.getOutputDir();
-      int k = 1+area.find_last_of("/");
-      string subdir = area.substr(k);
-      if (area.size()>0) { area = area+"/";}
-      string prefix = pars.getPrefix();
-      if (prefix.size()>0) { prefix = prefix+".";}
-      string sn1 = setName;
-      // dont need redundant setName if subdirectory is already the setName
-      // if (sn1==subdir) sn1="";
-      if (sn1.size()>0) { sn1 = sn1+".";}
-      string basename = area+prefix+sn1+name;
-      if (setName==name) basename = area+prefix+name;
-      
-      // replace evil character "|" with benign "_" 
-      size_t found=basename.find("|");
-      while (found!=string::npos) {
-        basename.replace(found,1,"_");
-        found=basename.find("|");
-      }
-      
-      string fname;
+    for (iterContig = data.set[iset].contig.begin(); iterContig != data.set[iset].contig.end(); iterContig++) {
+      C_contig & c1 = iterContig->second;
+      S_detectTask t1;
+      t1.iset = iset;
+      t1.name = iterContig->first;
+      order.push_back(make_pair(-double(c1.localpairs.size()+c1.crosspairs.size()+c1.umpairs.size()), int(tasks.t.size())));
+      tasks.t.push_back(t1);
+    }
+  }
+  // largest first, ties in set and contig order
+  sort(order.begin(), order.end());
+  for (int k=0; k<int(order.size()); k++) {
+    tasks.order.push_back(order[k].second);
+  }
+  int Ntask = tasks.t.size();
+  int Nthread = getThreadCount();
+  int Nworker = (Nthread<Ntask? Nthread: Ntask);
+  if (Nworker<=1) {
+    for (int k=0; k<Ntask; k++) {
+      detect(data, tasks.t[k].iset, tasks.t[k].name, pars);
+    }
+    return;
+  }
+  setThreadCount(Nthread/Nworker);
+  C_threadPool pool(Nworker);
+  pool.run(Ntask, detectTask, &tasks);
+  setThreadCount(Nthread);
+}
 
-      //-----------------------------------------------------------------------
-      // bug out when missing pair info
-      //-----------------------------------------------------------------------
-      if (data.set[iset].contig[name].pairStats.N==0) { continue ; }
-            
-      //-----------------------------------------------------------------------
-      // Clustering
-      //-----------------------------------------------------------------------
-      C_SpannerCluster clus(data.set[iset].contig[name], libraries, pars);
-      clus.writeall();
-      
-			/*
-      //-----------------------------------------------------------------------
-      // calc read starts for CNV if not already done...
-      //-----------------------------------------------------------------------
-      if (data.set[iset].contig[name].read_start.n.size()==0) {
-        // check for existing .read.start.span file in input area...
-        fname = area+prefix+sn1+name+".read.start.span";
-        ifstream fin;
-        fin.open(fname.c_str());
-        if( !fin ) {
-          data.set[iset].contig[name].calcStarts(Qmin);
-          fname = basename+".read.start.span";
-          cout << "write\t " << fname << endl;
-          data.set[iset].contig[name].writeDepth(fname,
-                      data.set[iset].contig[name].read_start);  
-        } else { 
-          cout << "load\t " << fname << endl;
-          data.set[iset].contig[name].read_start=data.set[iset].contig[name].loadDepth(fname);
-          data.set[iset].contig[name].read_start.calcStats();
-        }         
-      }
+void C_SpannerSV::detectTask(void * a, int k) {
+  S_detectTasks * tasks = reinterpret_cast<S_detectTasks *>(a);
+  S_detectTask & t1 = tasks->t[tasks->order[k]];
+  C_SpannerSV sv;
+  sv.detect(*tasks->data, t1.iset, t1.name, *tasks->pars);
+}
 
-      //-----------------------------------------------------------------------
-      // nominal coverage distributions for CNV p-values
-      //-----------------------------------------------------------------------
-      int nua[8] = {50,100,200,500,1000,2000,5000,10000};
-      vector<int> nu0(nua,nua+8);
-      C_NominalCov nomcov1(data.set[iset],  nu0); 
-      nomcov = nomcov1;
+//------------------------------------------------------------------------------
+// detection on one contig of set iset
+//------------------------------------------------------------------------------
+void C_SpannerSV::detect(C_pairedfiles & data, int iset, string & name, RunControlParameters & pars) {
+  string setName = data.set[iset].getSetName();
+  libraries = data.set[iset].libraries;
+  
+  string area = pars.getOutputDir();
+  int k = 1+area.find_last_of("/");
+  string subdir = area.substr(k);
+  if (area.size()>0) { area = area+"/";}
+  string prefix = pars.getPrefix();
+  if (prefix.size()>0) { prefix = prefix+".";}
+  string sn1 = setName;
+  // dont need redundant setName if subdirectory is already the setName
+  // if (sn1==subdir) sn1="";
+  if (sn1.size()>0) { sn1 = sn1+".";}
+  string basename = area+prefix+sn1+name;
+  if (setName==name) basename = area+prefix+name;
+  
+  // replace evil character "|" with benign "_" 
+  size_t found=basename.find("|");
+  while (found!=string::npos) {
+    basename.replace(found,1,"_");
+    found=basename.find("|");
+  }
+  
+  string fname;
 
-      //-----------------------------------------------------------------------
-      // calc fragment depth for retro insertions if not already done...
-      //-----------------------------------------------------------------------
-      if (data.set[iset].contig[name].frag_depth.n.size()==0) {
-        fname = area+prefix+sn1+name+".frag.depth.span";
-        ifstream fin;
-        fin.open(fname.c_str());
-        if( !fin ) {
-          // change this to use library LMlow LMhigh
-          int lmLow = int(pars.getFragmentLengthLo());
-          int lmHigh = int(pars.getFragmentLengthHi());
-          int L =  data.set[iset].contig[name].Length;
-          data.set[iset].contig[name].calcFragDepth(0,L,lmLow,lmHigh);
-          fname = basename+".frag.depth.span";
-          cout << "write\t  " << fname << endl;
-          data.set[iset].contig[name].writeDepth(fname,
-                      data.set[iset].contig[name].frag_depth);  
-        } else { 
-          cout << "load \t " << fname << endl;
-          data.set[iset].contig[name].frag_depth = data.set[iset].contig[name].loadDepth(fname);
-          data.set[iset].contig[name].frag_depth.calcStats();
-        }       
+  //-----------------------------------------------------------------------
+  // bug out when missing pair info
+  //-----------------------------------------------------------------------
+  if (data.set[iset].contig[name].pairStats.N==0) { return ; }
+        
+  //-----------------------------------------------------------------------
+  // Clustering
+  //-----------------------------------------------------------------------
+  C_SpannerCluster clus(data.set[iset].contig[name], libraries, pars);
+  clus.writeall();
+  
+			/*
+  //-----------------------------------------------------------------------
+  // calc read starts for CNV if not already done...
+  //-----------------------------------------------------------------------
+  if (data.set[iset].contig[name].read_start.n.size()==0) {
+    // check for existing .read.start.span file in input area...
+    fname = area+prefix+sn1+name+".read.start.span";
+    ifstream fin;
+    fin.open(fname.c_str());
+    if( !fin ) {
+      data.set[iset].contig[name].calcStarts(Qmin);
+      fname = basename+".read.start.span";
+      cout << "write\t " << fname << endl;
+      data.set[iset].contig[name].writeDepth(fname,
+                  data.set[iset].contig[name].read_start);  
+    } else { 
+      cout << "load\t " << fname << endl;
+      data.set[iset].contig[name].read_start=data.set[iset].contig[name].loadDepth(fname);
+      data.set[iset].contig[name].read_start.calcStats();
+    }         
+  }
+
+  //-----------------------------------------------------------------------
+  // nominal coverage distributions for CNV p-values
+  //-----------------------------------------------------------------------
+  int nua[8] = {50,100,200,500,1000,2000,5000,10000};
+  vector<int> nu0(nua,nua+8);
+  C_NominalCov nomcov1(data.set[iset],  nu0); 
+  nomcov = nomcov1;
+
+  //-----------------------------------------------------------------------
+  // calc fragment depth for retro insertions if not already done...
+  //-----------------------------------------------------------------------
+  if (data.set[iset].contig[name].frag_depth.n.size()==0) {
+    fname = area+prefix+sn1+name+".frag.depth.span";
+    ifstream fin;
+    fin.open(fname.c_str());
+    if( !fin ) {
+      // change this to use library LMlow LMhigh
+      int lmLow = int(pars.getFragmentLengthLo());
+      int lmHigh = int(pars.getFragmentLengthHi());
+      int L =  data.set[iset].contig[name].Length;
+      data.set[iset].contig[name].calcFragDepth(0,L,lmLow,lmHigh);
+      fname = basename+".frag.depth.span";
+      cout << "write\t  " << fname << endl;
+      data.set[iset].contig[name].writeDepth(fname,
+                  data.set[iset].contig[name].frag_depth);  
+    } else { 
+      cout << "load \t " << fname << endl;
+      data.set[iset].contig[name].frag_depth = data.set[iset].contig[name].loadDepth(fname);
+      data.set[iset].contig[name].frag_depth.calcStats();
+    }       
 
-      }
+  }
 			 */
 			
-      //-----------------------------------------------------------------------
-      // check for mobile element insertions
-      //-----------------------------------------------------------------------
-      C_retroElements retrolist(data.set[iset].contig[name].anchors);
-      int NE=retrolist.e.size();
-
-      for (int j=0; j<NE; j++) {
-        int e = retrolist.e[j];
-        string retroType = retrolist.name[j];
-        if (retroType[2]=='.') { retroType = retroType.substr(0,2);}
-
-        //-----------------------------------------------------------------------
-        // Retro mobile element Clustering
-        //-----------------------------------------------------------------------
-
-        C_SpannerRetroCluster rclus(data.set[iset].contig[name],libraries,pars,e,retroType);
-
-        //-----------------------------------------------------------------------
-        // mobile element masking
-        //-----------------------------------------------------------------------
-        string maskfile1 = pars.getMobiMaskFile();
-        size_t ia=maskfile1.find("$");
-        if (ia!=string::npos) { 
-           string maskfile=maskfile1;
-           maskfile.replace(ia, 1, retroType);
-           if (!FileExists(maskfile)) {
-              maskfile=maskfile1;
-              string rtype=upperCase(retroType);
-              maskfile.replace(ia, 1, rtype);
-              //cout << " uppercase annotations  " << maskfile << endl;
-           }
-           if (!FileExists(maskfile)) {
-              maskfile=maskfile1;
-              string rtype=lowerCase(retroType);
-              maskfile.replace(ia, 1, rtype);
-              //cout << " lowercase annotations  " << maskfile << endl;
-           }
-           if (!FileExists(maskfile)) {
-              maskfile=maskfile1;
-              string rtype=Titlecase(retroType);
-              maskfile.replace(ia, 1, rtype);
-              //cout << " Titlecase annotations  " << maskfile << endl;
-           } 
-           
-                 
-           if (FileExists(maskfile)) {
-              C_BedChr mask(maskfile,name);
-              mask.name = retroType;
-              ret.Mask=mask;
-
-              cout << " loaded " << mask.p.size() ;
-              cout << " annotations from " << maskfile << endl;
-        
-              int LMmax = int(libraries.maxLF()/2.0);
-              // mask out clusters near annotated elements
-              rclus.Mask(mask,LMmax);
-
-           }
-        }
-        
-        //-----------------------------------------------------------------------
-        // write Element Insertion clusters
-        //-----------------------------------------------------------------------
-        rclus.writeall();
-                
-        //-----------------------------------------------------------------------
-        // ELement Insertions
-        //-----------------------------------------------------------------------
-        int Nret = findRet(data.set[iset].contig[name], rclus, pars);
-        ret.contigName=name;
-        ret.setName=setName;
-        cout << " find " << Nret << " " << retroType << " element insertions" << endl;
-        fname = basename+"."+retroType+".svcf";
-        cout << "write " << retroType << " element insertions : " << fname << endl;
-        ret.print(fname);
-      }
-
-
-      //-----------------------------------------------------------------------
-      // Cross links
-      //-----------------------------------------------------------------------
-      int Ncrx = findCross(data.set[iset].contig[name], clus, pars);
-      crx.typeName="crosslinks";
-      crx.contigName=name;
-      crx.setName=setName;
-      cout << " find " << Ncrx << " cross chromosomal links" << endl;
-      fname = basename+".cross.svcf";
-      cout << "write cross chromosomal links : " << fname << endl;
-      crx.print(fname);
-        
-      //-----------------------------------------------------------------------
-      // Inversions
-      //-----------------------------------------------------------------------
-      int Ninv = findInv(data.set[iset].contig[name], clus, pars);
-      inv.typeName="inversions";
-      inv.contigName=name;
-      inv.setName=setName;
-      cout << " find " << Ninv << " inversions" << endl;
-      fname = basename+".inv.svcf";
-      cout << "write inversions : " << fname << endl;
-      inv.print(fname);
-      
-
-      //-----------------------------------------------------------------------
-      // Deletions
-      //-----------------------------------------------------------------------
-      int Ndel = findDel(data.set[iset].contig[name], clus, pars);
-      del.typeName="deletions";
-      del.contigName=name;
-      del.setName=setName;
-      cout << " find " << Ndel << " deletions" << endl;
-      //int Ndup = findDel(data.set[iset].contig[name], clus, pars);
-      //del.typeName="deletions";
-      fname = basename+".del.svcf";
-      cout << "write deletions : " << fname << endl;
-      del.print(fname);      
+  //-----------------------------------------------------------------------
+  // check for mobile element insertions
+  //-----------------------------------------------------------------------
+  C_retroElements retrolist(data.set[iset].contig[name].anchors);
+  int NE = (pars.getDetect("ret")? retrolist.e.size(): 0);
+
+  for (int j=0; j<NE; j++) {
+    int e = retrolist.e[j];
+    string retroType = retrolist.name[j];
+    if (retroType[2]=='.') { retroType = retroType.substr(0,2);}
+
+    //-----------------------------------------------------------------------
+    // Retro mobile element Clustering
+    //-----------------------------------------------------------------------
+
+    C_SpannerRetroCluster rclus(data.set[iset].contig[name],libraries,pars,e,retroType);
+
+    //-----------------------------------------------------------------------
+    // mobile element masking
+    //-----------------------------------------------------------------------
+    string maskfile1 = pars.getMobiMaskFile();
+    size_t ia=maskfile1.find("$");
+    if (ia!=string::npos) { 
+       string maskfile=maskfile1;
+       maskfile.replace(ia, 1, retroType);
+       if (!FileExists(maskfile)) {
+          maskfile=maskfile1;
+          string rtype=upperCase(retroType);
+          maskfile.replace(ia, 1, rtype);
+          //cout << " uppercase annotations  " << maskfile << endl;
+       }
+       if (!FileExists(maskfile)) {
+          maskfile=maskfile1;
+          string rtype=lowerCase(retroType);
+          maskfile.replace(ia, 1, rtype);
+          //cout << " lowercase annotations  " << maskfile << endl;
+       }
+       if (!FileExists(maskfile)) {
+          maskfile=maskfile1;
+          string rtype=Titlecase(retroType);
+          maskfile.replace(ia, 1, rtype);
+          //cout << " Titlecase annotations  " << maskfile << endl;
+       } 
+       
+             
+       if (FileExists(maskfile)) {
+          const C_BedChr & mask = bedRegistry().get(maskfile,name);
+          ret.Mask=&mask;
 
-      //-----------------------------------------------------------------------
-      // Duplications
-      //-----------------------------------------------------------------------
-      int Ndup = findDup(data.set[iset].contig[name], clus, pars);
-      dup.typeName="duplications";
-      dup.contigName=name;
-      dup.setName=setName;
-      cout << " find " << Ndup << " duplications" << endl;
-      fname = basename+".dup.svcf";
-      cout << "write duplications : " << fname << endl;
-      dup.print(fname); 
-      
+          cout << " loaded " << mask.p.size() ;
+          cout << " annotations from " << maskfile << endl;
+    
+          int LMmax = int(libraries.maxLF()/2.0);
+          // mask out clusters near annotated elements
+          rclus.Mask(mask,LMmax);
 
-      //-----------------------------------------------------------------------
-      // Done - print summary 
-      //-----------------------------------------------------------------------
-      fname = basename+".summary.span.txt";
-      cout << "write summary : " << fname << endl;                    
-      printSummary(fname, data.set[iset].contig[name]);
+       }
     }
+    
+    //-----------------------------------------------------------------------
+    // write Element Insertion clusters
+    //-----------------------------------------------------------------------
+    rclus.writeall();
+            
+    //-----------------------------------------------------------------------
+    // ELement Insertions
+    //-----------------------------------------------------------------------
+    int Nret = findRet(data.set[iset].contig[name], rclus, pars);
+    ret.contigName=name;
+    ret.setName=setName;
+    cout << " find " << Nret << " " << retroType << " element insertions" << endl;
+    fname = basename+"."+retroType+".svcf";
+    cout << "write " << retroType << " element insertions : " << fname << endl;
+    ret.print(fname);
+  }
+
+
+  //-----------------------------------------------------------------------
+  // Cross links
+  //-----------------------------------------------------------------------
+  if (pars.getDetect("cross")) {
+    int Ncrx = findCross(data.set[iset].contig[name], clus, pars);
+    crx.typeName="crosslinks";
+    crx.contigName=name;
+    crx.setName=setName;
+    cout << " find " << Ncrx << " cross chromosomal links" << endl;
+    fname = basename+".cross.svcf";
+    cout << "write cross chromosomal links : " << fname << endl;
+    crx.print(fname);
   }
+    
+  //-----------------------------------------------------------------------
+  // Inversions
+  //-----------------------------------------------------------------------
+  if (pars.getDetect("inv")) {
+    int Ninv = findInv(data.set[iset].contig[name], clus, pars);
+    inv.typeName="inversions";
+    inv.contigName=name;
+    inv.setName=setName;
+    cout << " find " << Ninv << " inversions" << endl;
+    fname = basename+".inv.svcf";
+    cout << "write inversions : " << fname << endl;
+    inv.print(fname);
+  }
+  
+
+  //-----------------------------------------------------------------------
+  // Deletions
+  //-----------------------------------------------------------------------
+  if (pars.getDetect("del")) {
+    int Ndel = findDel(data.set[iset].contig[name], clus, pars);
+    del.typeName="deletions";
+    del.contigName=name;
+    del.setName=setName;
+    cout << " find " << Ndel << " deletions" << endl;
+    //int Ndup = findDel(data.set[iset].contig[name], clus, pars);
+    //del.typeName="deletions";
+    fname = basename+".del.svcf";
+    cout << "write deletions : " << fname << endl;
+    del.print(fname);      
+  }
+
+  //-----------------------------------------------------------------------
+  // Duplications
+  //-----------------------------------------------------------------------
+  if (pars.getDetect("dup")) {
+    int Ndup = findDup(data.set[iset].contig[name], clus, pars);
+    dup.typeName="duplications";
+    dup.contigName=name;
+    dup.setName=setName;
+    cout << " find " << Ndup << " duplications" << endl;
+    fname = basename+".dup.svcf";
+    cout << "write duplications : " << fname << endl;
+    dup.print(fname); 
+  }
+  
+
+  //-----------------------------------------------------------------------
+  // Done - print summary 
+  //-----------------------------------------------------------------------
+  fname = basename+".summary.span.txt";
+  cout << "write summary : " << fname << endl;                    
+  printSummary(fname, data.set[iset].contig[name]);
 }
 
 
@@ -286,9 +340,8 @@ void C_SpannerSV::printSummary(string & outfilename, C_contig & c1) {
 int C_SpannerSV::findDel(C_contig  & contig, C_SpannerCluster & clus,  
         RunControlParameters & pars) {
   del.typeName="deletions";
+  del.evt.clear();
   //int Nc = clus.longpairc.cluster.size();
-  C_cluster2d_elements::iterator it;
-  C_cluster2d_element1 c1;
   vector<C_localpair> cpair;
     
   //----------------------------------------------------------------------------
@@ -347,10 +400,10 @@ int C_SpannerSV::findDel(C_contig  & contig, C_SpannerCluster & clus,
   //----------------------------------------------------------------------------
   // loop over long pair clusters to identify candidate deletions
   //----------------------------------------------------------------------------
-  for ( it=clus.longpairc.cluster.begin() ; it != clus.longpairc.cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = clus.longpairc.cluster[i];   
-    int Np = c1.inp.size();
+  for (int ic=0; ic<clus.longpairc.cluster.size(); ic++) {
+    const C_cluster2d_stats & c1 = clus.longpairc.cluster[ic];   
+    const int * inp = clus.longpairc.cluster.inp(ic);
+    int Np = c1.N;
     //-------------------------------------------------------------------------
     // initialize cluster limits:    p5a--p5b      p3a-p3b
     //-------------------------------------------------------------------------
@@ -369,7 +422,7 @@ int C_SpannerSV::findDel(C_contig  & contig, C_SpannerCluster & clus,
     // loop over fragments in cluster
     cpair.resize(Np);
     for (int j=0; j<Np; j++) {
-       int k = c1.inp[j];
+       int k = inp[j];
        C_localpair lp1 = clus.longpair[k];
        cpair[j]=lp1;
        int p = lp1.pos;                // start of 5' cluster
@@ -480,7 +533,7 @@ int C_SpannerSV::findDel(C_contig  & contig, C_SpannerCluster & clus,
     //e1.cov=cov;
     //e1.cov5=cov5;
     //e1.cov3=cov3;
-    e1.cls = c1;
+    e1.cls = clus.longpairc.cluster.element(ic);
     e1.pair=cpair;
     e1.p5[0]=p5a;
     e1.p5[1]=p5b;
@@ -562,8 +615,7 @@ int C_SpannerSV::findDel(C_contig  & contig, C_SpannerCluster & clus,
 int C_SpannerSV::findDup(C_contig  & contig, C_SpannerCluster & clus,  
   RunControlParameters & pars) {
   dup.typeName="duplications";
-  C_cluster2d_elements::iterator it;
-  C_cluster2d_element1 c1;
+  dup.evt.clear();
   vector<C_localpair> cpair;
   
   //----------------------------------------------------------------------------
@@ -619,14 +671,14 @@ int C_SpannerSV::findDup(C_contig  & contig, C_SpannerCluster & clus,
   //----------------------------------------------------------------------------
   // loop over long pair clusters to identify candidate duplications
   //----------------------------------------------------------------------------
-  for ( it=clus.shortpairc.cluster.begin() ; it != clus.shortpairc.cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = clus.shortpairc.cluster[i];   
+  for (int ic=0; ic<clus.shortpairc.cluster.size(); ic++) {
+    const C_cluster2d_stats & c1 = clus.shortpairc.cluster[ic];   
+    const int * inp = clus.shortpairc.cluster.inp(ic);
     //-------------------------------------------------------------------------
     // highest start position mark start of duplication 
     //-------------------------------------------------------------------------
     //int p0 = int(c1.high[0]+contig.aLR+1);
-    int Np = c1.inp.size();
+    int Np = c1.N;
     //-------------------------------------------------------------------------
     // initialize cluster limits:    p5a--p5b      p3a-p3b
     //-------------------------------------------------------------------------
@@ -646,7 +698,7 @@ int C_SpannerSV::findDup(C_contig  & contig, C_SpannerCluster & clus,
     //
     cpair.resize(Np);
     for (int j=0; j<Np; j++) {
-       int k = c1.inp[j];
+       int k = inp[j];
        C_localpair lp1 = clus.shortpair[k];
        cpair[j]=lp1;
        int p = lp1.pos;                // start of 5' cluster
@@ -759,7 +811,7 @@ int C_SpannerSV::findDup(C_contig  & contig, C_SpannerCluster & clus,
     e1.q = (100.*Np)/(Np+5); //p2q(cov.p);
     //    
     //e1.cov=cov;  
-    e1.cls = c1;
+    e1.cls = clus.shortpairc.cluster.element(ic);
     e1.pair=cpair;
     e1.p5[0]=p5a;
     e1.p5[1]=p5b;
@@ -845,6 +897,7 @@ int C_SpannerSV::findInv(C_contig  & contig, C_SpannerCluster & clus,  RunContro
   C_SVV inv3 = findInvDir(contig, clus, pars,3);
   C_SVV inv5 = findInvDir(contig, clus, pars,5);
   inv.typeName="inversions";
+  inv.evt.clear();
 
   //----------------------------------------------------------------------------
   // samples name vector sorted & unique in ret
@@ -1017,10 +1070,6 @@ int C_SpannerSV::findInv(C_contig  & contig, C_SpannerCluster & clus,  RunContro
 C_SVV C_SpannerSV::findInvDir(C_contig  & contig, C_SpannerCluster & clus,  RunControlParameters & pars, int dir) {
   C_SVV inv1;
   if (!( (dir==3)||(dir==5) )) return inv1;
-  C_cluster2d_elements::iterator it;
-  C_cluster2d_elements::iterator it0;
-  C_cluster2d_elements::iterator it1;
-  C_cluster2d_element1 c1;
   vector<C_localpair> cpair;
   //----------------------------------------------------------------------------
   // fragment length properties
@@ -1034,25 +1083,18 @@ C_SVV C_SpannerSV::findInvDir(C_contig  & contig, C_SpannerCluster & clus,  RunC
   //----------------------------------------------------------------------------
   // loop over long pair clusters to identify candidate deletions
   //----------------------------------------------------------------------------
-  it0=clus.invert3c.cluster.begin();
-  it1=clus.invert3c.cluster.end();
+  const C_cluster2d_elements & cc = (dir==5? clus.invert5c.cluster: clus.invert3c.cluster);
   inv1.typeName ="inv3";  
   if (dir==5)  {
     inv1.typeName ="inv5";  
-    it0=clus.invert5c.cluster.begin();
-    it1=clus.invert5c.cluster.end();
   }
-  for ( it=it0 ; it != it1; it++ ) {
-    int i = (*it).first;
-    if (dir==5) {
-      c1 = clus.invert5c.cluster[i];   
-    } else {
-      c1 = clus.invert3c.cluster[i];   
-    }
+  for (int ic=0; ic<cc.size(); ic++) {
+    const C_cluster2d_stats & c1 = cc[ic];   
+    const int * inp = cc.inp(ic);
     //-------------------------------------------------------------------------
     // number of pairs in cluster
     //-------------------------------------------------------------------------
-    int Np = c1.inp.size();
+    int Np = c1.N;
     //-------------------------------------------------------------------------
     // initialize cluster limits:    p5a--p5b      p3a-p3b
     //-------------------------------------------------------------------------
@@ -1070,7 +1112,7 @@ C_SVV C_SpannerSV::findInvDir(C_contig  & contig, C_SpannerCluster & clus,  RunC
     //
     cpair.resize(Np);
     for (int j=0; j<Np; j++) {
-       int k = c1.inp[j];
+       int k = inp[j];
        C_localpair lp1;
        if(dir==5) {
            lp1 = clus.invert5[k];
@@ -1174,7 +1216,7 @@ C_SVV C_SpannerSV::findInvDir(C_contig  & contig, C_SpannerCluster & clus,  RunC
     //    
     //e1.cov=cov;  
     if (dir==5)  {
-      e1.cls5 = c1;
+      e1.cls5 = cc.element(ic);
       e1.pair5=cpair;
       //e1.cov5=cov5;
       // ReadGroups in event
@@ -1186,7 +1228,7 @@ C_SVV C_SpannerSV::findInvDir(C_contig  & contig, C_SpannerCluster & clus,  RunC
       e1.NfragCluster[0]=Np;
     
     } else {
-      e1.cls3 = c1;
+      e1.cls3 = cc.element(ic);
       e1.pair3=cpair;
       //e1.cov3=cov3;
       // ReadGroups in event
@@ -1227,14 +1269,14 @@ C_SVV C_SpannerSV::findInvDir(C_contig  & contig, C_SpannerCluster & clus,  RunC
 
     // fragments spanning break region 
     /*
-		 e1.NfragCov=int(contig.frag_depth.n[p0]);
+		 e1.NfragCov=int(contig.frag_depth.at(p0));
     if (p0>LFmax) {
-      e1.NfragCovOut[0]=int(contig.frag_depth.n[p0-int(LFmax)]);
+      e1.NfragCovOut[0]=int(contig.frag_depth.at(p0-int(LFmax)));
     } else {
       e1.NfragCovOut[0]=0;
     }
     if ((int(e1.pos)+len+LFmax)<int(contig.Length)) {
-      e1.NfragCovOut[1]=int(contig.frag_depth.n[e1.pos+len+int(LFmax)]);
+      e1.NfragCovOut[1]=int(contig.frag_depth.at(e1.pos+len+int(LFmax)));
     } else {
       e1.NfragCovOut[1]=0;
     }
@@ -1291,6 +1333,7 @@ int C_SpannerSV::findCross(C_contig  & contig, C_SpannerCluster & clus,  RunCont
   C_SVX cross5 = findCrossDir(contig, clus, pars,5);
   
   crx.typeName="crossChromosome";
+  crx.evt.clear();
 
   //----------------------------------------------------------------------------
   // samples name vector sorted & unique in ret
@@ -1448,10 +1491,6 @@ C_SVX C_SpannerSV::findCrossDir(C_contig  & contig, C_SpannerCluster & clus,  Ru
   
   C_SVX crx1;
   if (!( (dir==3)||(dir==5) )) return crx1;
-  C_cluster2d_elements::iterator it;
-  C_cluster2d_elements::iterator it0;
-  C_cluster2d_elements::iterator it1;
-  C_cluster2d_element1 c1;
   vector<C_crosspair> xPair;
   
   //----------------------------------------------------------------------------
@@ -1465,29 +1504,22 @@ C_SVX C_SpannerSV::findCrossDir(C_contig  & contig, C_SpannerCluster & clus,  Ru
   //----------------------------------------------------------------------------
   // loop over long pair clusters to identify candidate deletions
   //----------------------------------------------------------------------------
-  it0=clus.cross3c.cluster.begin();
-  it1=clus.cross3c.cluster.end();
+  const C_cluster2d_elements & cc = (dir==5? clus.cross5c.cluster: clus.cross3c.cluster);
   crx1.typeName ="cross3";  
   if (dir==5)  {
     crx1.typeName ="cross5";  
-    it0=clus.cross5c.cluster.begin();
-    it1=clus.cross5c.cluster.end();
   }
   
   //----------------------------------------------------------------------------
   // loop over clusters
   //----------------------------------------------------------------------------
-  for ( it=it0 ; it != it1; it++ ) {
-    int i = (*it).first;
-    if (dir==5) {
-      c1 = clus.cross5c.cluster[i];   
-    } else {
-      c1 = clus.cross3c.cluster[i];   
-    }
+  for (int ic=0; ic<cc.size(); ic++) {
+    const C_cluster2d_stats & c1 = cc[ic];   
+    const int * inp = cc.inp(ic);
     //-------------------------------------------------------------------------
     // number of pairs in cluster
     //-------------------------------------------------------------------------
-    int Np = c1.inp.size();
+    int Np = c1.N;
     //-------------------------------------------------------------------------
     // initialize cluster limits:    p5a--p5b      p3a-p3b
     //-------------------------------------------------------------------------
@@ -1509,7 +1541,7 @@ C_SVX C_SpannerSV::findCrossDir(C_contig  & contig, C_SpannerCluster & clus,  Ru
     // 
     //--------------------------------------------------------------------------  
     for (int j=0; j<Np; j++) {
-       int k = c1.inp[j];
+       int k = inp[j];
        C_crosspair xp1;
        if(dir==5) {
            xp1 = clus.cross5[k];
@@ -1593,7 +1625,7 @@ C_SVX C_SpannerSV::findCrossDir(C_contig  & contig, C_SpannerCluster & clus,  Ru
     //e1.cov=cov;  
     
     if (dir==5)  {
-      e1.cls5 = c1;
+      e1.cls5 = cc.element(ic);
       e1.cross5=xPair;
       //e1.cov5=covH;
       // ReadGroups in event
@@ -1606,7 +1638,7 @@ C_SVX C_SpannerSV::findCrossDir(C_contig  & contig, C_SpannerCluster & clus,  Ru
       e1.p3a2[0]=pTa;
       e1.p3a2[1]=pTb;
     } else {
-      e1.cls3 = c1;
+      e1.cls3 = cc.element(ic);
       e1.cross3=xPair;
       //e1.cov3=covH;
       // ReadGroups in event
@@ -1632,14 +1664,14 @@ C_SVX C_SpannerSV::findCrossDir(C_contig  & contig, C_SpannerCluster & clus,  Ru
 
     // fragments spanning break region 
     /*
-		e1.NfragCov=int(contig.frag_depth.n[pB]);
+		e1.NfragCov=int(contig.frag_depth.at(pB));
     if (pB>LFmax) {
-      e1.NfragCovOut[0]=int(contig.frag_depth.n[pB-int(LFmax)]);
+      e1.NfragCovOut[0]=int(contig.frag_depth.at(pB-int(LFmax)));
     } else {
       e1.NfragCovOut[0]=0;
     }
     if ((int(e1.pos)+LFmax)<int(contig.Length)) {
-      e1.NfragCovOut[1]=int(contig.frag_depth.n[e1.pos+int(LFmax)]);
+      e1.NfragCovOut[1]=int(contig.frag_depth.at(e1.pos+int(LFmax)));
     } else {
       e1.NfragCovOut[1]=0;
     }
@@ -2060,14 +2092,14 @@ C_SVV1 C_SpannerSV::merge(C_SVV1 & e0, C_SVV1 & e1, C_contig  & contig) {
   p0=ee.pos;
   int len=ee.length;
   /*
-	 ee.NfragCov=int(contig.frag_depth.n[p0]);
+	 ee.NfragCov=int(contig.frag_depth.at(p0));
   if (p0>LFmax) {
-      ee.NfragCovOut[0]=int(contig.frag_depth.n[p0-int(LFmax)]);
+      ee.NfragCovOut[0]=int(contig.frag_depth.at(p0-int(LFmax)));
   } else {
       ee.NfragCovOut[0]=0;
   }
   if ((p0+len+LFmax)<contig.Length) {
-      ee.NfragCovOut[1]=int(contig.frag_depth.n[p0+len+int(LFmax)]);
+      ee.NfragCovOut[1]=int(contig.frag_depth.at(p0+len+int(LFmax)));
   } else {
       ee.NfragCovOut[0]=0;
   }
@@ -2296,15 +2328,15 @@ C_SVX1 C_SpannerSV::merge(C_SVX1 & e0, C_SVX1 & e1, C_contig  & contig) {
   int len=ee.length;
 	
 	/*
-	 ee.NfragCov=int(contig.frag_depth.n[p0]);
+	 ee.NfragCov=int(contig.frag_depth.at(p0));
   if (p0>LFmax) {
-      ee.NfragCovOut[0]=int(contig.frag_depth.n[p0-int(LFmax)]);
+      ee.NfragCovOut[0]=int(contig.frag_depth.at(p0-int(LFmax)));
   } else {
       ee.NfragCovOut[0]=0;
   }
 	
   if ((p0+len+LFmax)<contig.Length) {
-      ee.NfragCovOut[1]=int(contig.frag_depth.n[p0+len+int(LFmax)]);
+      ee.NfragCovOut[1]=int(contig.frag_depth.at(p0+len+int(LFmax)));
   } else {
       ee.NfragCovOut[0]=0;
   }
@@ -2475,14 +2507,14 @@ int C_SpannerSV::findRet0(C_contig  & contig, C_SpannerRetroCluster & rclus,  Ru
     e1.retro3=retro3;
     e1.NfragCluster[0]=Np5;
     e1.NfragCluster[1]=Np3;
-    e1.NfragCov=int(contig.frag_depth.n[p0]);
+    e1.NfragCov=int(contig.frag_depth.at(p0));
     if (p0>LF) {
-      e1.NfragCovOut[0]=int(contig.frag_depth.n[int(p0-LF)]);
+      e1.NfragCovOut[0]=int(contig.frag_depth.at(int(p0-LF)));
     } else {
       e1.NfragCovOut[0]=0;
     }
     if ((p0+LF)<contig.Length) {
-      e1.NfragCovOut[1]=int(contig.frag_depth.n[int(p0+LF)]);
+      e1.NfragCovOut[1]=int(contig.frag_depth.at(int(p0+LF)));
     } else {
       e1.NfragCovOut[0]=0;
     }
@@ -2526,8 +2558,6 @@ int C_SpannerSV::findRet(C_contig  & contig, C_SpannerRetroCluster & rclus,
   RunControlParameters & pars) {
   ret.evt.clear();
   ret.typeName=rclus.typeName;
-  C_cluster2d_elements::iterator i1;
-  C_cluster2d_element1 c1;
   
   //----------------------------------------------------------------------------
   // samples name vector sorted & unique in ret
@@ -2588,15 +2618,15 @@ int C_SpannerSV::findRet(C_contig  & contig, C_SpannerRetroCluster & rclus,
   // loop over retro clusters to identify candidate insertions
   //----------------------------------------------------------------------------
   // fiveprime first
-  for ( i1=c5c.cluster.begin() ; i1 != c5c.cluster.end(); i1++ ) {
-    int j = (*i1).first;
-    C_SVR1 e1=makeRetEvent(contig, c5c.cluster[j], rclus.e5, Nexp  );
+  for (int j=0; j<c5c.cluster.size(); j++) {
+    C_cluster2d_element1 c1 = c5c.cluster.element(j);
+    C_SVR1 e1=makeRetEvent(contig, c1, rclus.e5, Nexp  );
     ret.evt.push_back(e1);
   }
   // threeprime next
-  for ( i1=c3c.cluster.begin() ; i1 != c3c.cluster.end(); i1++ ) {
-    int j = (*i1).first;
-    C_SVR1 e1=makeRetEvent(contig, c3c.cluster[j], rclus.e3, Nexp  );
+  for (int j=0; j<c3c.cluster.size(); j++) {
+    C_cluster2d_element1 c1 = c3c.cluster.element(j);
+    C_SVR1 e1=makeRetEvent(contig, c1, rclus.e3, Nexp  );
     ret.evt.push_back(e1);
   }
   
@@ -2783,14 +2813,14 @@ C_SVR1  C_SpannerSV::makeRetEvent(C_contig  & contig,
     e1.posU=(avegap>avegapC? avegap: avegapC);
     e1.lenU=e1.posU;
     // retro event info
-    e1.NfragCov=int(contig.frag_depth.n[p0]);
+    e1.NfragCov=int(contig.frag_depth.at(p0));
     if (p0>LFmax) {
-      e1.NfragCovOut[0]=int(contig.frag_depth.n[int(p0-LFmax)]);
+      e1.NfragCovOut[0]=int(contig.frag_depth.at(int(p0-LFmax)));
     } else {
       e1.NfragCovOut[0]=0;
     }
     if ((p0+LFmax)<contig.Length) {
-      e1.NfragCovOut[1]=int(contig.frag_depth.n[int(p0+LFmax)]);
+      e1.NfragCovOut[1]=int(contig.frag_depth.at(int(p0+LFmax)));
     } else {
       e1.NfragCovOut[0]=0;
     }
@@ -2829,8 +2859,7 @@ C_NNcluster2d C_SpannerSV::cullRet(C_contig  & contig, C_NNcluster2d & clu1,
   vector<C_umpair> & r1, RunControlParameters & pars) {
  
   C_NNcluster2d clu=clu1;
-  C_cluster2d_elements::iterator it;
-  C_cluster2d_element1 c1;
+  vector<int> itoss;
   //----------------------------------------------------------------------------
   // fragment length properties
   //----------------------------------------------------------------------------
@@ -2853,14 +2882,13 @@ C_NNcluster2d C_SpannerSV::cullRet(C_contig  & contig, C_NNcluster2d & clu1,
   //----------------------------------------------------------------------------
   // loop over retro clusters to identify candidate insertions
   //----------------------------------------------------------------------------
-  for ( it=clu1.cluster.begin() ; it != clu1.cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = clu.cluster[i];   
+  for (int i=0; i<clu.cluster.size(); i++) {
+    const int * inp = clu.cluster.inp(i);
     //-------------------------------------------------------------------------
     // highest start position mark start of deletion 
     //-------------------------------------------------------------------------
     // int p0 = int(c1.high+round(contig.aLR)+1);
-    int Np = c1.inp.size();
+    int Np = clu.cluster[i].N;
     //-------------------------------------------------------------------------
     // initialize cluster limits:    p5a--p5b      p3a-p3b
     //-------------------------------------------------------------------------
@@ -2871,7 +2899,7 @@ C_NNcluster2d C_SpannerSV::cullRet(C_contig  & contig, C_NNcluster2d & clu1,
     //
     // retro.resize(Np);
     for (int j=0; j<Np; j++) {
-       int k = c1.inp[j];
+       int k = inp[j];
        C_umpair r = r1[k];
        
        int p = r.read[0].pos;                // start of 5' cluster
@@ -2895,9 +2923,10 @@ C_NNcluster2d C_SpannerSV::cullRet(C_contig  & contig, C_NNcluster2d & clu1,
     }
     // remove any cluster with a constrained fragment
     if ( (Nconstrain>=NmaxConstrain)||(Np<Nmin) ){
-        clu.cluster.erase(i);
+        itoss.push_back(i);
     }
   }
+  clu.cluster.erase(itoss);
   return clu;  
 }
 
@@ -3076,14 +3105,14 @@ C_SVR1 C_SpannerSV::merge(C_SVR1 & e0, C_SVR1 & e1, C_contig  & contig) {
   // fragment coverage at and around insertion
   //----------------------------------------------------------------------------
   p0=em.pos;
-  em.NfragCov=int(contig.frag_depth.n[p0]);
+  em.NfragCov=int(contig.frag_depth.at(p0));
   if (p0>LFmax) {
-      em.NfragCovOut[0]=int(contig.frag_depth.n[p0-int(LFmax)]);
+      em.NfragCovOut[0]=int(contig.frag_depth.at(p0-int(LFmax)));
   } else {
       em.NfragCovOut[0]=0;
   }
   if ((p0+LFmax)<contig.Length) {
-      em.NfragCovOut[1]=int(contig.frag_depth.n[p0+int(LFmax)]);
+      em.NfragCovOut[1]=int(contig.frag_depth.at(p0+int(LFmax)));
   } else {
       em.NfragCovOut[0]=0;
   }
@@ -3174,11 +3203,11 @@ C_SVCF::C_SVCF() {
   Version="VCFv4.0";
   // date
   time_t rawtime;
-  struct tm * timeinfo;
+  struct tm timeinfo;
   char buffer [80];
   time ( &rawtime );
-  timeinfo = localtime ( &rawtime );
-  strftime (buffer,80,"%Y%m%d",timeinfo);
+  localtime_r ( &rawtime, &timeinfo );   // detectors run on several threads
+  strftime (buffer,80,"%Y%m%d",&timeinfo);
   Date=buffer;
   // source
   Source="Spanner ";
@@ -3416,6 +3445,7 @@ C_SV::C_SV() {
   contigName="";
   setName="";
   evt.clear(); 
+  Mask=NULL;
 }
 
 C_SV::C_SV(C_contig  & c1,  RunControlParameters & par) {
@@ -3423,6 +3453,7 @@ C_SV::C_SV(C_contig  & c1,  RunControlParameters & par) {
   typeName="x";
   contigName =c1.getContigName();
   setName =c1.setName;
+  Mask=NULL;
 }
 
 void C_SV::finalize(C_contig  & contig, C_libraries & libraries, RunControlParameters & pars) {
@@ -4114,6 +4145,7 @@ C_SVR::C_SVR() {
   contigName="";
   setName="";
   evt.clear(); 
+  Mask=NULL;
 }
 
 C_SVR::C_SVR(C_contig  & c1,  RunControlParameters & pars) {
@@ -4121,6 +4153,7 @@ C_SVR::C_SVR(C_contig  & c1,  RunControlParameters & pars) {
   contigName =c1.getContigName();
   setName =c1.setName;
   evt.clear();    
+  Mask=NULL;
 }
 
 void C_SVR::finalize(C_contig  & contig, C_libraries & libraries, RunControlParameters & pars) {
@@ -4953,6 +4986,7 @@ C_SVV::C_SVV() {
   contigName="";
   setName="";
   evt.clear(); 
+  Mask=NULL;
 }
 
 C_SVV::C_SVV(C_contig  & c1,  RunControlParameters & par) {
@@ -4960,6 +4994,7 @@ C_SVV::C_SVV(C_contig  & c1,  RunControlParameters & par) {
   contigName =c1.getContigName();
   setName =c1.setName;
   evt.clear(); 
+  Mask=NULL;
 }
 
 void C_SVV::finalize(C_contig  & contig, C_libraries & libraries, RunControlParameters & pars) {
@@ -5692,6 +5727,7 @@ C_SVX::C_SVX() {
   contigName="";
   setName="";
   evt.clear(); 
+  Mask=NULL;
 }
 
 C_SVX::C_SVX(C_contig  & c1,  RunControlParameters & par) {
@@ -5699,6 +5735,7 @@ C_SVX::C_SVX(C_contig  & c1,  RunControlParameters & par) {
   contigName =c1.getContigName();
   setName =c1.setName;
   evt.clear(); 
+  Mask=NULL;
 }
 
 void C_SVX::finalize(C_contig  & contig, C_libraries & libraries, RunControlParameters & pars) {
@@ -6139,6 +6176,117 @@ void C_SVX::print(string & outfilename)
 
 
 
+//------------------------------------------------------------------------------
+// cluster families (input columns and result) clustered on a thread pool,
+// largest first. Threads beyond one per family go to the partitions within
+// each family. Results do not depend on the thread count
+//------------------------------------------------------------------------------
+void S_clusterFamily::set(const char * t, C_NNcluster2d * c, bool s)
+{
+  type=t;
+  out=c;
+  stream=s;
+}
+
+S_clusterFamilies::S_clusterFamilies(int n)
+{
+  f.resize(n);
+  fx[0]=1;
+  fx[1]=1;
+  Nthread=1;
+}
+
+//------------------------------------------------------------------------------
+// streamed family: the clusters of C_NNcluster2d + cleanClusters, put back
+// in label order into a cluster table
+//------------------------------------------------------------------------------
+typedef pair<int, C_cluster2d_element1> T_labelCluster;
+
+static bool compareLabel(const T_labelCluster & a, const T_labelCluster & b)
+{
+  return (a.first<b.first);
+}
+
+static void streamSink(void * a, int label, const C_cluster2d_element1 & c1)
+{
+  vector<T_labelCluster> * v = reinterpret_cast<vector<T_labelCluster> *>(a);
+  v->push_back(make_pair(label, c1));
+}
+
+static void streamFamily(S_clusterFamilies * c, S_clusterFamily & f)
+{
+  const C_cluster2d_columns & x = f.x;
+  int N = x.size();
+  double dxmax=0;
+  for (int i=0; i<N; i++) {
+    double w0=x.w[0][i]*c->fx[0];
+    if (w0>dxmax) dxmax=w0;
+  }
+  vector<T_labelCluster> v;
+  C_streamCluster2d s(c->fx, dxmax, streamSink, &v);
+  for (int i=0; i<N; i++) {
+    if (!s.push(x.x[0][i], x.x[1][i], x.w[0][i], x.w[1][i], x.ip[i])) {
+      cerr << " stream clustering failed for " << f.type << endl;
+      exit(1);
+    }
+  }
+  s.finish();
+  sort(v.begin(), v.end(), compareLabel);
+  C_NNcluster2d q;
+  q.typeName=f.type;
+  q.setName=c->setName;
+  q.contigName=c->contigName;
+  for (int k=0; k<int(v.size()); k++) {
+    const C_cluster2d_element1 & e1 = v[k].second;
+    C_cluster2d_stats c1;
+    c1.label=v[k].first;
+    c1.N=e1.N;
+    c1.first=q.cluster.member.size();
+    for (int j=0; j<2; j++) {
+      c1.mean[j]=e1.mean[j];
+      c1.std[j]=e1.std[j];
+      c1.low[j]=e1.low[j];
+      c1.high[j]=e1.high[j];
+    }
+    q.cluster.c.push_back(c1);
+    q.cluster.member.insert(q.cluster.member.end(), e1.inp.begin(), e1.inp.end());
+  }
+  q.NC=q.cluster.size();
+  *f.out = q;
+}
+
+static void clusterFamily(void * a, int k)
+{
+  S_clusterFamilies * c = reinterpret_cast<S_clusterFamilies *>(a);
+  S_clusterFamily & f = c->f[c->order[k]];
+  if (f.x.size()==0) return;
+  if (f.stream) {
+    streamFamily(c, f);
+    return;
+  }
+  C_NNcluster2d q(f.x, c->fx, f.type, c->setName, c->contigName, c->Nthread);
+  //q.mergeClusters(f.x);   
+  q.cleanClusters();     
+  *f.out = q; 
+}
+
+void S_clusterFamilies::run(int Nt)
+{
+  int Nf = f.size();
+  vector<pair<int,int> > s(Nf);
+  for (int k=0; k<Nf; k++) {
+    s[k]=make_pair(-f[k].x.size(), k);
+  }
+  sort(s.begin(), s.end());
+  order.resize(Nf);
+  for (int k=0; k<Nf; k++) {
+    order[k]=s[k].second;
+  }
+  Nthread = (Nt>Nf? Nt/Nf: 1);
+  C_threadPool pool(Nt<Nf? Nt: Nf);
+  pool.run(Nf, clusterFamily, this);
+}
+
 //------------------------------------------------------------------------------
 //  Clustering class (not for Retro mob insertions) 
 //------------------------------------------------------------------------------ 
@@ -6158,15 +6306,6 @@ C_SpannerCluster::C_SpannerCluster(C_contig & c1, C_libraries & libs1, RunContro
     double Nend = c1.dangle.size();
     EndDensity = 0.5*Nend/L;
     //-------------------------------------------------------------------------
-    // select abberant pairs  -> longpairs, shortpairs, invert5, invert3
-    // length too big, too small, or flipped orientation
-    //-------------------------------------------------------------------------
-    selectPairs(c1,Qmin);
-    //-------------------------------------------------------------------------
-    //inter-chromosomal linked fragments
-    //-------------------------------------------------------------------------
-    selectCross(c1,Qmin);
-    //-------------------------------------------------------------------------
     // set neighborhood window to some scale of fragment length width 
     // for breakpoint spanning pairs
     //-------------------------------------------------------------------------
@@ -6184,98 +6323,22 @@ C_SpannerCluster::C_SpannerCluster(C_contig & c1, C_libraries & libs1, RunContro
     // double fwindow2[2] = {fwindow*,fwindow/2.0};
     double fwindow2[2] = {fwindow*1.25,fwindow/2.0};
     //-------------------------------------------------------------------------
-    // both forward mapped ~ '>' reads 5'
-    //-------------------------------------------------------------------------
-    vector<vector<double> > x2;
-    x2.clear();    
-    vector<vector<double> > wx2;
-    wx2.clear();    
-    vector<int> ip2;
-    ip2.clear();    
-
-    //cout << "clustering " << endl;
-    
-    int N =  makepairX(cross5,'F',x2,wx2,ip2);    
-    if (N>0) {
-        C_NNcluster2d q(x2, wx2, ip2, fwindow2,"cross5",c1.setName,c1.getContigName());  
-        //q.mergeClusters();   
-        q.cleanClusters();     
-        cross5c = q; 
-    }
-    //cout << "\t" << setw(15) << cross5c.typeName << "\t " << cross5c.NC << endl;
-
-    x2.clear();    
-    wx2.clear();    
-    ip2.clear();    
-
-    N =  makepairX(cross3,'R',x2,wx2,ip2);    
-    if (N>0) {
-        C_NNcluster2d q(x2, wx2, ip2, fwindow2,"cross3",c1.setName,c1.getContigName());  
-        //q.mergeClusters();   
-        q.cleanClusters();     
-        cross3c = q; 
-    }
-    //cout << "\t" << setw(15) << cross3c.typeName << "\t " << cross3c.NC << endl;
-
-    x2.clear();    
-    wx2.clear();    
-    ip2.clear();    
-
-    N =  makepairP(longpair,'-',x2,wx2,ip2);    
-    if (N>0) {
-        C_NNcluster2d q(x2, wx2, ip2, fwindow2,"longpair",c1.setName,c1.getContigName());  
-        //q.mergeClusters();   
-        q.cleanClusters();     
-        longpairc = q; 
-    }
-    //cout << "\t" << setw(15) << longpairc.typeName << "\t " << longpairc.NC << endl;
-    x2.clear();    
-    wx2.clear();    
-    ip2.clear();    
-
-    N =  makepairP(shortpair,'-',x2,wx2,ip2);
-    if (N>0) {
-        C_NNcluster2d q(x2, wx2, ip2, fwindow2,"shortpair",c1.setName,c1.getContigName());  
-        q.cleanClusters();
-        shortpairc = q; 
-    }
-    //cout << "\t" << setw(15) << shortpairc.typeName << "\t " << shortpairc.NC << endl;
-    x2.clear();
-    wx2.clear();
-    ip2.clear();    
-
-    //-------------------------------------------------------------------------
-    // inverted clusters for inversion detection
-    //-------------------------------------------------------------------------
-    
-    // double window = h.std/2.0; // original
-    // double window = 3*h.std;   // X Oct 2008
-    // double window = 4.0*h.std;    // 5 Nov 2008
-    //window = h.mean;    // 23 April  Nov 2009 - thanks to EEE et al. 
-    //pars.setClusteringLength(int(window));
-    
-
-    N =  makepairP(invert5,'>',x2,wx2,ip2);
-    if (N>0) {
-        C_NNcluster2d q(x2, wx2, ip2, fwindow2,"invert5",c1.setName,c1.getContigName());  
-        q.cleanClusters();
-        invert5c = q; 
-    }
-    //cout << "\t" << setw(15)  << "invert5" << "\t " << invert5c.NC << endl;
-    //-------------------------------------------------------------------------
-    // both reverse mapped ~ '<' reads 3'
-    //-------------------------------------------------------------------------
-    x2.clear();
-    wx2.clear();
-    ip2.clear();    
-
-    N =  makepairP(invert3,'<',x2,wx2,ip2);
-    if (N>0) {
-        C_NNcluster2d q(x2, wx2, ip2, fwindow2,"invert3",c1.setName,c1.getContigName());  
-        q.cleanClusters();
-        invert3c = q; 
+    // with ClusterCache on, selection and clusters of an earlier run with the
+    // same pairs, libraries and windows, else select and cluster here
+    //-------------------------------------------------------------------------
+    if (pars.getClusterCache()>0) {
+      string cachefile = fileStub()+SPANCLUSTERCACHE;
+      long long key = cacheKey(c1, Qmin, fwindow2);
+      if (loadCache(cachefile, key)) {
+        clampCross(c1);
+        cout << "load\t " << cachefile << endl;
+      } else {
+        selectAndCluster(c1, Qmin, fwindow2);
+        writeCache(cachefile, key);
+      }
+    } else {
+      selectAndCluster(c1, Qmin, fwindow2);
     }
-    //cout << "\t" << setw(15) << "invert3" << "\t " << invert3c.NC << endl;
 
     //-------------------------------------------------------------------------
     // set neighborhood window to some scale of fragment length  
@@ -6310,6 +6373,60 @@ C_SpannerCluster::C_SpannerCluster(C_contig & c1, C_libraries & libs1, RunContro
 
 
 
+//------------------------------------------------------------------------------
+// select aberrant pairs of each family and cluster them
+//------------------------------------------------------------------------------
+void C_SpannerCluster::selectAndCluster(C_contig & c1, int Qmin, const double fwindow2[2]) {
+    //-------------------------------------------------------------------------
+    // select abberant pairs  -> longpairs, shortpairs, invert5, invert3
+    // length too big, too small, or flipped orientation
+    //-------------------------------------------------------------------------
+    selectPairs(c1,Qmin);
+    //-------------------------------------------------------------------------
+    //inter-chromosomal linked fragments
+    //-------------------------------------------------------------------------
+    selectCross(c1,Qmin);
+    //-------------------------------------------------------------------------
+    // both forward mapped ~ '>' reads 5'
+    //-------------------------------------------------------------------------
+    S_clusterFamilies fam(6);
+    fam.fx[0]=fwindow2[0];
+    fam.fx[1]=fwindow2[1];
+    fam.setName=c1.setName;
+    fam.contigName=c1.getContigName();
+    makepairX(cross5,'F',fam.f[0].x);    
+    fam.f[0].set("cross5",&cross5c);
+    makepairX(cross3,'R',fam.f[1].x);    
+    fam.f[1].set("cross3",&cross3c);
+    makepairP(longpair,'-',fam.f[2].x);    
+    fam.f[2].set("longpair",&longpairc,true);
+    makepairP(shortpair,'-',fam.f[3].x);
+    fam.f[3].set("shortpair",&shortpairc);
+
+    //-------------------------------------------------------------------------
+    // inverted clusters for inversion detection
+    //-------------------------------------------------------------------------
+    
+    // double window = h.std/2.0; // original
+    // double window = 3*h.std;   // X Oct 2008
+    // double window = 4.0*h.std;    // 5 Nov 2008
+    //window = h.mean;    // 23 April  Nov 2009 - thanks to EEE et al. 
+    //pars.setClusteringLength(int(window));
+    
+    makepairP(invert5,'>',fam.f[4].x);
+    fam.f[4].set("invert5",&invert5c);
+    //-------------------------------------------------------------------------
+    // both reverse mapped ~ '<' reads 3'
+    //-------------------------------------------------------------------------
+    makepairP(invert3,'<',fam.f[5].x);
+    fam.f[5].set("invert3",&invert3c);
+
+    //-------------------------------------------------------------------------
+    // cluster the families concurrently
+    //-------------------------------------------------------------------------
+    fam.run(getThreadCount());
+}
+
 int C_SpannerCluster::makeDangleX(C_contig & c1, char e, vector<double> & x1) {
     //list<C_readmap>* d1;
     char S='F';
@@ -6349,7 +6466,27 @@ void C_SpannerCluster::selectPairs(C_contig & c1, int Qmin) {
   invert3.clear();        
   longpair.clear();        
   shortpair.clear();
+  vector<C_localpair> * v[4];
+  v[SPANCLSSHORT]=&shortpair;
+  v[SPANCLSLONG]=&longpair;
+  v[SPANCLSINVERT5]=&invert5;
+  v[SPANCLSINVERT3]=&invert3;
+  //----------------------------------------------------------------------------
+  // classes written at build time for these pairs and library windows
+  //----------------------------------------------------------------------------
+  if (c1.aberrant.pairsValid(libraries, N0)) {
+    for (int c=0; c<4; c++) {
+      vector<C_localpair> & a = c1.aberrant.pairs[c];
+      for (int k=0; k<int(a.size()); k++) {
+        if (int(a[k].q1)<Qmin) continue;
+        if (int(a[k].q2)<Qmin) continue;
+        v[c]->push_back(a[k]);
+      }
+    }
+    return;
+  }
   list<C_localpair>::iterator i;
+  int Nunknown=0;
   if (N0>0) {
      for(i=c1.localpairs.begin(); i != c1.localpairs.end(); ++i) {
 
@@ -6361,44 +6498,57 @@ void C_SpannerCluster::selectPairs(C_contig & c1, int Qmin) {
         if (int((*i).q1)<Qmin) continue;
         if (int((*i).q2)<Qmin) continue;
         
-        char o1=(*i).orient;  
-        //double p1= double((*i).pos);
-        int lm1=(*i).lm;  
-          
-        if (o1=='>') {
-          invert5.push_back((*i));
-        } else if (o1=='<') {
-          invert3.push_back((*i));
-        } else if (o1=='-') {
-          // library based selection (7/19/2009)
-          int LFhigh = libraries.libmap[(*i).ReadGroupCode].LMhigh;        
-          int LFlow = libraries.libmap[(*i).ReadGroupCode].LMlow;
-
-          //--------------------------------------------------------------------
-          // many libraries have significant tail extending down to LR
-          // use min of LR & LMlow; 
-          //--------------------------------------------------------------------
-          // 1000G library fix for too many dups 9/11/2009
-          // int LRmin = libraries.libmap[(*i).ReadGroupCode].LRmin;
-          // LFlow=(LFlow<LRmin? LFlow: LRmin);
-          //
-          if (lm1>LFhigh) {  //pars.getFragmentLengthHi()) {
-              longpair.push_back((*i));
-          } else if (lm1< LFlow) {  //pars.getFragmentLengthLo()) {
-              shortpair.push_back((*i));
-          } // only normal pairs remain...
-        } else {
+        //----------------------------------------------------------------------
+        // flipped orientation, or library based length selection (7/19/2009)
+        // only normal pairs remain...
+        //----------------------------------------------------------------------
+        int c = aberrantPairClass(*i, libraries);
+        if (c>=0) {
+          v[c]->push_back((*i));
+        } else if (c==-2) {
           cerr << " bad orientation in selectpairs " << (*i) << endl;
           exit(1);
+        } else if (c==-3) {
+          Nunknown++;
         } 
      }
   }
+  if (Nunknown>0) {
+    cerr << " selectpairs skipped " << Nunknown << " pairs of unknown ReadGroupCode in " << c1.getContigName() << endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+// cross pair reads with q>100 count as q=0, on the contig's cross pairs 
+// whichever way the cross pairs are selected
+//------------------------------------------------------------------------------
+void C_SpannerCluster::clampCross(C_contig & c1) {
+  list<C_crosspair>::iterator i;
+  for(i=c1.crosspairs.begin(); i != c1.crosspairs.end(); ++i) {
+    if ((*i).read[0].q>100) (*i).read[0].q=0;
+    if ((*i).read[1].q>100) (*i).read[1].q=0;
+  }
 }
 
 void C_SpannerCluster::selectCross(C_contig & c1, int Qmin) {
   int N0 =  c1.crosspairs.size();    
   cross5.clear();        
   cross3.clear();        
+  clampCross(c1);
+  if (c1.aberrant.crossValid(N0)) {
+    for (int c=0; c<2; c++) {
+      vector<C_crosspair> & a = c1.aberrant.cross[c];
+      for (int k=0; k<int(a.size()); k++) {
+        C_crosspair p = a[k];
+        if (p.read[0].q>100) p.read[0].q=0;
+        if (p.read[1].q>100) p.read[1].q=0;
+        if (int(p.read[0].q)<Qmin) continue;
+        if (int(p.read[1].q)<Qmin) continue;
+        (c==0? cross5: cross3).push_back(p);
+      }
+    }
+    return;
+  }
   list<C_crosspair>::iterator i;
   if (N0>0) {
      for(i=c1.crosspairs.begin(); i != c1.crosspairs.end(); ++i) {
@@ -6406,16 +6556,13 @@ void C_SpannerCluster::selectCross(C_contig & c1, int Qmin) {
         //----------------------------------------------------------------------
         // only high quality mapped read pairs
         //----------------------------------------------------------------------        
-        if ((*i).read[0].q>100) (*i).read[0].q=0;
-        if ((*i).read[1].q>100) (*i).read[1].q=0;
         if (int((*i).read[0].q)<Qmin) continue;
         if (int((*i).read[1].q)<Qmin) continue;
         
-        char s1=(*i).read[0].sense;  
-          
-        if (s1=='F') {
+        int c = aberrantCrossClass(*i);
+        if (c==SPANCLSCROSS5) {
           cross5.push_back((*i));
-        } else if (s1=='R') {
+        } else if (c==SPANCLSCROSS3) {
           cross3.push_back((*i));
         } else {
           cerr << " bad orientation in selectCross " << (*i) << endl;
@@ -6444,15 +6591,12 @@ bool compare_vector (vector<double> & v1 , vector<double> & v2)
 // cross span clusters
 //------------------------------------------------------------------------------
 int C_SpannerCluster::makepairX(vector<C_crosspair> & p1,  char sense
-  , vector<vector<double> >& x1, vector<vector<double> >& wx1, vector<int> & inp1) {
+  , C_cluster2d_columns & x1) {
   
   int N0 =  p1.size();    
   x1.clear();          
-  wx1.clear();          
-  inp1.clear();
             
   C_vectorDouble x4(5,0);
-  vector<double> x2(2,0);
 
   // use a list (for sorting...)  
   list<C_vectorDouble> xlist; 
@@ -6485,32 +6629,23 @@ int C_SpannerCluster::makepairX(vector<C_crosspair> & p1,  char sense
   //sort
   xlist.sort(compare_vector);
   
-  // dump into x1 and wx1
+  // dump into coordinate and window columns
+  x1.reserve(xlist.size());
   for (it=xlist.begin(); it!=xlist.end(); ++it) {
     x4=*it;
-    x2[0]=x4[0];
-    x2[1]=x4[1];
-    x1.push_back(x2);
-    x2[0]=x4[2];
-    x2[1]=x4[3];
-    wx1.push_back(x2);
-    inp1.push_back(int(round(x4[4])));
-    
+    x1.push_back(x4[0], x4[1], x4[2], x4[3], int(round(x4[4])));
   }
-  return int(x1.size());
+  return x1.size();
 }
     
 
 int C_SpannerCluster::makepairP(vector<C_localpair> & p1,  char orient
-  , vector<vector<double> >& x1, vector<vector<double> >& wx1, vector<int> & inp1) {
+  , C_cluster2d_columns & x1) {
   
   int N0 =  p1.size();    
   x1.clear();          
-  wx1.clear();          
-  inp1.clear();
             
   C_vectorDouble x4(5,0);
-  vector<double> x2(2,0);
 
   // use a list (for sorting...)  
   list<C_vectorDouble> xlist; 
@@ -6553,25 +6688,22 @@ int C_SpannerCluster::makepairP(vector<C_localpair> & p1,  char orient
   //sort
   xlist.sort(compare_vector);
   
-  // dump into x1 and wx1
+  // dump into coordinate and window columns
+  x1.reserve(xlist.size());
   for (it=xlist.begin(); it!=xlist.end(); ++it) {
     x4=*it;
-    x2[0]=x4[0];
-    x2[1]=x4[1];
-    x1.push_back(x2);
-    x2[0]=x4[2];
-    x2[1]=x4[3];
-    wx1.push_back(x2);
-    inp1.push_back(int(round(x4[4])));
-    
+    x1.push_back(x4[0], x4[1], x4[2], x4[3], int(round(x4[4])));
   }
-  return int(x1.size());
+  return x1.size();
 }
     
 
 
 
-void C_SpannerCluster::writeall() {
+//------------------------------------------------------------------------------
+// output file stub of this set and contig 
+//------------------------------------------------------------------------------
+string C_SpannerCluster::fileStub() {
   string area = pars.getOutputDir();
   int k = 1+area.find_last_of("/");
   string subdir = area.substr(k);
@@ -6592,6 +6724,11 @@ void C_SpannerCluster::writeall() {
       basename.replace(found,1,"_");
       found=basename.find("|");
   }
+  return basename;
+}
+
+void C_SpannerCluster::writeall() {
+  string basename = fileStub();
       
   if (dangle5c.cluster.size()>0) { 
       // cout << "write clusters for dangle 5' : " << sn1+contigName << endl;
@@ -6677,11 +6814,9 @@ void C_SpannerCluster::write(string & outfilename, C_NNcluster2d & cls1,
   h.write(output);
   int Ncluster = 0;
   vector<int> icluster(lpair1.size(),0);
-  C_cluster2d_element1 c1;
-  C_cluster2d_elements::iterator it;
-  for ( it=cls1.cluster.begin() ; it != cls1.cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = cls1.cluster[i];
+  for (int i=0; i<cls1.cluster.size(); i++) {
+    const C_cluster2d_stats & c1 = cls1.cluster[i];
+    const int * inp = cls1.cluster.inp(i);
     output.write(reinterpret_cast<const char *>(&c1.N), sizeof(int));
     for (int j=0; j<2; j++) {
       output.write(reinterpret_cast<const char *>(&c1.mean[j]), sizeof(double));
@@ -6690,8 +6825,8 @@ void C_SpannerCluster::write(string & outfilename, C_NNcluster2d & cls1,
       output.write(reinterpret_cast<const char *>(&c1.high[j]), sizeof(double));
     }
     Ncluster++;
-    for (int j=0; j<int(c1.inp.size()); j++) {
-      icluster[c1.inp[j]]=Ncluster;
+    for (int j=0; j<c1.N; j++) {
+      icluster[inp[j]]=Ncluster;
     }
   }
   h.typeName = "localpair";
@@ -6751,11 +6886,9 @@ void C_SpannerCluster::write(string & outfilename, C_NNcluster2d & cls1,
   h.write(output);
   int Ncluster = 0;
   vector<int> icluster(xpair1.size(),0);
-  C_cluster2d_element1 c1;
-  C_cluster2d_elements::iterator it;
-  for ( it=cls1.cluster.begin() ; it != cls1.cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = cls1.cluster[i];
+  for (int i=0; i<cls1.cluster.size(); i++) {
+    const C_cluster2d_stats & c1 = cls1.cluster[i];
+    const int * inp = cls1.cluster.inp(i);
     output.write(reinterpret_cast<const char *>(&c1.N), sizeof(int));
     for (int j=0; j<2; j++) {
       output.write(reinterpret_cast<const char *>(&c1.mean[j]), sizeof(double));
@@ -6764,8 +6897,8 @@ void C_SpannerCluster::write(string & outfilename, C_NNcluster2d & cls1,
       output.write(reinterpret_cast<const char *>(&c1.high[j]), sizeof(double));
     }
     Ncluster++;
-    for (int j=0; j<int(c1.inp.size()); j++) {
-      icluster[c1.inp[j]]=Ncluster;
+    for (int j=0; j<c1.N; j++) {
+      icluster[inp[j]]=Ncluster;
     }
   }
   
@@ -6799,6 +6932,220 @@ void C_SpannerCluster::write(string & outfilename, C_NNcluster2d & cls1,
 
 
 
+//------------------------------------------------------------------------------
+// cluster cache: one keyed header, then per family (cross5, cross3, longpair,
+// shortpair, invert5, invert3) the counts of selected pairs, clusters and 
+// members followed by their records. The key is FNV-1a over the pair records 
+// selection reads (class files when valid, else the full lists), library 
+// windows, Qmin and the clustering windows. Downstream filters (minimum 
+// cluster counts, masks, genotyping) are not in the key and may change freely
+//------------------------------------------------------------------------------
+static void fnvAdd(unsigned long long & k, const void * p, size_t n)
+{
+  const unsigned char * c = reinterpret_cast<const unsigned char *>(p);
+  for (size_t i=0; i<n; i++) {
+    k ^= c[i];
+    k *= 1099511628211ULL;
+  }
+}
+
+static S_pairRecord pairRecord(const C_localpair & p)
+{
+  S_pairRecord r;
+  r.pos = p.pos;  
+  r.lm = p.lm;  
+  r.orient = p.orient;  
+  r.len1 = p.len1;  
+  r.len2 = p.len2;  
+  r.q1 = p.q1;  
+  r.q2 = p.q2;  
+  r.mm1 = p.mm1;  
+  r.mm2 = p.mm2;  
+  r.constrain = p.constrain;  
+  r.ReadGroupCode = p.ReadGroupCode;  
+  return r;
+}
+
+static S_crossRecord crossRecord(const C_crosspair & p)
+{
+  S_crossRecord r;
+  for (int e=0; e<2; e++) {
+    r.read[e].pos = p.read[e].pos;
+    r.read[e].len = p.read[e].len;
+    r.read[e].anchor = p.read[e].anchor;
+    r.read[e].sense = p.read[e].sense;
+    r.read[e].q = p.read[e].q;
+    r.read[e].mm = p.read[e].mm;
+  }
+  r.ReadGroupCode = p.ReadGroupCode;
+  return r;
+}
+
+long long C_SpannerCluster::cacheKey(C_contig & c1, int Qmin, const double fx[2]) {
+  unsigned long long k = 14695981039346656037ULL;
+  int v = SPANCLUSTERCACHEVERSION;
+  fnvAdd(k, &v, sizeof(v));
+  fnvAdd(k, &Qmin, sizeof(Qmin));
+  fnvAdd(k, fx, 2*sizeof(double));
+  // fragment windows and mean lengths of the libraries
+  int N0 = c1.localpairs.size();
+  long long a = aberrantKey(N0, &libraries);
+  fnvAdd(k, &a, sizeof(a));
+  C_librarymap::iterator il;
+  for(il=libraries.libmap.begin(); il != libraries.libmap.end(); ++il) {
+    long long x[2] = {il->first, il->second.LM};
+    fnvAdd(k, x, sizeof(x));
+  }
+  // all local and cross pairs, whether or not class files are valid, so the
+  // key of a data set does not change once its class files are written
+  fnvAdd(k, &N0, sizeof(N0));
+  list<C_localpair>::iterator i;
+  for(i=c1.localpairs.begin(); i != c1.localpairs.end(); ++i) {
+    S_pairRecord r = pairRecord(*i);
+    fnvAdd(k, &r, sizeof(r));
+  }
+  int N1 = c1.crosspairs.size();
+  fnvAdd(k, &N1, sizeof(N1));
+  list<C_crosspair>::iterator j;
+  for(j=c1.crosspairs.begin(); j != c1.crosspairs.end(); ++j) {
+    S_crossRecord r = crossRecord(*j);
+    fnvAdd(k, &r, sizeof(r));
+  }
+  return (long long)k;
+}
+
+void C_SpannerCluster::writeCache(const string & filename, long long key) {
+  C_spanBuffer output(filename, false);
+  if (!output.ok) return;
+  C_headerSpan h;
+  h.setName = setName;
+  h.contigName = contigName;
+  h.typeName = "cluster.cache";
+  h.light = key;
+  h.reclen = 0;
+  h.N = 6;
+  string hb = h.pack();
+  output.append(hb.data(), hb.size());
+  vector<C_crosspair> * x[2] = {&cross5, &cross3};
+  vector<C_localpair> * p[4] = {&longpair, &shortpair, &invert5, &invert3};
+  C_NNcluster2d * q[6] = {&cross5c, &cross3c, &longpairc, &shortpairc, &invert5c, &invert3c};
+  for (int f=0; f<6; f++) {
+    C_cluster2d_elements & cls = q[f]->cluster;
+    int n[3];
+    n[0] = (f<2? x[f]->size(): p[f-2]->size());
+    n[1] = cls.size();
+    n[2] = cls.member.size();
+    output.append(n, sizeof(n));
+    for (int j=0; j<n[0]; j++) {
+      if (f<2) {
+        output.put(crossRecord((*x[f])[j]));
+      } else {
+        output.put(pairRecord((*p[f-2])[j]));
+      }
+    }
+    for (int j=0; j<n[1]; j++) {
+      S_clusterRecord r;
+      r.label = cls[j].label;
+      r.N = cls[j].N;
+      r.first = cls[j].first;
+      for (int d=0; d<2; d++) {
+        r.mean[d] = cls[j].mean[d];
+        r.std[d] = cls[j].std[d];
+        r.low[d] = cls[j].low[d];
+        r.high[d] = cls[j].high[d];
+      }
+      output.put(r);
+    }
+    if (n[2]>0) output.append(&cls.member[0], n[2]*sizeof(int));
+  }
+  if (output.close()) {
+    cout << "write\t " << filename << endl;
+  }
+}
+
+bool C_SpannerCluster::loadCache(const string & filename, long long key) {
+  fstream input(filename.c_str(), ios::in | ios::binary);
+  if (!input) return false;
+  C_headerSpan h(input);
+  bool ok = (!input.fail()) && (h.light==key) && (h.typeName=="cluster.cache") && (h.N==6);
+  ok = ok && (h.setName==setName) && (h.contigName==contigName);
+  const char * name[6] = {"cross5", "cross3", "longpair", "shortpair", "invert5", "invert3"};
+  vector<C_crosspair> * x[2] = {&cross5, &cross3};
+  vector<C_localpair> * p[4] = {&longpair, &shortpair, &invert5, &invert3};
+  C_NNcluster2d * q[6] = {&cross5c, &cross3c, &longpairc, &shortpairc, &invert5c, &invert3c};
+  for (int f=0; ok&&(f<6); f++) {
+    int n[3];
+    input.read(reinterpret_cast<char *>(n), sizeof(n));
+    ok = (!input.fail()) && (n[0]>=0) && (n[1]>=0) && (n[2]>=0);
+    for (int j=0; ok&&(j<n[0]); j++) {
+      if (f<2) {
+        S_crossRecord r;
+        input.read(reinterpret_cast<char *>(&r), sizeof(r));
+        C_crosspair p1;
+        for (int e=0; e<2; e++) {
+          p1.read[e].pos = r.read[e].pos;
+          p1.read[e].len = r.read[e].len;
+          p1.read[e].anchor = r.read[e].anchor;
+          p1.read[e].sense = r.read[e].sense;
+          p1.read[e].q = r.read[e].q;
+          p1.read[e].mm = r.read[e].mm;
+        }
+        p1.ReadGroupCode = r.ReadGroupCode;
+        x[f]->push_back(p1);
+      } else {
+        S_pairRecord r;
+        input.read(reinterpret_cast<char *>(&r), sizeof(r));
+        p[f-2]->push_back(C_localpair(r.pos,r.lm,0,r.len1,r.len2,
+          r.orient,r.q1,r.q2,r.mm1,r.mm2,r.constrain,r.ReadGroupCode));
+      }
+      ok = !input.fail();
+    }
+    if (!ok) break;
+    C_NNcluster2d & c = *q[f];
+    c.cluster.clear();
+    c.cluster.c.resize(n[1]);
+    for (int j=0; ok&&(j<n[1]); j++) {
+      S_clusterRecord r;
+      input.read(reinterpret_cast<char *>(&r), sizeof(r));
+      C_cluster2d_stats & c1 = c.cluster[j];
+      c1.label = r.label;
+      c1.N = r.N;
+      c1.first = r.first;
+      for (int d=0; d<2; d++) {
+        c1.mean[d] = r.mean[d];
+        c1.std[d] = r.std[d];
+        c1.low[d] = r.low[d];
+        c1.high[d] = r.high[d];
+      }
+      ok = (!input.fail()) && (c1.first>=0) && (c1.N>=0) && (c1.first+c1.N<=n[2]);
+    }
+    c.cluster.member.resize(n[2]);
+    if (ok&&(n[2]>0)) {
+      input.read(reinterpret_cast<char *>(&c.cluster.member[0]), n[2]*sizeof(int));
+      ok = !input.fail();
+    }
+    for (int j=0; ok&&(j<n[2]); j++) {
+      ok = (c.cluster.member[j]>=0)&&(c.cluster.member[j]<n[0]);
+    }
+    c.NC = c.cluster.size();
+    // named as by the clusterer when it had points to cluster 
+    if (n[0]>0) {
+      c.typeName = name[f];
+      c.setName = setName;
+      c.contigName = contigName;
+    }
+  }
+  if (!ok) {
+    cerr << "stale or damaged cluster cache: " << filename << endl;
+    for (int f=0; f<6; f++) {
+      q[f]->cluster.clear();
+      q[f]->NC = 0;
+      if (f<2) x[f]->clear(); else p[f-2]->clear();
+    }
+  }
+  return ok;
+}
+
 //------------------------------------------------------------------------------
 //  Clustering class ( for Retro mob insertions) 
 //------------------------------------------------------------------------------ 
@@ -6842,14 +7189,9 @@ C_SpannerRetroCluster::C_SpannerRetroCluster(C_contig & c1,  C_libraries & libs1
     //-------------------------------------------------------------------------
     // both forward mapped ~ '>' reads 5'
     //-------------------------------------------------------------------------
-    vector<vector<double> > x2;
-    x2.clear();    
-    vector<vector<double> > wx2;
-    wx2.clear();    
-    vector<int> ip2;
-    ip2.clear();    
+    C_cluster2d_columns x2;
     
-    int N =  makepairP(e5,'F',x2,wx2,ip2);    
+    int N =  makepairP(e5,'F',x2);    
     /*
     double window = pars.getFragmentLengthHi();     // 27 April 2009
     pars.setClusteringLength(int(window));
@@ -6861,8 +7203,8 @@ C_SpannerRetroCluster::C_SpannerRetroCluster(C_contig & c1,  C_libraries & libs1
     int N =  makeRetroX(e5,'F',x1);    
     */
     if (N>0) {
-        C_NNcluster2d q(x2, wx2, ip2, fwindow2,"e5pair",c1.setName,c1.getContigName());  
-        //q.mergeClusters();   
+        C_NNcluster2d q(x2, fwindow2,"e5pair",c1.setName,c1.getContigName(),getThreadCount());  
+        //q.mergeClusters(x2);   
         q.cleanClusters();     
 
         e5c = q; 
@@ -6872,12 +7214,10 @@ C_SpannerRetroCluster::C_SpannerRetroCluster(C_contig & c1,  C_libraries & libs1
     // cluster r3's (F UM fragments with element)
     //-------------------------------------------------------------------------
     x2.clear();    
-    wx2.clear();    
-    ip2.clear();    
-    N =  makepairP(e3,'R',x2,wx2,ip2);    
+    N =  makepairP(e3,'R',x2);    
     //N =  makeRetroX(e3,'R',x1);    
     if (N>0) {
-         C_NNcluster2d q(x2, wx2, ip2, fwindow2,"e3pair",c1.setName,c1.getContigName());  
+         C_NNcluster2d q(x2, fwindow2,"e3pair",c1.setName,c1.getContigName(),getThreadCount());  
         //C_NNcluster1d q(x1, window,"e5pair",c1.setName,c1.getContigName());  
         q.cleanClusters();     
         e3c = q; 
@@ -6982,15 +7322,12 @@ void C_SpannerRetroCluster::selectRetro(C_contig & c1,int Qmin) {
 //  umpair to simple vector function 
 //------------------------------------------------------------------------------
 int C_SpannerRetroCluster::makepairP(vector<C_umpair> & p1,  char orient
-  , vector<vector<double> >& x1, vector<vector<double> >& wx1, vector<int> & inp1) {
+  , C_cluster2d_columns & x1) {
   
   int N0 =  p1.size();    
   x1.clear();          
-  wx1.clear();          
-  inp1.clear();
             
   C_vectorDouble x4(5,0);
-  vector<double> x2(2,0);
 
   // use a list (for sorting...)  
   list<C_vectorDouble> xlist; 
@@ -7045,19 +7382,13 @@ int C_SpannerRetroCluster::makepairP(vector<C_umpair> & p1,  char orient
   //sort
   xlist.sort(compare_vector);
   
-  // dump into x1 and wx1
+  // dump into coordinate and window columns
+  x1.reserve(xlist.size());
   for (it=xlist.begin(); it!=xlist.end(); ++it) {
     x4=*it;
-    x2[0]=x4[0];
-    x2[1]=x4[1];
-    x1.push_back(x2);
-    x2[0]=x4[2];
-    x2[1]=x4[3];
-    wx1.push_back(x2);
-    inp1.push_back(int(round(x4[4])));
-    
+    x1.push_back(x4[0], x4[1], x4[2], x4[3], int(round(x4[4])));
   }
-  return int(x1.size());
+  return x1.size();
 }
 
 //------------------------------------------------------------------------------
@@ -7145,19 +7476,17 @@ void C_SpannerRetroCluster::write(string & outfilename, C_NNcluster2d & cls1,
   h.write(output);
   int Ncluster = 0;
   vector<int> icluster(retro1.size(),0);
-  C_cluster2d_element1 c1;
-  C_cluster2d_elements::iterator it;
-  for ( it=cls1.cluster.begin() ; it != cls1.cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = cls1.cluster[i];
+  for (int i=0; i<cls1.cluster.size(); i++) {
+    const C_cluster2d_stats & c1 = cls1.cluster[i];
+    const int * inp = cls1.cluster.inp(i);
     output.write(reinterpret_cast<const char *>(&c1.N), sizeof(int));
     output.write(reinterpret_cast<const char *>(&c1.mean[0]), sizeof(double));
     output.write(reinterpret_cast<const char *>(&c1.std[0]), sizeof(double));
     output.write(reinterpret_cast<const char *>(&c1.low[0]), sizeof(double));
     output.write(reinterpret_cast<const char *>(&c1.high[0]), sizeof(double));
     Ncluster++;
-    for (int j=0; j<int(c1.inp.size()); j++) {
-      icluster[c1.inp[j]]=Ncluster;
+    for (int j=0; j<c1.N; j++) {
+      icluster[inp[j]]=Ncluster;
     }
   }
   h.typeName = "umpair";
@@ -7201,20 +7530,16 @@ void C_SpannerRetroCluster::write(string & outfilename, C_NNcluster2d & cls1,
 }
 
 
-int C_SpannerRetroCluster::Mask(C_BedChr & mask, int LMmax) {
+int C_SpannerRetroCluster::Mask(const C_BedChr & mask, int LMmax) {
 
   // set start of mask loop 
   int im0=0;
   // 
-  C_cluster2d_element1 c1;
-  C_cluster2d_elements::iterator it;
   vector<int> itoss;
   
   
   // 5' clusters
-  for ( it=e5c.cluster.begin() ; it != e5c.cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = e5c.cluster[i];
+  for (int i=0; i<e5c.cluster.size(); i++) {
     //int pc1 = int(e5c.cluster[i].high[0]);
     int pc1 = int(e5c.cluster[i].mean[0]);
     int pc2 = pc1+LMmax;
@@ -7237,19 +7562,14 @@ int C_SpannerRetroCluster::Mask(C_BedChr & mask, int LMmax) {
   }
   
   // remove masked 5' clusters
-  int NT = itoss.size();
-  for (int i=0; i<NT; i++) {
-     e5c.cluster.erase(itoss[i]);
-  }
+  e5c.cluster.erase(itoss);
   int NC5 = e5c.cluster.size();
 
 
   // 3' clusters
   im0=0;
   itoss.clear();
-  for ( it=e3c.cluster.begin() ; it != e3c.cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = e3c.cluster[i];
+  for (int i=0; i<e3c.cluster.size(); i++) {
     //int pc2 = int(e3c.cluster[i].low[0]);
     int pc2 = int(e3c.cluster[i].mean[0]);
     int pc1 = pc2-LMmax;
@@ -7270,10 +7590,7 @@ int C_SpannerRetroCluster::Mask(C_BedChr & mask, int LMmax) {
       im0=im; 
     }
   }
-  NT = itoss.size();
-  for (int i=0; i<NT; i++) {
-     e3c.cluster.erase(itoss[i]);
-  }
+  e3c.cluster.erase(itoss);
   int NC3 = e5c.cluster.size();
 
   return (NC3+NC5);
@@ -7299,13 +7616,8 @@ C_SVcoverage1::C_SVcoverage1(C_contig & contig, int P0, int P1,C_NominalCov & nc
     p1 = P1;               // end base position
     Nrepeat=0;             // number of masked start sites in region
     
-    N = 0;    
-    size_t Lrn= contig.repeat.n.size(); 
-
-    for (int i=p0; i<=p1; i++) {
-      N +=int(contig.read_start.n[i]); 
-      if (i<int(Lrn)) Nrepeat+=int(contig.repeat.n[i]>0); 
-    }
+    N = contig.countStarts(p0,p1);
+    Nrepeat = contig.repeatMask.count(p0,p1);
     Nsite=p1-p0+1-Nrepeat;    // number of available start sites in region
     //int totRepeats = int(contig.repeat.Stats.N*contig.repeat.Stats.mean);
     int totSites = contig.Length - int(contig.totalRepeatBases)-int(contig.totalNoCovBases);
@@ -7430,14 +7742,8 @@ C_NominalCov::C_NominalCov(C_set & set, vector<int> & nuv)  {
       //C_SVcoverage1 sc1(set.contig[cn[c]], p0, p1, *this);
       // do the count and Ecount by hand here....
       //------------------------------------------------------------------------
-      double count = 0;
-      double repeat =0;
-      size_t Lrn= set.contig[cn[c]].repeat.n.size(); 
-      for (int i=p0; i<=p1; i++) {
-        count +=int(set.contig[cn[c]].read_start.n[i]); 
-        if (i>=int(Lrn)) continue; 
-        repeat+=int(set.contig[cn[c]].repeat.n[i]>0); 
-      }      
+      double count = set.contig[cn[c]].countStarts(p0,p1);
+      double repeat = set.contig[cn[c]].repeatMask.count(p0,p1);
       double Nsite=p1-p0+1-repeat;    // number of available start sites in region
       //int totRepeats = int(contig.repeat.Stats.N*contig.repeat.Stats.mean);
       int totSites = set.contig[cn[c]].Length - int(set.contig[cn[c]].totalRepeatBases)-int(set.contig[cn[c]].totalNoCovBases);
@@ -202,7 +202,7 @@ class C_SV {
     void genotype(C_contig  &, C_libraries &, RunControlParameters &);
     C_SVCF SVCF; 
     vector<string> samples;
-    C_BedChr Mask;      
+    const C_BedChr * Mask;    // mask rows from bedRegistry() (not owned)
         
 }; 
 
@@ -275,7 +275,7 @@ class C_SVR {
     string contigName;
     string setName;    
     vector<string> samples;
-    C_BedChr Mask;       
+    const C_BedChr * Mask;    // mask rows from bedRegistry() (not owned)
 }; 
 
 //-----------------------------------------------------------------------------
@@ -340,7 +340,7 @@ class C_SVV {
     void genotype(C_contig  &, C_libraries &, RunControlParameters &);
     C_SVCF SVCF; 
     vector<string> samples;
-    C_BedChr Mask;      
+    const C_BedChr * Mask;    // mask rows from bedRegistry() (not owned)
 }; 
 
 //-----------------------------------------------------------------------------
@@ -410,11 +410,50 @@ class C_SVX {
     string contigName;
     string setName; 
     vector<string> samples;
-    C_BedChr Mask;   
+    const C_BedChr * Mask;    // mask rows from bedRegistry() (not owned)
 }; 
 
 
 
+//-----------------------------------------------------------------------------
+// one family of pair clusters: selected points in, clusters out
+//-----------------------------------------------------------------------------
+struct S_clusterFamily {
+  void set(const char *, C_NNcluster2d *, bool=false);
+  C_cluster2d_columns x;
+  string type;
+  C_NNcluster2d * out;
+  bool stream;                    // cluster with C_streamCluster2d
+};
+
+struct S_clusterFamilies {
+  S_clusterFamilies(int);
+  void run(int);                  // cluster all families on this many threads
+  vector<S_clusterFamily> f;
+  vector<int> order;              // largest family first
+  double fx[2];
+  string setName;
+  string contigName;
+  int Nthread;                    // threads within each family
+};
+
+//-----------------------------------------------------------------------------
+// cluster cache: selected pairs, cluster table and members of each family,
+// each section keyed by a hash of the pair inputs and clustering parameters
+//-----------------------------------------------------------------------------
+const string SPANCLUSTERCACHE=".cluster.cache.span";
+const int SPANCLUSTERCACHEVERSION=2;
+
+struct S_clusterRecord {
+  int label;
+  int N;
+  int first;
+  double mean[2]; 
+  double std[2];  
+  double low[2]; 
+  double high[2]; 
+} __attribute__((packed));
+
 //-----------------------------------------------------------------------------
 // clustering
 //-----------------------------------------------------------------------------
@@ -461,12 +500,16 @@ class C_SpannerCluster {
     int makeDangleX(C_contig &, char, vector<double> & );
     void selectPairs(C_contig &, int );    
     void selectCross(C_contig &, int );    
-    int makepairP(vector<C_localpair> &, char , vector<vector<double> > &, 
-        vector<vector<double> > &, vector<int> &);
-     int makepairX(vector<C_crosspair> &, char , vector<vector<double> > &, 
-        vector<vector<double> > &, vector<int> &);
+    void clampCross(C_contig &);
+    int makepairP(vector<C_localpair> &, char , C_cluster2d_columns &);
+     int makepairX(vector<C_crosspair> &, char , C_cluster2d_columns &);
     void write(string &, C_NNcluster2d &, vector<C_localpair> &);
     void write(string &, C_NNcluster2d &, vector<C_crosspair> &);
+    void selectAndCluster(C_contig &, int, const double[2]);
+    string fileStub();
+    long long cacheKey(C_contig &, int, const double[2]);
+    bool loadCache(const string &, long long);
+    void writeCache(const string &, long long);
     int L;
     double PairDensity;
     double EndDensity;
@@ -482,7 +525,7 @@ class C_SpannerRetroCluster {
     C_SpannerRetroCluster();
     C_SpannerRetroCluster(C_contig &,  C_libraries & libs1, RunControlParameters &, int, string &);    
     void writeall();
-    int Mask(C_BedChr &, int);
+    int Mask(const C_BedChr &, int);
     string typeName;
     string contigName;
     string setName;       
@@ -509,8 +552,7 @@ class C_SpannerRetroCluster {
     // obsolete Aug 2009
     int makeRetroX(vector<C_umpair> &, char, vector<double> & );
     // with lib info aug 2009
-    int makepairP(vector<C_umpair> &, char , vector<vector<double> > &, 
-        vector<vector<double> > &, vector<int> &);
+    int makepairP(vector<C_umpair> &, char , C_cluster2d_columns &);
 
     RunControlParameters pars;    
 }; 
@@ -529,6 +571,21 @@ class C_retroElements {
 //-----------------------------------------------------------------------------
 // Spanner SV detection main class
 //-----------------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+// per-contig detection tasks (set index and contig name), largest first
+//-----------------------------------------------------------------------------
+struct S_detectTask {
+  int iset;
+  string name;
+};
+
+struct S_detectTasks {
+  C_pairedfiles * data;
+  RunControlParameters * pars;
+  vector<S_detectTask> t;
+  vector<int> order;              // task order, largest contig first
+};
+
 class C_SpannerSV {
   friend ostream &operator<<(ostream &, const C_SpannerSV &);
   public:
@@ -543,6 +600,8 @@ class C_SpannerSV {
     C_SVR ret;
     C_SVX crx;
   private:
+    void detect(C_pairedfiles &, int, string &, RunControlParameters &);
+    static void detectTask(void *, int);
     int findDel(C_contig  &, C_SpannerCluster &, RunControlParameters &);
     C_SV1 merge(C_SV1 &, C_SV1 &, C_contig &, RunControlParameters &, int);
     int findDup(C_contig  &, C_SpannerCluster &, RunControlParameters &);
@@ -22,6 +22,7 @@
 #include "PairedData.h"
 #include "SpanDet.h"
 #include "DepthCnvDet.h"
+#include "mergeSpan.h"
 #include "SpannerVersion.h"
 
 // uses
@@ -46,6 +47,15 @@ int main (int argc, char *  argv[]) {    //int main (int argc, char * const argv
   }
   cout << endl;
   //----------------------------------------------------------------------------
+  // "Spanner merge ..." : merge lane span sets (-i dir1,dir2,...) into one set
+  //----------------------------------------------------------------------------
+  bool merge = ((argc>1)&&(string(argv[1])=="merge"));
+  if (merge) {
+    argv[1]=argv[0];
+    argv++;
+    argc--;
+  }
+  //----------------------------------------------------------------------------
   // Create new CmdLine object
   //----------------------------------------------------------------------------
   CmdLine cmd("Command line options for Spanner", ' ', V );    
@@ -138,6 +148,24 @@ int main (int argc, char *  argv[]) {    //int main (int argc, char * const argv
 	int BamZADefault=0;
   ValueArg<int> cmd_BamZA("Z", "ZR", "bam access mode (1=ZAtag, 2=SortedByReadName) ", false,BamZADefault,"int",cmd);
 
+	// span output format 
+	int SpanFormatDefault=1;
+  ValueArg<int> cmd_spanformat("V", "spanformat", "span output format (1=flat records, 2=block-indexed coded columns)", false,SpanFormatDefault,"int",cmd);
+
+	// single-file span container per set 
+	int SpanPackDefault=0;
+  ValueArg<int> cmd_spanpack("K", "spanpack", "write span files of a set into one container (0=off, 1=on)", false,SpanPackDefault,"int",cmd);
+
+	// selected detectors 
+  ValueArg<string> cmd_only("O", "only", "run only these detectors (del,dup,inv,cross,ret)", false, "", "string", cmd);
+
+	// reuse selected pairs & clusters 
+	int ClusterCacheDefault=0;
+  ValueArg<int> cmd_clustercache("C", "clustercache", "reuse selected pairs & clusters of an earlier run (0=off, 1=on)", false,ClusterCacheDefault,"int",cmd);
+
+	// worker threads 
+  ValueArg<int> cmd_threads("T", "threads", "number of threads (1=serial, 0=online cores)", false, 1, "int", cmd);
+
 
   //----------------------------------------------------------------------------
   // parse command line and catch possible errors
@@ -194,6 +222,23 @@ int main (int argc, char *  argv[]) {    //int main (int argc, char * const argv
   //----------------------------------------------------------------------------
   int BamZA = cmd_BamZA.getValue();
 
+  //----------------------------------------------------------------------------
+	// span output format & container
+  //----------------------------------------------------------------------------
+  int SpanFormat = cmd_spanformat.getValue();
+  int SpanPack = cmd_spanpack.getValue();
+
+  //----------------------------------------------------------------------------
+	// selected detectors
+  //----------------------------------------------------------------------------
+  string detectOnly = cmd_only.getValue();
+  int ClusterCache = cmd_clustercache.getValue();
+
+  //----------------------------------------------------------------------------
+	// threads for building, clustering and per-contig detection
+  //----------------------------------------------------------------------------
+  setThreadCount(cmd_threads.getValue());
+
   //----------------------------------------------------------------------------
   // build options
   //----------------------------------------------------------------------------
@@ -253,6 +298,26 @@ int main (int argc, char *  argv[]) {    //int main (int argc, char * const argv
 	if (BamZA!=BamZADefault) {
     pars.setBamZA(BamZA);
   }
+
+	//----------------------------------------------------------------------------
+	//overide SpanFormat, SpanPack if present on command line
+	//----------------------------------------------------------------------------
+	if (SpanFormat!=SpanFormatDefault) {
+    pars.setSpanFormat(SpanFormat);
+  }
+	if (SpanPack!=SpanPackDefault) {
+    pars.setSpanPack(SpanPack);
+  }
+
+	//----------------------------------------------------------------------------
+	//overide DetectOnly, ClusterCache if present on command line
+	//----------------------------------------------------------------------------
+	if (detectOnly.length()>0) {
+    pars.setDetectOnly(detectOnly);
+  }
+	if (ClusterCache!=ClusterCacheDefault) {
+    pars.setClusterCache(ClusterCache);
+  }
 	
 	//set Qmin to zero for build 
   /*
@@ -325,6 +390,17 @@ int main (int argc, char *  argv[]) {    //int main (int argc, char * const argv
   }
 
 
+  //----------------------------------------------------------------------------
+  // merge lanes/runs into one sorted, de-duplicated span set
+  //----------------------------------------------------------------------------
+  if (merge) {
+    C_spanMerge m(in, pars);
+    if (dbg>0) {
+      clog << "Spanner merge completed." << endl;
+    }
+    return (m.ok? 0: 1);
+  }
+
   //----------------------------------------------------------------------------
   // input paired-end read data
   //----------------------------------------------------------------------------
@@ -0,0 +1,440 @@
+/*
+ *  blockSpan.cpp
+ *  Spanner
+ *
+ *  block-indexed columnar span file layout (header versions 208, 209)
+ *
+ */
+
+#include "blockSpan.h"
+
+// add a prototype for the Ariya Hidayat's FastLZ library
+extern "C" {
+  int fastlz_compress(const void* input, int length, void* output);
+  int fastlz_decompress(const void* input, int length, void* output, int maxout);
+}
+
+//------------------------------------------------------------------------------
+// block index entry
+//------------------------------------------------------------------------------
+C_spanBlock1::C_spanBlock1() {
+  minpos=INT_MAX;
+  maxpos=INT_MIN;
+  offset=0;
+  count=0;
+  nraw=0;
+  nc=0;
+}
+
+ostream &operator<<(ostream &output, const C_spanBlock1 & b)
+{
+  output << b.minpos << "\t " << b.maxpos << "\t " << b.offset << "\t " << b.count;
+  output << "\t " << b.nraw << "\t " << b.nc;
+  return output;
+}
+
+//------------------------------------------------------------------------------
+// value dictionary
+//------------------------------------------------------------------------------
+unsigned int C_spanDictionary::lookup(long long x)
+{
+  map<long long, unsigned int>::iterator i = code.find(x);
+  if (i!=code.end()) return i->second;
+  unsigned int c = value.size();
+  code[x]=c;
+  value.push_back(x);
+  return c;
+}
+
+void C_spanDictionary::clear()
+{
+  value.clear();
+  code.clear();
+}
+
+//------------------------------------------------------------------------------
+// block index
+//------------------------------------------------------------------------------
+bool C_spanBlockIndex::write(fstream & output)
+{
+  if (!output.is_open()) {
+      cerr << "Unable to write block index into output file " << endl;
+      return false;
+  }
+  long long offset = output.tellp();
+  int nb = block.size();
+  output.write(reinterpret_cast<const char *>(&nb), sizeof(int));
+  for (int i=0; i<nb; i++) {
+    output.write(reinterpret_cast<const char *>(&block[i].minpos), sizeof(int));
+    output.write(reinterpret_cast<const char *>(&block[i].maxpos), sizeof(int));
+    output.write(reinterpret_cast<const char *>(&block[i].offset), sizeof(long long));
+    output.write(reinterpret_cast<const char *>(&block[i].count), sizeof(int));
+    output.write(reinterpret_cast<const char *>(&block[i].nraw), sizeof(int));
+    output.write(reinterpret_cast<const char *>(&block[i].nc), sizeof(int));
+  }
+  if (coded) {
+    int nv = dict.value.size();
+    output.write(reinterpret_cast<const char *>(&nv), sizeof(int));
+    if (nv>0) output.write(reinterpret_cast<const char *>(&dict.value[0]), nv*sizeof(long long));
+  }
+  output.write(reinterpret_cast<const char *>(&offset), sizeof(long long));
+  return true;
+}
+
+bool C_spanBlockIndex::read(istream & input)
+{
+  block.clear();
+  long long offset = 0;
+  input.seekg(-int(sizeof(long long)), ios::end);
+  input.read(reinterpret_cast < char * > (&offset), sizeof(long long));
+  if (!input) {
+      cerr << "Unable to read block index offset " << endl;
+      return false;
+  }
+  input.seekg(offset, ios::beg);
+  int nb = 0;
+  input.read(reinterpret_cast < char * > (&nb), sizeof(int));
+  if ((!input)||(nb<0)) {
+      cerr << "bad block index " << nb << endl;
+      return false;
+  }
+  block.resize(nb);
+  for (int i=0; i<nb; i++) {
+    input.read(reinterpret_cast < char * > (&block[i].minpos), sizeof(int));
+    input.read(reinterpret_cast < char * > (&block[i].maxpos), sizeof(int));
+    input.read(reinterpret_cast < char * > (&block[i].offset), sizeof(long long));
+    input.read(reinterpret_cast < char * > (&block[i].count), sizeof(int));
+    input.read(reinterpret_cast < char * > (&block[i].nraw), sizeof(int));
+    input.read(reinterpret_cast < char * > (&block[i].nc), sizeof(int));
+  }
+  dict.clear();
+  if (coded) {
+    int nv = 0;
+    input.read(reinterpret_cast < char * > (&nv), sizeof(int));
+    if ((!input)||(nv<0)) {
+      cerr << "bad span dictionary " << nv << endl;
+      return false;
+    }
+    dict.value.resize(nv);
+    if (nv>0) input.read(reinterpret_cast < char * > (&dict.value[0]), nv*sizeof(long long));
+  }
+  return bool(input);
+}
+
+// list of blocks with key positions overlapping [start,end]
+vector<int> C_spanBlockIndex::overlap(int start, int end) const
+{
+  vector<int> ib;
+  for (int i=0; i<int(block.size()); i++) {
+    if ((block[i].maxpos>=start)&&(block[i].minpos<=end)) {
+      ib.push_back(i);
+    }
+  }
+  return ib;
+}
+
+unsigned int C_spanBlockIndex::count() const
+{
+  unsigned int n=0;
+  for (int i=0; i<int(block.size()); i++) {
+    n+=block[i].count;
+  }
+  return n;
+}
+
+ostream &operator<<(ostream &output, const C_spanBlockIndex & x)
+{
+  output << "blocks:\t " << x.block.size() << "\t records:\t " << x.count() << endl;
+  for (int i=0; i<int(x.block.size()); i++) {
+    output << " " << i << "\t " << x.block[i] << endl;
+  }
+  return output;
+}
+
+//------------------------------------------------------------------------------
+// block columns
+//------------------------------------------------------------------------------
+C_spanColumns::C_spanColumns(int n) {
+  Ncol=n;
+  col.resize(Ncol);
+  start.resize(Ncol,0);
+  codec.resize(Ncol,SPANCODEFOR);
+  width.resize(Ncol,1);
+  sign.resize(Ncol,0);
+}
+
+void C_spanColumns::encode(int c, char codec1) {
+  codec[c]=codec1;
+}
+
+void C_spanColumns::clear() {
+  for (int c=0; c<Ncol; c++) {
+    col[c].clear();
+  }
+}
+
+// block layout: Ncol column sizes followed by the column bytes
+int C_spanColumns::pack(vector<char> & b) const
+{
+  int nb = Ncol*sizeof(int);
+  for (int c=0; c<Ncol; c++) nb+=col[c].size();
+  b.resize(nb);
+  char * p = &b[0];
+  for (int c=0; c<Ncol; c++) {
+    int n1 = col[c].size();
+    memcpy(p, &n1, sizeof(int));
+    p+=sizeof(int);
+  }
+  for (int c=0; c<Ncol; c++) {
+    if (col[c].size()>0) {
+      memcpy(p, &col[c][0], col[c].size());
+      p+=col[c].size();
+    }
+  }
+  return nb;
+}
+
+bool C_spanColumns::unpack(const char * b, int nb)
+{
+  if (nb<int(Ncol*sizeof(int))) return false;
+  raw.assign(b, b+nb);
+  size_t s = Ncol*sizeof(int);
+  for (int c=0; c<Ncol; c++) {
+    int n1;
+    memcpy(&n1, &raw[c*sizeof(int)], sizeof(int));
+    start[c]=s;
+    s+=n1;
+  }
+  return (s==size_t(nb));
+}
+
+//------------------------------------------------------------------------------
+// coded columns
+//------------------------------------------------------------------------------
+// bits needed for values 0..r
+static int bitWidth(unsigned long long r)
+{
+  int b=0;
+  while (r>0) {
+    b++;
+    r>>=1;
+  }
+  return b;
+}
+
+static void putBits(vector<unsigned long long> & w, size_t p, int bits, unsigned long long x)
+{
+  size_t k = p>>6;
+  int s = p&63;
+  w[k] |= x<<s;
+  if (s+bits>64) w[k+1] |= x>>(64-s);
+}
+
+static unsigned long long getBits(const vector<unsigned long long> & w, size_t p, int bits)
+{
+  size_t k = p>>6;
+  int s = p&63;
+  unsigned long long x = w[k]>>s;
+  if (s+bits>64) x |= w[k+1]<<(64-s);
+  if (bits<64) x &= (1ULL<<bits)-1;
+  return x;
+}
+
+// element i of column c, sign extended for signed element types
+long long C_spanColumns::value(int c, int i) const
+{
+  const char * b = &col[c][i*width[c]];
+  switch (width[c]) {
+    case 1:
+      return (sign[c]? (long long)(*reinterpret_cast<const signed char *>(b)):
+                       (long long)(*reinterpret_cast<const unsigned char *>(b)));
+    case 2: {
+      short x; memcpy(&x, b, 2);
+      return (sign[c]? (long long)x: (long long)(unsigned short)x);
+    }
+    case 4: {
+      int x; memcpy(&x, b, 4);
+      return (sign[c]? (long long)x: (long long)(unsigned int)x);
+    }
+    default: {
+      long long x; memcpy(&x, b, sizeof(long long));
+      return x;
+    }
+  }
+}
+
+int C_spanColumns::packCoded(vector<char> & b, C_spanDictionary & dict) const
+{
+  const int nh = 3*sizeof(char)+sizeof(int)+2*sizeof(long long);
+  b.clear();
+  vector<long long> x;
+  vector<unsigned long long> w;
+  for (int c=0; c<Ncol; c++) {
+    int n = col[c].size()/width[c];
+    x.resize(n);
+    long long first = 0;
+    for (int i=0; i<n; i++) {
+      x[i] = value(c,i);
+    }
+    if ((codec[c]==SPANCODEDELTA)&&(n>0)) {
+      first = x[0];
+      for (int i=n-1; i>0; i--) x[i]-=x[i-1];
+      x[0]=0;
+    } else if (codec[c]==SPANCODEDICT) {
+      for (int i=0; i<n; i++) x[i]=dict.lookup(x[i]);
+    }
+    long long base = 0, top = 0;
+    if (n>0) {
+      base = x[0];
+      top = x[0];
+      for (int i=1; i<n; i++) {
+        if (x[i]<base) base=x[i];
+        if (x[i]>top) top=x[i];
+      }
+    }
+    int bits = bitWidth((unsigned long long)(top)-(unsigned long long)(base));
+    w.assign((size_t(n)*bits+63)/64, 0);
+    if (bits>0) {
+      for (int i=0; i<n; i++) {
+        putBits(w, size_t(i)*bits, bits, (unsigned long long)(x[i])-(unsigned long long)(base));
+      }
+    }
+    size_t p = b.size();
+    b.resize(p+nh+w.size()*sizeof(long long));
+    char * q = &b[p];
+    q[0]=codec[c];
+    q[1]=width[c];
+    q[2]=char(bits);
+    q+=3;
+    memcpy(q, &n, sizeof(int));
+    q+=sizeof(int);
+    memcpy(q, &first, sizeof(long long));
+    q+=sizeof(long long);
+    memcpy(q, &base, sizeof(long long));
+    q+=sizeof(long long);
+    if (w.size()>0) memcpy(q, &w[0], w.size()*sizeof(long long));
+  }
+  return b.size();
+}
+
+// decode columns back to their fixed width elements; trailing bytes (padding
+// of tiny blocks) are ignored
+bool C_spanColumns::unpackCoded(const char * b, int nb, const C_spanDictionary & dict)
+{
+  const int nh = 3*sizeof(char)+sizeof(int)+2*sizeof(long long);
+  raw.clear();
+  vector<unsigned long long> w;
+  size_t p = 0;
+  for (int c=0; c<Ncol; c++) {
+    if (p+nh>size_t(nb)) return false;
+    char codec1 = b[p];
+    int w1 = b[p+1];
+    int bits = b[p+2];
+    int n;
+    long long first, base;
+    memcpy(&n, b+p+3, sizeof(int));
+    memcpy(&first, b+p+3+sizeof(int), sizeof(long long));
+    memcpy(&base, b+p+3+sizeof(int)+sizeof(long long), sizeof(long long));
+    p+=nh;
+    if ((n<0)||(bits<0)||(bits>64)||(w1<1)||(w1>int(sizeof(long long)))) return false;
+    size_t nw = (size_t(n)*bits+63)/64;
+    if (p+nw*sizeof(long long)>size_t(nb)) return false;
+    w.resize(nw);
+    if (nw>0) memcpy(&w[0], b+p, nw*sizeof(long long));
+    p+=nw*sizeof(long long);
+    start[c]=raw.size();
+    raw.resize(raw.size()+size_t(n)*w1);
+    char * r = &raw[0]+start[c];
+    long long v = first;
+    for (int i=0; i<n; i++) {
+      long long x = (long long)((unsigned long long)(base)+(bits>0? getBits(w, size_t(i)*bits, bits): 0));
+      if (codec1==SPANCODEDELTA) {
+        if (i>0) v+=x;
+      } else if (codec1==SPANCODEDICT) {
+        if ((x<0)||(x>=(long long)(dict.value.size()))) return false;
+        v = dict.value[x];
+      } else {
+        v = x;
+      }
+      // little endian: low w1 bytes hold the element
+      memcpy(r+size_t(i)*w1, &v, w1);
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// block writer
+//------------------------------------------------------------------------------
+C_spanBlockWriter::C_spanBlockWriter(fstream & out1, int Ncol, bool coded) : cols(Ncol), output(out1) {
+  index.coded=coded;
+}
+
+void C_spanBlockWriter::add(int pos)
+{
+  if (pos<b1.minpos) b1.minpos=pos;
+  if (pos>b1.maxpos) b1.maxpos=pos;
+  b1.count++;
+  if (int(b1.count)>=SPANBLOCKSIZE) flush();
+}
+
+void C_spanBlockWriter::flush()
+{
+  if (b1.count==0) return;
+  int nraw = (index.coded? cols.packCoded(rbuf, index.dict): cols.pack(rbuf));
+  // fastlz minimum input buffer is 16 bytes
+  if (nraw<16) rbuf.resize(16,0);
+  cbuf.resize(rbuf.size()+rbuf.size()/16+128);
+  int nc = fastlz_compress(&rbuf[0], rbuf.size(), &cbuf[0]);
+  b1.offset = output.tellp();
+  b1.nraw = rbuf.size();
+  b1.nc = nc;
+  output.write(&cbuf[0], nc);
+  index.block.push_back(b1);
+  cols.clear();
+  b1 = C_spanBlock1();
+}
+
+void C_spanBlockWriter::finish()
+{
+  flush();
+  index.write(output);
+}
+
+//------------------------------------------------------------------------------
+// block reader
+//------------------------------------------------------------------------------
+C_spanBlockReader::C_spanBlockReader(istream & in1, bool coded) : input(in1) {
+  index.coded=coded;
+  ok = index.read(input);
+}
+
+bool C_spanBlockReader::readBlock(int i, C_spanColumns & c1)
+{
+  if ((i<0)||(i>=int(index.block.size()))) return false;
+  C_spanBlock1 & b = index.block[i];
+  cbuf.resize(b.nc);
+  rbuf.resize(b.nraw);
+  input.seekg(b.offset, ios::beg);
+  input.read(&cbuf[0], b.nc);
+  if (!input) {
+    cerr << "Unable to read span block " << i << endl;
+    return false;
+  }
+  int nd = fastlz_decompress(&cbuf[0], b.nc, &rbuf[0], b.nraw);
+  if (nd!=int(b.nraw)) {
+    cerr << "Unable to decompress span block " << i << endl;
+    return false;
+  }
+  if (index.coded) return c1.unpackCoded(&rbuf[0], nd, index.dict);
+  // padding of tiny blocks is not part of the columns
+  int nb = c1.Ncol*sizeof(int);
+  if (nd<nb) return false;
+  for (int c=0; c<c1.Ncol; c++) {
+    int n1;
+    memcpy(&n1, &rbuf[c*sizeof(int)], sizeof(int));
+    nb+=n1;
+  }
+  if (nb>nd) return false;
+  return c1.unpack(&rbuf[0], nb);
+}
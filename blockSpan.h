@@ -0,0 +1,162 @@
+/*
+ *  blockSpan.h
+ *  Spanner
+ *
+ *  block-indexed columnar span file layout (header versions 208, 209)
+ *
+ */
+#ifndef BLOCKSPAN_H
+#define BLOCKSPAN_H
+
+#include <iostream>
+#include <ostream>
+#include <fstream>
+#include <string>
+#include <string.h>
+#include <vector>
+#include <map>
+#include <limits>
+#include <limits.h>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// v2 span file layout:
+//   C_headerSpan (V=SPANBLOCKVERSION, N=total records, light=records per block)
+//   block 0 ... block n-1      fastlz compressed columnar record blocks
+//   index                      int nblock + nblock*C_spanBlock1
+//   long long                  file offset of index (last 8 bytes of file)
+// records are grouped in position order, each block holds one column per
+// record field so that blocks compress well and decode without seeking
+//
+// coded span files (V=SPANCODEDVERSION) use the same layout with encoded
+// columns and a file dictionary after the index:
+//   index                      int nblock + nblock*C_spanBlock1
+//   dictionary                 int nvalue + nvalue*long long
+//   long long                  file offset of index
+// each coded column is
+//   char codec, char width, char bits, int n, long long first, long long base
+//   (n*bits+63)/64 little-endian 64 bit words of bit-packed values
+// value i is base+x[i] (SPANCODEFOR), the running sum of first and base+x[i]
+// (SPANCODEDELTA, for sorted positions) or dictionary[base+x[i]]
+// (SPANCODEDICT, for repeated codes like ReadGroupCode)
+//------------------------------------------------------------------------------
+const int SPANBLOCKSIZE=65536;            // records per block
+
+// column codecs
+const char SPANCODEFOR=0;                 // frame of reference bit-packing
+const char SPANCODEDELTA=1;               // delta + frame of reference
+const char SPANCODEDICT=2;                // file dictionary code + frame of reference
+
+//------------------------------------------------------------------------------
+// per-file dictionary of repeated column values
+//------------------------------------------------------------------------------
+class C_spanDictionary {
+  public:
+    C_spanDictionary() {};
+    unsigned int lookup(long long);          // code of value, added if new
+    vector<long long> value;                 // value of each code
+    void clear();
+  private:
+    map<long long, unsigned int> code;
+};
+
+//------------------------------------------------------------------------------
+// index entry for one block
+//------------------------------------------------------------------------------
+class C_spanBlock1 {
+  friend ostream &operator<<(ostream &, const C_spanBlock1 &);
+  public:
+    C_spanBlock1();
+    int minpos;                  // lowest key position in block
+    int maxpos;                  // highest key position in block
+    long long offset;            // file offset of compressed block
+    unsigned int count;          // number of records in block
+    unsigned int nraw;           // uncompressed block size (bytes)
+    unsigned int nc;             // compressed block size (bytes)
+};
+
+//------------------------------------------------------------------------------
+// footer block index
+//------------------------------------------------------------------------------
+class C_spanBlockIndex {
+  friend ostream &operator<<(ostream &, const C_spanBlockIndex &);
+  public:
+    C_spanBlockIndex() { coded=false; };
+    vector<C_spanBlock1> block;
+    C_spanDictionary dict;                   // coded files only
+    bool coded;
+    bool write(fstream &);                   // append index + index offset
+    bool read(istream &);                    // read index from end of file
+    vector<int> overlap(int, int) const;     // blocks overlapping [start,end]
+    unsigned int count() const;              // total records
+};
+
+//------------------------------------------------------------------------------
+// columns of one block
+//------------------------------------------------------------------------------
+class C_spanColumns {
+  public:
+    C_spanColumns(int);                      // number of columns
+    template <class T> void put(int c, const T & x) {
+      const char * b = reinterpret_cast<const char *>(&x);
+      col[c].insert(col[c].end(), b, b+sizeof(T));
+      width[c]=sizeof(T);
+      sign[c]=numeric_limits<T>::is_signed;
+    }
+    template <class T> T get(int c, int i) const {
+      T x;
+      memcpy(&x, &raw[start[c]+i*sizeof(T)], sizeof(T));
+      return x;
+    }
+    void clear();
+    void encode(int, char);                  // codec of column c (coded files)
+    int pack(vector<char> &) const;          // serialize columns into one buffer
+    bool unpack(const char *, int);          // split one buffer into columns
+    int packCoded(vector<char> &, C_spanDictionary &) const;
+    bool unpackCoded(const char *, int, const C_spanDictionary &);
+    int Ncol;
+    vector< vector<char> > col;              // columns being filled
+  private:
+    long long value(int, int) const;         // element i of column c being filled
+    vector<char> codec;
+    vector<char> width;                      // bytes per element
+    vector<char> sign;                       // signed element type
+    vector<char> raw;                        // unpacked block
+    vector<size_t> start;                    // column offsets into raw
+};
+
+//------------------------------------------------------------------------------
+// block writer: fill columns record by record, call add(pos) after each record
+//------------------------------------------------------------------------------
+class C_spanBlockWriter {
+  public:
+    C_spanBlockWriter(fstream &, int, bool); // output stream positioned after header, Ncol, coded
+    C_spanColumns cols;
+    void add(int);                           // close one record with key position
+    void finish();                           // flush last block & write index
+    C_spanBlockIndex index;
+  private:
+    void flush();
+    fstream & output;
+    C_spanBlock1 b1;
+    vector<char> rbuf;
+    vector<char> cbuf;
+};
+
+//------------------------------------------------------------------------------
+// block reader
+//------------------------------------------------------------------------------
+class C_spanBlockReader {
+  public:
+    C_spanBlockReader(istream &, bool);      // reads index from input, coded
+    bool readBlock(int, C_spanColumns &);    // decompress block i into columns
+    C_spanBlockIndex index;
+    bool ok;
+  private:
+    istream & input;
+    vector<char> rbuf;
+    vector<char> cbuf;
+};
+
+#endif
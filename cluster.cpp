@@ -8,6 +8,15 @@
  */
 
 #include "cluster.h"
+#include "threadPool.h"
+#include <algorithm>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#if defined(__GNUC__)&&((__GNUC__>4)||((__GNUC__==4)&&(__GNUC_MINOR__>=9)))
+#include <immintrin.h>
+#define CLUSTER_AVX2
+#endif
+#endif
 
 // default constructor for single cluster element
 C_cluster1d_element1::C_cluster1d_element1() {  
@@ -65,6 +74,72 @@ int C_cluster1d_element1::operator<(const C_cluster1d_element1 &rhs) const
 }
 
 C_cluster1d_element1::~C_cluster1d_element1() {}
+
+//------------------------------------------------------------------------------
+// 1d cluster table
+//------------------------------------------------------------------------------
+C_cluster1d_stats::C_cluster1d_stats() {  
+    label=0;
+    N=0;  
+    first=0;
+    mean=0; 
+    std=0;  
+    low=0; 
+    high=0; 
+}     
+
+void C_cluster1d_elements::clear() {
+  c.clear();
+  member.clear();
+}
+
+int C_cluster1d_elements::size() const {
+  return c.size();
+}
+
+C_cluster1d_stats & C_cluster1d_elements::operator[](int k) {
+  return c[k];
+}
+
+const C_cluster1d_stats & C_cluster1d_elements::operator[](int k) const {
+  return c[k];
+}
+
+const int * C_cluster1d_elements::inp(int k) const {
+  return (member.empty()? 0: &member[0]+c[k].first);
+}
+
+C_cluster1d_element1 C_cluster1d_elements::element(int k) const {
+  C_cluster1d_element1 e1;
+  const C_cluster1d_stats & c1 = c[k];
+  e1.N=c1.N;
+  e1.mean=c1.mean;
+  e1.std=c1.std;
+  e1.low=c1.low;
+  e1.high=c1.high;
+  e1.inp.assign(member.begin()+c1.first, member.begin()+c1.first+c1.N);
+  return e1;
+}
+
+// remove clusters (ascending indices) and compact the member array in one pass
+void C_cluster1d_elements::erase(const vector<int> & itoss) {
+  if (itoss.empty()) return;
+  int NT = itoss.size();
+  int t=0, k1=0, m=0;
+  for (int k=0; k<int(c.size()); k++) {
+    if ((t<NT)&&(itoss[t]==k)) {
+      t++;
+      continue;
+    }
+    C_cluster1d_stats c1 = c[k];
+    for (int j=0; j<c1.N; j++) member[m+j]=member[c1.first+j];
+    c1.first=m;
+    m+=c1.N;
+    c[k1++]=c1;
+  }
+  c.resize(k1);
+  member.resize(m);
+}
  
 
 // default constructor
@@ -115,7 +190,8 @@ void C_NNcluster1d::init() {
   for (int i=0; i<N; i++) {
     cls.push_back(i);
   }
-  nxt=cls;
+  up=cls;
+  sz.assign(N,1);
   // initialize neighbor counter y
   y.resize(N,0);
   int j0=0;
@@ -158,65 +234,86 @@ void C_NNcluster1d::makeConnections() {
   }
 }
 
-void C_NNcluster1d::connect(int i1,int i2) {
-  if (i1==i2) return; 
-  int nxt1 = nxt[i1];
-  //int nxt2 = nxt[i2];
-  int cls1 = cls[i1];
-  nxt[i1]=i2;
-  int i = i2;
-  while (nxt[i]!=i2) {
-    cls[i]=cls1;
-    i = nxt[i];
+//------------------------------------------------------------------------------
+// union-find: cls of a root is the label of its cluster
+//------------------------------------------------------------------------------
+int C_NNcluster1d::root(int i) {
+  while (up[i]!=i) {
+    up[i]=up[up[i]];
+    i=up[i];
   }
-  nxt[i]=nxt1;
-  cls[i]=cls1;      
+  return i;
+}
+
+// join cluster of i2 into cluster of i1, keeping the label of i1's cluster
+void C_NNcluster1d::connect(int i1,int i2) {
+  if ((i1==i2)||(i1<0)||(i2<0)) return; 
+  int r1 = root(i1);
+  int r2 = root(i2);
+  if (r1==r2) return;
+  int cls1 = cls[r1];
+  if (sz[r1]<sz[r2]) swap(r1,r2);
+  up[r2]=r1;
+  sz[r1]+=sz[r2];
+  cls[r1]=cls1;      
 }
 
 void C_NNcluster1d::makeClusters() {
+  // label of every element from its root
   for (int i=0; i<N; i++) {
-    if (cluster.count(cls[i])==0) {
-       cluster[cls[i]].N=1;
-       cluster[cls[i]].mean=x[i];
-       cluster[cls[i]].std=x[i]*x[i];
-       cluster[cls[i]].low=x[i];
-       cluster[cls[i]].high=x[i];
-       cluster[cls[i]].inp.clear();
-       cluster[cls[i]].inp.push_back(i);
+    cls[i]=cls[root(i)];
+  }
+  // table slot of each label in label order, with member offsets
+  vector<int> slot(N,0);
+  for (int i=0; i<N; i++) {
+    slot[cls[i]]++;
+  }
+  cluster.clear();
+  int first=0;
+  for (int l=0; l<N; l++) {
+    if (slot[l]==0) continue;
+    C_cluster1d_stats c1;
+    c1.label=l;
+    c1.first=first;
+    first+=slot[l];
+    slot[l]=cluster.c.size();
+    cluster.c.push_back(c1);
+  }
+  // accumulate in one pass
+  cluster.member.resize(N);
+  for (int i=0; i<N; i++) {
+    C_cluster1d_stats & c1 = cluster.c[slot[cls[i]]];
+    if (c1.N==0) {
+       c1.mean=x[i];
+       c1.std=x[i]*x[i];
+       c1.low=x[i];
+       c1.high=x[i];
     } else {
-       cluster[cls[i]].N+=1;
-       cluster[cls[i]].mean+=x[i];
-       cluster[cls[i]].std+=x[i]*x[i];
-       cluster[cls[i]].low=(x[i]>cluster[cls[i]].low?cluster[cls[i]].low: x[i]);
-       cluster[cls[i]].high=(x[i]<cluster[cls[i]].high?cluster[cls[i]].high: x[i]);
-       cluster[cls[i]].inp.push_back(i);
+       c1.mean+=x[i];
+       c1.std+=x[i]*x[i];
+       c1.low=(x[i]>c1.low?c1.low: x[i]);
+       c1.high=(x[i]<c1.high?c1.high: x[i]);
     }
+    cluster.member[c1.first+c1.N]=i;
+    c1.N+=1;
   }
-  C_cluster1d_elements::iterator it;
-  C_cluster1d_element1 c1;
-  for ( it=cluster.begin() ; it != cluster.end(); it++ ) {
-      int i = (*it).first;
-      cluster[i].mean=cluster[i].mean/cluster[i].N;
-      cluster[i].std=sqrt(cluster[i].std/cluster[i].N-(cluster[i].mean*cluster[i].mean));
+  for (int k=0; k<cluster.size(); k++) {
+      C_cluster1d_stats & c1 = cluster[k];
+      c1.mean=c1.mean/c1.N;
+      c1.std=sqrt(c1.std/c1.N-(c1.mean*c1.mean));
   }
   NC = cluster.size();
 }
 
 void C_NNcluster1d::cleanClusters() {
-  C_cluster1d_elements::iterator it;
-  C_cluster1d_element1 c1;
   vector<int> itoss;
   //int N0 = cluster.size();
-  for ( it=cluster.begin() ; it != cluster.end(); it++ ) {
-      int i = (*it).first;
-      bool toss = cluster[i].N<=Nmin;
-      toss = toss | (cluster[i].std<=Smin);
-      if (toss) itoss.push_back(i);
-  }
-  int NT = itoss.size();
-  for (int i=0; i<NT; i++) {
-     cluster.erase(itoss[i]);
+  for (int k=0; k<cluster.size(); k++) {
+      bool toss = cluster[k].N<=Nmin;
+      toss = toss | (cluster[k].std<=Smin);
+      if (toss) itoss.push_back(k);
   }
+  cluster.erase(itoss);
   NC = cluster.size();
   // printf(" cleanCluster removed %d of %d clusters leaving NC %d\n",NT,N0,NC);
 }        
@@ -225,26 +322,20 @@ void C_NNcluster1d::cleanClusters() {
 // merge near clusters
 //------------------------------------------------------------------------------
 void C_NNcluster1d::mergeClusters() {
-  C_cluster1d_elements::iterator it,jt;
   int N0 = cluster.size();
   int NM=0;
-  for ( it=cluster.begin() ; it != cluster.end(); it++ ) {
-      if (it != cluster.begin()) {
-        jt = it;
-        jt--;  
-        int i = (*it).first;
-        int j = (*jt).first;
+  for (int i=1; i<cluster.size(); i++) {
+        int j = i-1;
         bool morethan1 = cluster[j].N>1;
         bool thin = cluster[j].std<dx;
         bool close = (cluster[i].low-cluster[j].high)<(dx);
         close = close & (fabs(cluster[i].mean-cluster[j].mean)<(2*dx));
         if (thin&close&morethan1)  {
-           int ix=cluster[i].inp[0];
-           int jx=cluster[j].inp[0];
+           int ix=cluster.inp(i)[0];
+           int jx=cluster.inp(j)[0];
            connect(ix,jx); 
            NM++;
         }
-      }
   }
   cluster.clear();
   makeClusters();
@@ -259,14 +350,12 @@ ostream &operator<<(ostream &output,  C_cluster1d_element1 & c1)
     return output;
 }
 
-ostream &operator<<(ostream &output,  C_cluster1d_elements & c1)
+ostream &operator<<(ostream &output, const C_cluster1d_elements & c1)
 {
-  C_cluster1d_elements::iterator it;
-  //C_cluster1d_element1 c1;
   output << "mean" << "\t " << "N" << "\t " << "std" << "\t " << "low" << "\t " << "high" << endl ;      
-  for ( it=c1.begin() ; it != c1.end(); it++ ) {
-      int i = (*it).first;
-      output << c1[i];
+  for (int k=0; k<c1.size(); k++) {
+      const C_cluster1d_stats & s1 = c1[k];
+      output << s1.mean << "\t " << s1.N << "\t " << s1.std << "\t " << s1.low << "\t " << s1.high << endl ;      
   }
   return output;
 }
@@ -296,11 +385,8 @@ void C_NNcluster1d::write(string & outfilename)
   h.reclen =   4*sizeof(double)+sizeof(int);
   h.N = this->cluster.size();
   h.write(output);
-  C_cluster1d_elements::iterator it;
-  C_cluster1d_element1 c1;
-  for ( it=cluster.begin() ; it != cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = cluster[i];
+  for (int k=0; k<cluster.size(); k++) {
+    const C_cluster1d_stats & c1 = cluster[k];
     double mean1 = c1.mean;  
     int N1 = c1.N;  
     double std1 = c1.std;  
@@ -396,9 +482,275 @@ int C_cluster2d_element1::operator<(const C_cluster2d_element1 &rhs) const
    return 0;
 }
 
+//------------------------------------------------------------------------------
+// 2d cluster table
+//------------------------------------------------------------------------------
+C_cluster2d_stats::C_cluster2d_stats() {  
+    label=0;
+    N=0;  
+    first=0;
+    for (int j=0; j<2; j++) {
+      mean[j]=0;
+      std[j]=0;
+      low[j]=0; 
+      high[j]=0;
+    }
+}     
+
+void C_cluster2d_elements::clear() {
+  c.clear();
+  member.clear();
+}
+
+int C_cluster2d_elements::size() const {
+  return c.size();
+}
+
+C_cluster2d_stats & C_cluster2d_elements::operator[](int k) {
+  return c[k];
+}
+
+const C_cluster2d_stats & C_cluster2d_elements::operator[](int k) const {
+  return c[k];
+}
+
+const int * C_cluster2d_elements::inp(int k) const {
+  return (member.empty()? 0: &member[0]+c[k].first);
+}
+
+C_cluster2d_element1 C_cluster2d_elements::element(int k) const {
+  C_cluster2d_element1 e1;
+  const C_cluster2d_stats & c1 = c[k];
+  e1.N=c1.N;
+  for (int j=0; j<2; j++) {
+    e1.mean[j]=c1.mean[j];
+    e1.std[j]=c1.std[j];
+    e1.low[j]=c1.low[j];
+    e1.high[j]=c1.high[j];
+  }
+  e1.inp.assign(member.begin()+c1.first, member.begin()+c1.first+c1.N);
+  return e1;
+}
+
+// remove clusters (ascending indices) and compact the member array in one pass
+void C_cluster2d_elements::erase(const vector<int> & itoss) {
+  if (itoss.empty()) return;
+  int NT = itoss.size();
+  int t=0, k1=0, m=0;
+  for (int k=0; k<int(c.size()); k++) {
+    if ((t<NT)&&(itoss[t]==k)) {
+      t++;
+      continue;
+    }
+    C_cluster2d_stats c1 = c[k];
+    for (int j=0; j<c1.N; j++) member[m+j]=member[c1.first+j];
+    c1.first=m;
+    m+=c1.N;
+    c[k1++]=c1;
+  }
+  c.resize(k1);
+  member.resize(m);
+}
+
+
+//------------------------------------------------------------------------------
+// structure-of-arrays input
+//------------------------------------------------------------------------------
+void C_cluster2d_columns::clear() {
+  for (int j=0; j<2; j++) {
+    x[j].clear();
+    w[j].clear();
+  }
+  ip.clear();
+}
+
+void C_cluster2d_columns::reserve(int n) {
+  for (int j=0; j<2; j++) {
+    x[j].reserve(n);
+    w[j].reserve(n);
+  }
+  ip.reserve(n);
+}
+
+void C_cluster2d_columns::push_back(double x0, double x1, double w0, double w1, int ip1) {
+  x[0].push_back(x0);
+  x[1].push_back(x1);
+  w[0].push_back(w0);
+  w[1].push_back(w1);
+  ip.push_back(ip1);
+}
+
+int C_cluster2d_columns::size() const {
+  return ip.size();
+}
+
+//------------------------------------------------------------------------------
+// neighborhood scans of the second coordinate over the x[0] window [j0,j1)
+// AVX2 kernels are chosen at run time, SSE2 otherwise
+//------------------------------------------------------------------------------
+#ifdef CLUSTER_AVX2
+static bool detectAVX2()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+
+static bool useAVX2()
+{
+  static const bool a = detectAVX2();
+  return a;
+}
+
+__attribute__((target("avx2")))
+static int countNearAVX2(const double * y, int j0, int j1, double x, double w)
+{
+  int j=j0;
+  const __m256d vx=_mm256_set1_pd(x);
+  const __m256d vw=_mm256_set1_pd(w);
+  const __m256d sign=_mm256_set1_pd(-0.0);
+  __m256i a0=_mm256_setzero_si256();
+  __m256i a1=_mm256_setzero_si256();
+  for (; j+8<=j1; j+=8) {
+    __m256d d0=_mm256_andnot_pd(sign, _mm256_sub_pd(vx, _mm256_loadu_pd(y+j)));
+    __m256d d1=_mm256_andnot_pd(sign, _mm256_sub_pd(vx, _mm256_loadu_pd(y+j+4)));
+    a0=_mm256_sub_epi64(a0, _mm256_castpd_si256(_mm256_cmp_pd(d0, vw, _CMP_LE_OQ)));
+    a1=_mm256_sub_epi64(a1, _mm256_castpd_si256(_mm256_cmp_pd(d1, vw, _CMP_LE_OQ)));
+  }
+  long long s[4];
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(s), _mm256_add_epi64(a0, a1));
+  int k=int(s[0]+s[1]+s[2]+s[3]);
+  for (; j<j1; j++) {
+    if (fabs(x-y[j])<=w) k++;
+  }
+  return k;
+}
+
+__attribute__((target("avx2")))
+static int bestNearAVX2(const double * y, const int * n, int j0, int j1, double x, double w)
+{
+  int nmax=0;
+  int ij=-1;
+  int j=j0;
+  const __m256d vx=_mm256_set1_pd(x);
+  const __m256d vw=_mm256_set1_pd(w);
+  const __m256d sign=_mm256_set1_pd(-0.0);
+  __m256i vmax=_mm256_setzero_si256();
+  for (; j+8<=j1; j+=8) {
+    __m256d m0=_mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(vx, _mm256_loadu_pd(y+j))), vw, _CMP_LE_OQ);
+    __m256d m1=_mm256_cmp_pd(_mm256_andnot_pd(sign, _mm256_sub_pd(vx, _mm256_loadu_pd(y+j+4))), vw, _CMP_LE_OQ);
+    // density of the 8 points where near, 0 elsewhere
+    __m256i v0=_mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(n+j)));
+    __m256i v1=_mm256_cvtepi32_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i *>(n+j+4)));
+    v0=_mm256_and_si256(v0, _mm256_castpd_si256(m0));
+    v1=_mm256_and_si256(v1, _mm256_castpd_si256(m1));
+    // skip block unless it holds a new maximum
+    __m256i gt=_mm256_or_si256(_mm256_cmpgt_epi64(v0, vmax), _mm256_cmpgt_epi64(v1, vmax));
+    if (_mm256_testz_si256(gt, gt)) continue;
+    for (int q=j; q<j+8; q++) {
+      if ((fabs(x-y[q])<=w)&&(n[q]>nmax)) {
+        ij = q;
+        nmax = n[q];
+      }
+    }
+    vmax=_mm256_set1_epi64x(nmax);
+  }
+  for (; j<j1; j++) {
+    if ((fabs(x-y[j])<=w)&&(n[j]>nmax)) {
+      ij = j;
+      nmax = n[j];
+    }
+  }
+  return ij;
+}
+#endif
+
+// number of j with |x-y[j]|<=w
+static int countNear(const double * y, int j0, int j1, double x, double w)
+{
+#ifdef CLUSTER_AVX2
+  if (useAVX2()) return countNearAVX2(y, j0, j1, x, w);
+#endif
+  int k=0;
+  int j=j0;
+#ifdef __SSE2__
+  const __m128d vx=_mm_set1_pd(x);
+  const __m128d vw=_mm_set1_pd(w);
+  const __m128d sign=_mm_set1_pd(-0.0);
+  __m128i a0=_mm_setzero_si128();
+  __m128i a1=_mm_setzero_si128();
+  __m128i a2=_mm_setzero_si128();
+  __m128i a3=_mm_setzero_si128();
+  for (; j+8<=j1; j+=8) {
+    __m128d d0=_mm_andnot_pd(sign, _mm_sub_pd(vx, _mm_loadu_pd(y+j)));
+    __m128d d1=_mm_andnot_pd(sign, _mm_sub_pd(vx, _mm_loadu_pd(y+j+2)));
+    __m128d d2=_mm_andnot_pd(sign, _mm_sub_pd(vx, _mm_loadu_pd(y+j+4)));
+    __m128d d3=_mm_andnot_pd(sign, _mm_sub_pd(vx, _mm_loadu_pd(y+j+6)));
+    a0=_mm_sub_epi64(a0, _mm_castpd_si128(_mm_cmple_pd(d0, vw)));
+    a1=_mm_sub_epi64(a1, _mm_castpd_si128(_mm_cmple_pd(d1, vw)));
+    a2=_mm_sub_epi64(a2, _mm_castpd_si128(_mm_cmple_pd(d2, vw)));
+    a3=_mm_sub_epi64(a3, _mm_castpd_si128(_mm_cmple_pd(d3, vw)));
+  }
+  long long s[2];
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(s), _mm_add_epi64(_mm_add_epi64(a0, a1), _mm_add_epi64(a2, a3)));
+  k=int(s[0]+s[1]);
+#endif
+  for (; j<j1; j++) {
+    if (fabs(x-y[j])<=w) k++;
+  }
+  return k;
+}
+
+// first j with |x-y[j]|<=w and the highest n[j]>0, -1 if none
+static int bestNear(const double * y, const int * n, int j0, int j1, double x, double w)
+{
+#ifdef CLUSTER_AVX2
+  if (useAVX2()) return bestNearAVX2(y, n, j0, j1, x, w);
+#endif
+  int nmax=0;
+  int ij=-1;
+  int j=j0;
+#ifdef __SSE2__
+  const __m128d vx=_mm_set1_pd(x);
+  const __m128d vw=_mm_set1_pd(w);
+  const __m128d sign=_mm_set1_pd(-0.0);
+  __m128i vmax=_mm_setzero_si128();
+  for (; j+8<=j1; j+=8) {
+    __m128d m0=_mm_cmple_pd(_mm_andnot_pd(sign, _mm_sub_pd(vx, _mm_loadu_pd(y+j))), vw);
+    __m128d m1=_mm_cmple_pd(_mm_andnot_pd(sign, _mm_sub_pd(vx, _mm_loadu_pd(y+j+2))), vw);
+    __m128d m2=_mm_cmple_pd(_mm_andnot_pd(sign, _mm_sub_pd(vx, _mm_loadu_pd(y+j+4))), vw);
+    __m128d m3=_mm_cmple_pd(_mm_andnot_pd(sign, _mm_sub_pd(vx, _mm_loadu_pd(y+j+6))), vw);
+    // density of the 8 points where near, 0 elsewhere
+    __m128i near0=_mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(m0), _mm_castpd_ps(m1), _MM_SHUFFLE(2,0,2,0)));
+    __m128i near1=_mm_castps_si128(_mm_shuffle_ps(_mm_castpd_ps(m2), _mm_castpd_ps(m3), _MM_SHUFFLE(2,0,2,0)));
+    __m128i v0=_mm_and_si128(near0, _mm_loadu_si128(reinterpret_cast<const __m128i *>(n+j)));
+    __m128i v1=_mm_and_si128(near1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(n+j+4)));
+    // skip block unless it holds a new maximum
+    __m128i gt=_mm_or_si128(_mm_cmpgt_epi32(v0, vmax), _mm_cmpgt_epi32(v1, vmax));
+    if (_mm_movemask_epi8(gt)==0) continue;
+    for (int q=j; q<j+8; q++) {
+      if ((fabs(x-y[q])<=w)&&(n[q]>nmax)) {
+        ij = q;
+        nmax = n[q];
+      }
+    }
+    vmax=_mm_set1_epi32(nmax);
+  }
+#endif
+  for (; j<j1; j++) {
+    if ((fabs(x-y[j])<=w)&&(n[j]>nmax)) {
+      ij = j;
+      nmax = n[j];
+    }
+  }
+  return ij;
+}
 
 // default constructor
 C_NNcluster2d::C_NNcluster2d() {
+  in=0;
+  Nthread=1;
+  grid=false;
+  gdx=0;
   Nmin=1;
   Smin[0]=0;
   Smin[1]=0;
@@ -411,9 +763,12 @@ C_NNcluster2d::~C_NNcluster2d() {
 }
 
 // full constructor
-C_NNcluster2d::C_NNcluster2d(const vector<vector<double> > & x1,const vector<vector<double> > & wx1
-        , const vector<int> & ip1
-        , const double fx1[2] , const string & tn1, const string & sn1, const string & cn1) {
+C_NNcluster2d::C_NNcluster2d(const C_cluster2d_columns & in1
+        , const double fx1[2] , const string & tn1, const string & sn1, const string & cn1
+        , int Nthread1) {
+  Nthread=Nthread1;
+  grid=false;
+  gdx=0;
   typeName = tn1;
   setName = sn1;
   contigName = cn1;
@@ -424,21 +779,20 @@ C_NNcluster2d::C_NNcluster2d(const vector<vector<double> > & x1,const vector<vec
   cluster.clear();
   fx[0]=fx1[0]; // neighborhood scale
   fx[1]=fx1[1]; 
-  x=x1;
-  wx=wx1;
-  ip=ip1;
-  N=x.size();
+  in=&in1;
+  N=in->size();
   dx[0]=0;
   dx[1]=0;
   for (int i=0; i<N; i++) {
-      wx[i][0]*=fx[0];
-      wx[i][1]*=fx[1];
-      if ( wx[i][0]>dx[0] ) { dx[0]=wx[i][0]; }  
-      if ( wx[i][1]>dx[1] ) { dx[1]=wx[i][1]; }  
+      double w0=in->w[0][i]*fx[0];
+      double w1=in->w[1][i]*fx[1];
+      if ( w0>dx[0] ) { dx[0]=w0; }  
+      if ( w1>dx[1] ) { dx[1]=w1; }  
   }
   init();
   makeConnections();
-  makeClusters();
+  makeClusters(in1);
+  in=0;
 }
     
 
@@ -447,149 +801,333 @@ void C_NNcluster2d::init() {
   for (int i=0; i<N; i++) {
     cls.push_back(i);
   }
-  nxt=cls;
-  // initialize neighbor counter y
-  n.resize(N,0);
-  int j0=0;
-  for (int i=0; i<N; i++) {
+  up=cls;
+  sz.assign(N,1);
+  // neighbor counter and x[0] windows
+  n.assign(N,0);
+  lo.assign(N,0);
+  hi.assign(N,0);
+}
+
+void C_NNcluster2d::scan(int a, int b) {
+  const double * x0 = &in->x[0][0];
+  int j0=a;
+  for (int i=a; i<b; i++) {
+    double w0=in->w[0][i]*fx[0];
     int j=j0;
     // find lowest x[j] within dx of x[i]
-    while ((j<N)&((x[i][0]-x[j][0])>wx[i][0])) { j++; }
+    while ((j<b)&&((x0[i]-x0[j])>w0)) { j++; }
     j0 = j;
-    // find highest x[j] within dx of x[i]
-    while (fabs(x[i][0]-x[j][0])<=wx[i][0]) { 
-      if (fabs(x[i][1]-x[j][1])<=wx[i][1]) n[i]+=1;
-      j++; 
-      if (j==N) break;
-    }    
+    // find end of x[0] window (x is sorted on x[0])
+    int j1=b;
+    while (j<j1) {
+      int m=(j+j1)/2;
+      if (fabs(x0[i]-x0[m])<=w0) {
+        j=m+1;
+      } else {
+        j1=m;
+      }
+    }
+    lo[i]=j0;
+    hi[i]=j1;
   }  
 }
 
+void C_NNcluster2d::count(int a, int b) {
+  const double * x1 = &in->x[1][0];
+  for (int i=a; i<b; i++) {
+    if (grid) {
+      n[i]=gridCount(i);
+    } else {
+      n[i]=countNear(x1, lo[i], hi[i], x1[i], in->w[1][i]*fx[1]);
+    }
+  }  
+}
 
-void C_NNcluster2d::makeConnections() {
-  int j0=0; 
+void C_NNcluster2d::link(int a, int b) {
+  const double * x1 = &in->x[1][0];
+  for (int i=a; i<b; i++) {
+    int ij;
+    if (grid) {
+      ij = gridBest(i);
+    } else {
+      ij = bestNear(x1, &n[0], lo[i], hi[i], x1[i], in->w[1][i]*fx[1]);
+    }
+    connect(i,ij);  
+  }
+}
+
+void C_NNcluster2d::linkPart(void * a, int k) {
+  C_NNcluster2d * c = reinterpret_cast<C_NNcluster2d *>(a);
+  c->count(c->part[k], c->part[k+1]);
+  c->link(c->part[k], c->part[k+1]);
+}
+
+//------------------------------------------------------------------------------
+// x[1] grid: points sorted by cell of width 2*dx[1], then by index. The 
+// neighbors of i within its x[0] window lie in the index range [lo,hi) of 
+// the cell of i and the two cells next to it, so only those slots are 
+// tested. Densities and the chosen neighbor are those of the linear scan.
+// Used when a sample of points shows far fewer candidates than the scan
+//------------------------------------------------------------------------------
+bool C_NNcluster2d::makeGrid() {
+  grid=false;
+  if ((N<1024)||(dx[1]<=0)) return false;
+  // mean x[0] window occupancy: no gain in short windows
+  double m=0;
+  for (int i=0; i<N; i++) m+=hi[i]-lo[i];
+  if (m<256.0*N) return false;
+  const double * x1 = &in->x[1][0];
+  gdx=2*dx[1];
+  vector<pair<long long,int> > s(N);
   for (int i=0; i<N; i++) {
-    int j=j0;
-    // find lowest x[j] within dx of x[i]
-    //while ((x[i][0]-x[j][0])>dx[0]) { j++; }
-    while ((j<N)&((x[i][0]-x[j][0])>wx[i][0])) { j++; }
-    j0 = j;
-    // find lowest x[j] within dx of x[i]
-    int nmax = 0;
-    int ij = -1;
-    while (fabs(x[i][0]-x[j][0])<=wx[i][0]) { 
-      if (fabs(x[i][1]-x[j][1])<=wx[i][1]) { 
-        if (n[j]>nmax) {
-          ij = j;
-          nmax = n[j];
-        }
+    s[i]=make_pair((long long)floor(x1[i]/gdx), i);
+  }
+  sort(s.begin(), s.end());
+  gord.resize(N);
+  gx.resize(N);
+  pcell.resize(N);
+  ckey.clear();
+  cstart.clear();
+  for (int k=0; k<N; k++) {
+    if ((k==0)||(s[k].first!=ckey.back())) {
+      ckey.push_back(s[k].first);
+      cstart.push_back(k);
+    }
+    gord[k]=s[k].second;
+    gx[k]=x1[s[k].second];
+    pcell[s[k].second]=ckey.size()-1;
+  }
+  cstart.push_back(N);
+  // candidates and search steps of a sample against the linear scan
+  double ng=0;
+  double nw=0;
+  double steps=log(double(N)/ckey.size()+1.0)/log(2.0)+1;
+  int step=N/256;
+  for (int i=0; i<N; i+=step) {
+    for (int c=-1; c<=1; c++) {
+      int k0,k1;
+      gridRange(i, c, k0, k1);
+      ng+=k1-k0+4*steps;
+    }
+    nw+=hi[i]-lo[i];
+  }
+  grid = (8*ng<nw);
+  if (!grid) {
+    vector<long long>().swap(ckey);
+    vector<int>().swap(cstart);
+    vector<int>().swap(pcell);
+    vector<int>().swap(gord);
+    vector<double>().swap(gx);
+  }
+  return grid;
+}
+
+// slots [k0,k1) of the cell next to i's by c that are in i's x[0] window
+void C_NNcluster2d::gridRange(int i, int c, int & k0, int & k1) {
+  k0=0;
+  k1=0;
+  int ic=pcell[i]+c;
+  if ((ic<0)||(ic>=int(ckey.size()))||(ckey[ic]!=ckey[pcell[i]]+c)) return;
+  vector<int>::iterator b=gord.begin()+cstart[ic];
+  vector<int>::iterator e=gord.begin()+cstart[ic+1];
+  b=lower_bound(b, e, lo[i]);
+  e=lower_bound(b, e, hi[i]);
+  k0=b-gord.begin();
+  k1=e-gord.begin();
+}
+
+int C_NNcluster2d::gridCount(int i) {
+  double x1=in->x[1][i];
+  double w1=in->w[1][i]*fx[1];
+  int k=0;
+  for (int c=-1; c<=1; c++) {
+    int k0,k1;
+    gridRange(i, c, k0, k1);
+    k+=countNear(&gx[0], k0, k1, x1, w1);
+  }
+  return k;
+}
+
+// lowest index with the highest density, as bestNear over [lo,hi)
+int C_NNcluster2d::gridBest(int i) {
+  double x1=in->x[1][i];
+  double w1=in->w[1][i]*fx[1];
+  int nmax=0;
+  int ij=-1;
+  for (int c=-1; c<=1; c++) {
+    int k0,k1;
+    gridRange(i, c, k0, k1);
+    for (int k=k0; k<k1; k++) {
+      if (fabs(x1-gx[k])>w1) continue;
+      int j=gord[k];
+      if ((n[j]>nmax)||((n[j]==nmax)&&(ij>=0)&&(j<ij))) {
+        ij=j;
+        nmax=n[j];
       }
-      j++; 
-      if (j==N) break;
-    }  
-    connect(i,ij);  
+    }
   }
+  return ij;
+}
+
+//------------------------------------------------------------------------------
+// points further apart in x[0] than the largest window never interact, so
+// the sorted input splits at such gaps into parts that connect independently
+// (same windows, densities and union order as one pass over all points).
+// Parts are grouped into batches for the thread pool 
+//------------------------------------------------------------------------------
+void C_NNcluster2d::makeConnections() {
+  part.clear();
+  part.push_back(0);
+  if ((Nthread>1)&&(N>1)) {
+    const double * x0 = &in->x[0][0];
+    int Nbatch = N/(4*Nthread);
+    if (Nbatch<1024) Nbatch=1024;
+    for (int i=1; i<N; i++) {
+      if (((i-part.back())>=Nbatch)&&((x0[i]-x0[i-1])>dx[0])) part.push_back(i);
+    }
+  }
+  part.push_back(N);
+  int Npart = part.size()-1;
+  if (N>0) {
+    scan(0,N);
+    makeGrid();
+  }
+  if ((Npart>1)&&(N>0)) {
+    C_threadPool pool(Npart<Nthread? Npart: Nthread);
+    pool.run(Npart, linkPart, this);
+  } else if (N>0) {
+    count(0,N);
+    link(0,N);
+  }
+  // windows and grid are not needed once connected
+  vector<int>().swap(lo);
+  vector<int>().swap(hi);
+  vector<long long>().swap(ckey);
+  vector<int>().swap(cstart);
+  vector<int>().swap(pcell);
+  vector<int>().swap(gord);
+  vector<double>().swap(gx);
+  grid=false;
+  part.clear();
 }
  
-void C_NNcluster2d::connect(int i1,int i2) {
-  if (i1==i2) return; 
-  int nxt1 = nxt[i1];
-  //int nxt2 = nxt[i2];
-  int cls1 = cls[i1];
-  nxt[i1]=i2;
-  int i = i2;
-  while (nxt[i]!=i2) {
-    cls[i]=cls1;
-    i = nxt[i];
+//------------------------------------------------------------------------------
+// union-find: cls of a root is the label of its cluster
+//------------------------------------------------------------------------------
+int C_NNcluster2d::root(int i) {
+  while (up[i]!=i) {
+    up[i]=up[up[i]];
+    i=up[i];
   }
-  nxt[i]=nxt1;
-  cls[i]=cls1;      
+  return i;
 }
 
-void C_NNcluster2d::makeClusters() {
+// join cluster of i2 into cluster of i1, keeping the label of i1's cluster
+void C_NNcluster2d::connect(int i1,int i2) {
+  if ((i1==i2)||(i1<0)||(i2<0)) return; 
+  int r1 = root(i1);
+  int r2 = root(i2);
+  if (r1==r2) return;
+  int cls1 = cls[r1];
+  if (sz[r1]<sz[r2]) swap(r1,r2);
+  up[r2]=r1;
+  sz[r1]+=sz[r2];
+  cls[r1]=cls1;      
+}
+
+void C_NNcluster2d::makeClusters(const C_cluster2d_columns & in1) {
+  const vector<double> * x = in1.x;
+  // label of every element from its root
+  for (int i=0; i<N; i++) {
+    cls[i]=cls[root(i)];
+  }
+  // table slot of each label in label order, with member offsets
+  vector<int> slot(N,0);
+  for (int i=0; i<N; i++) {
+    slot[cls[i]]++;
+  }
+  cluster.clear();
+  int first=0;
+  for (int l=0; l<N; l++) {
+    if (slot[l]==0) continue;
+    C_cluster2d_stats c1;
+    c1.label=l;
+    c1.first=first;
+    first+=slot[l];
+    slot[l]=cluster.c.size();
+    cluster.c.push_back(c1);
+  }
+  // accumulate in one pass
+  cluster.member.resize(N);
   for (int i=0; i<N; i++) {
-    if (cluster.count(cls[i])==0) {
-      cluster[cls[i]].N=1;
+    C_cluster2d_stats & c1 = cluster.c[slot[cls[i]]];
+    if (c1.N==0) {
       for (int j=0; j<2; j++) {
-        cluster[cls[i]].mean[j]=x[i][j];
-        cluster[cls[i]].std[j]=x[i][j]*x[i][j];
-        cluster[cls[i]].low[j]=x[i][j];
-        cluster[cls[i]].high[j]=x[i][j];
+        c1.mean[j]=x[j][i];
+        c1.std[j]=x[j][i]*x[j][i];
+        c1.low[j]=x[j][i];
+        c1.high[j]=x[j][i];
       }
-      cluster[cls[i]].inp.clear();
-      cluster[cls[i]].inp.push_back(ip[i]);
     } else {
-      cluster[cls[i]].N+=1;
       for (int j=0; j<2; j++) {
-        cluster[cls[i]].mean[j]+=x[i][j];
-        cluster[cls[i]].std[j]+=x[i][j]*x[i][j];
-        cluster[cls[i]].low[j]=(x[i][j]>cluster[cls[i]].low[j]?cluster[cls[i]].low[j]: x[i][j]);
-        cluster[cls[i]].high[j]=(x[i][j]<cluster[cls[i]].high[j]?cluster[cls[i]].high[j]: x[i][j]);
+        c1.mean[j]+=x[j][i];
+        c1.std[j]+=x[j][i]*x[j][i];
+        c1.low[j]=(x[j][i]>c1.low[j]?c1.low[j]: x[j][i]);
+        c1.high[j]=(x[j][i]<c1.high[j]?c1.high[j]: x[j][i]);
       }
-      cluster[cls[i]].inp.push_back(ip[i]);
     }
+    cluster.member[c1.first+c1.N]=in1.ip[i];
+    c1.N+=1;
   }
-  C_cluster2d_elements::iterator it;
-  C_cluster2d_element1 c1;
-  for ( it=cluster.begin() ; it != cluster.end(); it++ ) {
-      int i = (*it).first;
+  for (int k=0; k<cluster.size(); k++) {
+      C_cluster2d_stats & c1 = cluster[k];
       for (int j=0; j<2; j++) {
-        cluster[i].mean[j]=cluster[i].mean[j]/cluster[i].N;
-        cluster[i].std[j]=sqrt(cluster[i].std[j]/cluster[i].N-(cluster[i].mean[j]*cluster[i].mean[j]));
+        c1.mean[j]=c1.mean[j]/c1.N;
+        c1.std[j]=sqrt(c1.std[j]/c1.N-(c1.mean[j]*c1.mean[j]));
       }
   }
   NC = cluster.size();
 }
 
 void C_NNcluster2d::cleanClusters() {
-  C_cluster2d_elements::iterator it;
-  C_cluster2d_element1 c1;
   vector<int> itoss;
   //int N0 = cluster.size();
-  for ( it=cluster.begin() ; it != cluster.end(); it++ ) {
-      int i = (*it).first;
-      bool toss = cluster[i].N<=Nmin;
+  for (int k=0; k<cluster.size(); k++) {
+      bool toss = cluster[k].N<=Nmin;
       for (int j=0; j<2; j++) {
-         toss = toss | (cluster[i].std[j]<=Smin[j]);
+         toss = toss | (cluster[k].std[j]<=Smin[j]);
       }
-      if (toss) itoss.push_back(i);
-  }
-  int NT = itoss.size();
-  for (int i=0; i<NT; i++) {
-     cluster.erase(itoss[i]);
+      if (toss) itoss.push_back(k);
   }
+  cluster.erase(itoss);
   NC = cluster.size();
   //printf(" cleanCluster removed %d of %d clusters leaving NC %d\n",NT,N0,NC);
 }        
 
-void C_NNcluster2d::mergeClusters() {
-  C_cluster2d_elements::iterator it,jt;
+void C_NNcluster2d::mergeClusters(const C_cluster2d_columns & in1) {
+  if ((in1.size()!=N)||(int(cls.size())!=N)) {
+    cerr << " mergeClusters: columns do not match the clustered data " << endl;
+    return;
+  }
   int N0 = cluster.size();
   int NM=0;
-  for ( it=cluster.begin() ; it != cluster.end(); it++ ) {
-      if (it != cluster.begin()) {
-        jt = it;
-        jt--;  
-        int i = (*it).first;
-        int j = (*jt).first;
+  for (int i=1; i<cluster.size(); i++) {
+        int j = i-1;
         bool morethan1 = cluster[j].N>1;
         bool thin = cluster[j].std[0]<dx[0];
         bool close = (cluster[i].low[0]-cluster[j].high[0])<2*dx[0];
         close = close & (fabs(cluster[i].mean[1]-cluster[j].mean[1])<dx[0]);
         if (thin&close&morethan1)  {
-          //  int ix=cluster[i].inp[0];  why inp? 
-          //  int jx=cluster[j].inp[0];
-          //  connect(ix,jx); 
-           connect(i,j); 
+           connect(cluster[i].label,cluster[j].label); 
            NM++;
 
            cerr << "merge " << NM << endl;
 
         }
-      }
   }
   cluster.clear();
-  makeClusters();
+  makeClusters(in1);
   NC = cluster.size();
   printf(" mergeCluster merged %d of %d clusters leaving NC %d\n",NM,N0,NC);
 }        
@@ -605,15 +1143,17 @@ ostream &operator<<(ostream &output,  C_cluster2d_element1 & c1)
     return output;
 }
 
-ostream &operator<<(ostream &output,  C_cluster2d_elements & c1)
+ostream &operator<<(ostream &output, const C_cluster2d_elements & c1)
 {
-  C_cluster2d_elements::iterator it;
-  //C_cluster1d_element1 c1;
   output << "N" << "\t " << "mean1" << "\t " << "std1" << "\t " << "low1" << "\t " << "high1";
   output << "\t " << "mean2" << "\t " << "std2" << "\t " << "low2" << "\t " << "high2" << endl ;      
-  for ( it=c1.begin() ; it != c1.end(); it++ ) {
-      int i = (*it).first;
-      output << c1[i];
+  for (int k=0; k<c1.size(); k++) {
+      const C_cluster2d_stats & s1 = c1[k];
+      output << s1.N << "\t ";
+      for (int j=0; j<2; j++) {
+        output << s1.mean[j] << "\t " << s1.std[j] << "\t " << s1.low[j] << "\t " << s1.high[j]  ;      
+      }
+      output << endl;
   }
   return output;
 }
@@ -651,12 +1191,9 @@ void C_NNcluster2d::write(string & outfilename)
   h.reclen =   8*sizeof(double)+sizeof(int);
   h.N = this->cluster.size();
   h.write(output);
-  C_cluster2d_elements::iterator it;
-  C_cluster2d_element1 c1;
   int Npair = 0;
-  for ( it=cluster.begin() ; it != cluster.end(); it++ ) {
-    int i = (*it).first;
-    c1 = cluster[i];
+  for (int k=0; k<cluster.size(); k++) {
+    const C_cluster2d_stats & c1 = cluster[k];
     output.write(reinterpret_cast<const char *>(&c1.N), sizeof(int));
     Npair+=c1.N;
     for (int j=0; j<2; j++) {
@@ -678,6 +1215,211 @@ void C_NNcluster2d::write(string & outfilename)
   output.close();
 }
 
+//------------------------------------------------------------------------------
+// streaming 2d clusterer. Point i is scanned once the front is past its x[0]
+// window, linked once every point in its window is scanned, and its cluster
+// is closed once the first unlinked point is more than dxmax beyond it. 
+// Windows, densities and union order match C_NNcluster2d over the same points
+//------------------------------------------------------------------------------
+C_streamCluster2d::C_streamCluster2d(const double fx1[2], double dxmax1
+        , T_clusterSink sink1, void * arg1) {
+  sink=sink1;
+  sinkArg=arg1;
+  fx[0]=fx1[0];
+  fx[1]=fx1[1];
+  dxmax=dxmax1;
+  Nmin=1;
+  Smin[0]=-1;
+  Smin[1]=-1;
+  NC=0;
+  Npoint=0;
+  B=0;
+  S=0;
+  L=0;
+  E=0;
+  lo0=0;
+}
+
+void C_streamCluster2d::setNmin(int Nmin1) {
+  Nmin=Nmin1;
+}
+
+void C_streamCluster2d::setSmin(double Smin1, double Smin2) {
+  Smin[0]=Smin1;
+  Smin[1]=Smin2;
+}
+
+int C_streamCluster2d::resident() const {
+  return ip.size();
+}
+
+bool C_streamCluster2d::push(double x0, double x1, double w0, double w1, int ip1) {
+  if ((Npoint>B)&&(x0<x[0].back())) {
+    cerr << "stream cluster input not sorted at " << x0 << endl;
+    return false;
+  }
+  w0=w0*fx[0];
+  w1=w1*fx[1];
+  if (w0>dxmax) {
+    cerr << "stream cluster window " << w0 << " exceeds " << dxmax << " at " << x0 << endl;
+    return false;
+  }
+  int i=Npoint++;
+  x[0].push_back(x0);
+  x[1].push_back(x1);
+  w[0].push_back(w0);
+  w[1].push_back(w1);
+  ip.push_back(ip1);
+  n.push_back(0);
+  lo.push_back(i);
+  hi.push_back(i);
+  up.push_back(i);
+  sz.push_back(1);
+  cls.push_back(i);
+  last.push_back(i);
+  tail.push_back(i);
+  nxt.push_back(-1);
+  done.push_back(0);
+  advance(x0, false);
+  return true;
+}
+
+void C_streamCluster2d::finish() {
+  advance(0, true);
+  compact();
+}
+
+void C_streamCluster2d::advance(double front, bool all) {
+  while ((S<Npoint)&&(all||((front-x[0][S-B])>w[0][S-B]))) {
+    scan(S++);
+  }
+  while ((L<S)&&(hi[L-B]<=S)) {
+    link(L++);
+  }
+  double bound = (L<Npoint? x[0][L-B]: front);
+  while ((E<L)&&(all||((x[0][E-B]+dxmax)<bound))) {
+    int r=root(E);
+    if (last[r-B]==E) emit(r);
+    E++;
+  }
+  compact();
+}
+
+void C_streamCluster2d::scan(int i) {
+  const double * x0 = &x[0][0];
+  double xi=x0[i-B];
+  double w0=w[0][i-B];
+  int j=(lo0>B? lo0: B);
+  // lowest x[j] within w0 of x[i], moving up from the previous edge
+  while ((j<Npoint)&&((xi-x0[j-B])>w0)) { j++; }
+  lo0 = j;
+  int j1=Npoint;
+  while (j<j1) {
+    int m=(j+j1)/2;
+    if (fabs(xi-x0[m-B])<=w0) {
+      j=m+1;
+    } else {
+      j1=m;
+    }
+  }
+  lo[i-B]=lo0;
+  hi[i-B]=j1;
+  n[i-B]=countNear(&x[1][0], lo0-B, j1-B, x[1][i-B], w[1][i-B]);
+}
+
+void C_streamCluster2d::link(int i) {
+  int ij = bestNear(&x[1][0], &n[0], lo[i-B]-B, hi[i-B]-B, x[1][i-B], w[1][i-B]);
+  connect(i, (ij<0? -1: ij+B));
+}
+
+int C_streamCluster2d::root(int i) {
+  while (up[i-B]!=i) {
+    up[i-B]=up[up[i-B]-B];
+    i=up[i-B];
+  }
+  return i;
+}
+
+// the member list of a root starts at the root; the label of i1's cluster 
+// is kept as in C_NNcluster2d::connect
+void C_streamCluster2d::connect(int i1, int i2) {
+  if ((i1==i2)||(i1<0)||(i2<0)) return; 
+  int r1 = root(i1);
+  int r2 = root(i2);
+  if (r1==r2) return;
+  int cls1 = cls[r1-B];
+  if (sz[r1-B]<sz[r2-B]) swap(r1,r2);
+  up[r2-B]=r1;
+  sz[r1-B]+=sz[r2-B];
+  cls[r1-B]=cls1;
+  if (last[r2-B]>last[r1-B]) last[r1-B]=last[r2-B];
+  nxt[tail[r1-B]-B]=r2;
+  tail[r1-B]=tail[r2-B];
+}
+
+void C_streamCluster2d::emit(int r) {
+  vector<int> m;
+  for (int i=r; i>=0; i=nxt[i-B]) {
+    m.push_back(i);
+    done[i-B]=1;
+  }
+  sort(m.begin(), m.end());
+  C_cluster2d_element1 c1;
+  for (size_t k=0; k<m.size(); k++) {
+    int i=m[k]-B;
+    for (int j=0; j<2; j++) {
+      double xj=x[j][i];
+      if (k==0) {
+        c1.mean[j]=xj;
+        c1.std[j]=xj*xj;
+        c1.low[j]=xj;
+        c1.high[j]=xj;
+      } else {
+        c1.mean[j]+=xj;
+        c1.std[j]+=xj*xj;
+        c1.low[j]=(xj>c1.low[j]?c1.low[j]: xj);
+        c1.high[j]=(xj<c1.high[j]?c1.high[j]: xj);
+      }
+    }
+    c1.inp.push_back(ip[i]);
+  }
+  c1.N=m.size();
+  bool toss = c1.N<=Nmin;
+  for (int j=0; j<2; j++) {
+    c1.mean[j]=c1.mean[j]/c1.N;
+    c1.std[j]=sqrt(c1.std[j]/c1.N-(c1.mean[j]*c1.mean[j]));
+    toss = toss | (c1.std[j]<=Smin[j]);
+  }
+  if (toss) return;
+  NC++;
+  sink(sinkArg, cls[r-B], c1);
+}
+
+// drop the leading points of closed clusters 
+void C_streamCluster2d::compact() {
+  int D=B;
+  while ((D<E)&&done[D-B]) { D++; }
+  int nd=D-B;
+  if ((nd<4096)&&(D<Npoint)) return;
+  if (nd*2<int(ip.size())) return;
+  for (int j=0; j<2; j++) {
+    x[j].erase(x[j].begin(), x[j].begin()+nd);
+    w[j].erase(w[j].begin(), w[j].begin()+nd);
+  }
+  ip.erase(ip.begin(), ip.begin()+nd);
+  n.erase(n.begin(), n.begin()+nd);
+  lo.erase(lo.begin(), lo.begin()+nd);
+  hi.erase(hi.begin(), hi.begin()+nd);
+  up.erase(up.begin(), up.begin()+nd);
+  sz.erase(sz.begin(), sz.begin()+nd);
+  cls.erase(cls.begin(), cls.begin()+nd);
+  last.erase(last.begin(), last.begin()+nd);
+  tail.erase(tail.begin(), tail.begin()+nd);
+  nxt.erase(nxt.begin(), nxt.begin()+nd);
+  done.erase(done.begin(), done.begin()+nd);
+  B=D;
+}
+
 /*
   list<C_localpair>::iterator i;
   for(i=localpairs.begin(); i != localpairs.end(); ++i) {
@@ -62,8 +62,65 @@ class C_cluster2d_element1 {
 };
 
 
-typedef std::map<int, C_cluster1d_element1, std::less<int> >  C_cluster1d_elements;
-typedef std::map<int, C_cluster2d_element1, std::less<int> >  C_cluster2d_elements;
+//------------------------------------------------------------------------------
+// summary of one cluster in a cluster table. Members of the cluster are 
+// inp[first..first+N) of the table's member index array
+//------------------------------------------------------------------------------
+class C_cluster1d_stats {
+  public:
+    C_cluster1d_stats(); 
+    int label;  // cluster label (index of a member point)
+    int N;      // number of hits in this element
+    int first;  // offset of first member in member index array
+    double mean; 
+    double std;  
+    double low; 
+    double high; 
+};
+
+class C_cluster2d_stats {
+  public:
+    C_cluster2d_stats(); 
+    int label;  // cluster label (index of a member point)
+    int N;      // number of hits in this element
+    int first;  // offset of first member in member index array
+    double mean[2]; 
+    double std[2];  
+    double low[2]; 
+    double high[2]; 
+};
+
+//------------------------------------------------------------------------------
+// dense cluster tables: summaries in ascending label order and one CSR-style 
+// member index array. element(k) copies cluster k out with its own inp
+//------------------------------------------------------------------------------
+class C_cluster1d_elements {
+  friend ostream &operator<<(ostream &, const C_cluster1d_elements &);
+  public:
+    void clear();
+    int size() const;
+    C_cluster1d_stats & operator[](int);
+    const C_cluster1d_stats & operator[](int) const;
+    const int * inp(int) const;                  // members of cluster k
+    C_cluster1d_element1 element(int) const;
+    void erase(const vector<int> &);             // ascending cluster indices
+    vector<C_cluster1d_stats> c;
+    vector<int> member;
+};
+
+class C_cluster2d_elements {
+  friend ostream &operator<<(ostream &, const C_cluster2d_elements &);
+  public:
+    void clear();
+    int size() const;
+    C_cluster2d_stats & operator[](int);
+    const C_cluster2d_stats & operator[](int) const;
+    const int * inp(int) const;                  // members of cluster k
+    C_cluster2d_element1 element(int) const;
+    void erase(const vector<int> &);             // ascending cluster indices
+    vector<C_cluster2d_stats> c;
+    vector<int> member;
+};
 
 // structure for 1d NN cluster object 
 class C_NNcluster1d {
@@ -87,26 +144,42 @@ class C_NNcluster1d {
     void makeConnections();
     void makeClusters();
     void connect(int,int);
+    int root(int);
     // data
     int N;              // number of elements to NN cluster
     double dx;          // neighborhood scale
     vector<double> x;   // points in 1d
     vector<double> y;   // local density of points
-    vector<int> cls;    // class label
-    vector<int> nxt;    // next pointer
+    vector<int> cls;    // class label (valid at roots until makeClusters)
+    vector<int> up;     // union-find parent
+    vector<int> sz;     // union-find set size
     int Nmin;
     double Smin;
 };
 
 
-// structure for 1d NN cluster object 
+//------------------------------------------------------------------------------
+// structure-of-arrays input to C_NNcluster2d, sorted on x[0]. The clusterer
+// only reads the columns during construction; mergeClusters takes them again
+//------------------------------------------------------------------------------
+class C_cluster2d_columns {
+  public:
+    void clear();
+    void reserve(int);
+    void push_back(double, double, double, double, int);  // x0, x1, w0, w1, ip
+    int size() const;
+    vector<double> x[2];          // coordinates
+    vector<double> w[2];          // neighborhood window of each point
+    vector<int> ip;               // index to elements
+};
+
+// structure for 2d NN cluster object 
 class C_NNcluster2d {
   friend ostream &operator<<(ostream &, const C_NNcluster2d &);
   public:
-    // constructor (input list and NN scale)
-    C_NNcluster2d(const vector<vector<double> > & , const vector<vector<double> > & 
-        , const vector<int> & 
-        , const double[2], const string &, const string &,const string &); 
+    // constructor (input list and NN scale, threads for independent partitions)
+    C_NNcluster2d(const C_cluster2d_columns & 
+        , const double[2], const string &, const string &,const string &, int=1); 
     C_NNcluster2d(); // empty constructor 
     ~C_NNcluster2d();
     void write(string &);
@@ -118,27 +191,104 @@ class C_NNcluster2d {
     void setNmin(int);
     void setSmin(double,double);
     void cleanClusters();    
-    void mergeClusters();
+    void mergeClusters(const C_cluster2d_columns &);  // same columns as constructed
   private:
     // alg steps
     void init();
     void makeConnections();
-    void makeClusters();
+    void makeClusters(const C_cluster2d_columns &);
     void connect(int,int);
+    int root(int);
+    void scan(int,int);           // x[0] windows of points a..b-1
+    void count(int,int);          // densities of points a..b-1
+    void link(int,int);           // connect points a..b-1 to densest neighbor
+    static void linkPart(void *, int);
+    bool makeGrid();
+    void gridRange(int, int, int &, int &);
+    int gridCount(int);
+    int gridBest(int);
     // data
     int N;                        // number of elements to NN cluster
+    int Nthread;
+    vector<int> part;             // partition bounds (cut at gaps > dx[0])
+    bool grid;                    // neighbors from the x[1] grid
+    double gdx;                   // grid cell width in x[1]
+    vector<long long> ckey;       // occupied cells, ascending
+    vector<int> cstart;           // first slot of each cell (and end)
+    vector<int> pcell;            // cell of each point
+    vector<int> gord;             // point of each slot (ascending in a cell)
+    vector<double> gx;            // x[1] of each slot
     double dx[2];                 // max absolute neighborhood scale 
     double fx[2];                 // relative neighborhood scale 
-    vector<vector<double> > x;    // data to cluster
-    vector<vector<double> > wx;   // local window (for each library)
-    vector<int> ip;               // index to elements
+    const C_cluster2d_columns * in;  // data to cluster, 0 after construction
     vector<int> n;                // local density
-    vector<int> cls;
-    vector<int> nxt;
+    vector<int> lo;               // first neighbor in x[0] window
+    vector<int> hi;               // end of x[0] window
+    vector<int> cls;              // class label (valid at roots until makeClusters)
+    vector<int> up;               // union-find parent
+    vector<int> sz;               // union-find set size
     int Nmin;
     double Smin[2];
 
 };
 
+//------------------------------------------------------------------------------
+// streaming form of C_NNcluster2d for points pushed in x[0] order. Once the 
+// front is more than the largest x[0] window past the last member of a 
+// cluster nothing can join it: the cluster goes to the sink (members in push
+// order, same statistics, label and Nmin/Smin cut as cleanClusters) and its
+// points are dropped. Only the active window and open clusters stay resident.
+// Clusters come out in order of their last member rather than label order.
+// dxmax must bound every scaled x[0] window: a point with a wider window is
+// rejected like unsorted input, as closed clusters could no longer take it
+//------------------------------------------------------------------------------
+typedef void (*T_clusterSink)(void *, int, const C_cluster2d_element1 &);  // arg, label, cluster
+
+class C_streamCluster2d {
+  public:
+    // relative scales, largest x[0] window after scaling, sink and its argument
+    C_streamCluster2d(const double[2], double, T_clusterSink, void *);
+    bool push(double, double, double, double, int);  // x0, x1, w0, w1, ip (false if rejected)
+    void finish();                   // pass on all open clusters
+    void setNmin(int);
+    void setSmin(double,double);
+    int resident() const;            // points held
+    int NC;                          // clusters passed to the sink
+    int Npoint;                      // points pushed
+  private:
+    void advance(double, bool);      // scan, link and emit behind the front 
+    void scan(int);
+    void link(int);
+    void emit(int);
+    void compact();
+    int root(int);
+    void connect(int,int);
+    T_clusterSink sink;
+    void * sinkArg;
+    double fx[2];                    // relative neighborhood scale 
+    double dxmax;                    // largest x[0] window
+    int Nmin;
+    double Smin[2];
+    int B;                           // index of first resident point
+    int S;                           // next point to scan
+    int L;                           // next point to link
+    int E;                           // next point to check for a closed cluster
+    int lo0;                         // running lower window edge
+    // resident points B.. (indices below are absolute)
+    vector<double> x[2];
+    vector<double> w[2];             // scaled windows
+    vector<int> ip;
+    vector<int> n;                   // local density
+    vector<int> lo;                  // first neighbor in x[0] window
+    vector<int> hi;                  // end of x[0] window
+    vector<int> up;                  // union-find parent
+    vector<int> sz;                  // union-find set size
+    vector<int> cls;                 // class label (at roots)
+    vector<int> last;                // last member (at roots)
+    vector<int> tail;                // end of member list (at roots)
+    vector<int> nxt;                 // member list, -1 terminated
+    vector<char> done;               // passed to the sink
+};
+
 #endif
 
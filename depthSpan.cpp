@@ -0,0 +1,244 @@
+/*
+ *  depthSpan.cpp
+ *  Spanner
+ *
+ *  compact per-base depth counts (uint8 with overflow table, uint16, uint32)
+ *
+ */
+
+#include <algorithm>
+#include <math.h>
+#include "depthSpan.h"
+
+// largest side table kept for uint8 storage (fraction of bases)
+static const int DEPTHU8SPARSE=64;
+
+C_depthStore::C_depthStore() {
+  L=0;
+  w=0;
+  vmax=0;
+}
+
+void C_depthStore::clear() {
+  vector<unsigned char>().swap(u8);
+  vector<unsigned short>().swap(u16);
+  vector<unsigned int>().swap(u32);
+  vector<int>().swap(opos);
+  vector<unsigned int>().swap(oval);
+  L=0;
+  w=0;
+  vmax=0;
+}
+
+bool C_depthStore::pack(const vector<float> & x) {
+  int n=x.size();
+  int hi=0;
+  int nover=0;
+  for (int i=0; i<n; i++) {
+    float v=x[i];
+    if ((v<0)||(v>4294967295.0f)||(v!=floorf(v))) return false;
+    if (v>=DEPTHU8MAX) {
+      nover++;
+      if (v>hi) hi=(v>2147483647.0f? 2147483647: int(v));
+    }
+  }
+  clear();
+  L=n;
+  if ((nover==0)||(nover<=n/DEPTHU8SPARSE)) {
+    w=1;
+    u8.resize(n);
+    for (int i=0; i<n; i++) {
+      if (x[i]<DEPTHU8MAX) {
+        u8[i]=(unsigned char)(x[i]);
+        if (int(x[i])>vmax) vmax=int(x[i]);
+      } else {
+        u8[i]=DEPTHU8MAX;
+        opos.push_back(i);
+        oval.push_back((unsigned int)(x[i]));
+      }
+    }
+    if (nover>0) vmax=hi;
+  } else if (hi<=65535) {
+    w=2;
+    u16.resize(n);
+    for (int i=0; i<n; i++) u16[i]=(unsigned short)(x[i]);
+    vmax=hi;
+  } else {
+    w=4;
+    u32.resize(n);
+    for (int i=0; i<n; i++) u32[i]=(unsigned int)(x[i]);
+    vmax=hi;
+  }
+  return true;
+}
+
+// count arrays straight from the integer fill (no float copy); false if any
+// value is negative
+bool C_depthStore::pack(const vector<int> & x, int n, bool sums) {
+  long long s=0;
+  int hi=0;
+  int nover=0;
+  for (int i=0; i<n; i++) {
+    s = (sums? s+x[i]: x[i]);
+    if ((s<0)||(s>4294967295LL)) return false;
+    if (s>=DEPTHU8MAX) {
+      nover++;
+      if (s>hi) hi=(s>2147483647LL? 2147483647: int(s));
+    }
+  }
+  clear();
+  L=n;
+  s=0;
+  if ((nover==0)||(nover<=n/DEPTHU8SPARSE)) {
+    w=1;
+    u8.resize(n);
+    for (int i=0; i<n; i++) {
+      s = (sums? s+x[i]: x[i]);
+      if (s<DEPTHU8MAX) {
+        u8[i]=(unsigned char)(s);
+        if (int(s)>vmax) vmax=int(s);
+      } else {
+        u8[i]=DEPTHU8MAX;
+        opos.push_back(i);
+        oval.push_back((unsigned int)(s));
+      }
+    }
+    if (nover>0) vmax=hi;
+  } else if (hi<=65535) {
+    w=2;
+    u16.resize(n);
+    for (int i=0; i<n; i++) {
+      s = (sums? s+x[i]: x[i]);
+      u16[i]=(unsigned short)(s);
+    }
+    vmax=hi;
+  } else {
+    w=4;
+    u32.resize(n);
+    for (int i=0; i<n; i++) {
+      s = (sums? s+x[i]: x[i]);
+      u32[i]=(unsigned int)(s);
+    }
+    vmax=hi;
+  }
+  return true;
+}
+
+void C_depthStore::unpack(vector<float> & x) const {
+  x.resize(L);
+  for (int i=0; i<L; i++) {
+    switch (w) {
+      case 1: x[i]=u8[i]; break;
+      case 2: x[i]=u16[i]; break;
+      case 4: x[i]=u32[i]; break;
+    }
+  }
+  for (size_t k=0; k<opos.size(); k++) x[opos[k]]=oval[k];
+}
+
+float C_depthStore::get(int i) const {
+  switch (w) {
+    case 1:
+      if ((u8[i]==DEPTHU8MAX)&&(opos.size()>0)) {
+        vector<int>::const_iterator k = lower_bound(opos.begin(),opos.end(),i);
+        if ((k!=opos.end())&&(*k==i)) return oval[k-opos.begin()];
+      }
+      return u8[i];
+    case 2:
+      return u16[i];
+    case 4:
+      return u32[i];
+  }
+  return 0;
+}
+
+// false if the value range is too wide for a count array
+bool C_depthStore::tally(vector<long long> & cnt) const {
+  cnt.clear();
+  if ((vmax<0)||(vmax>(1<<24))) return false;
+  cnt.assign(vmax+1, 0);
+  for (int i=0; i<L; i++) {
+    switch (w) {
+      case 1: cnt[u8[i]]++; break;
+      case 2: cnt[u16[i]]++; break;
+      case 4: cnt[u32[i]]++; break;
+    }
+  }
+  // side table values were counted as DEPTHU8MAX
+  for (size_t k=0; k<oval.size(); k++) {
+    cnt[DEPTHU8MAX]--;
+    cnt[oval[k]]++;
+  }
+  return true;
+}
+
+int C_depthStore::size() const {
+  return L;
+}
+
+int C_depthStore::width() const {
+  return w;
+}
+
+int C_depthStore::max() const {
+  return vmax;
+}
+
+bool C_depthStore::overflow() const {
+  return (opos.size()>0);
+}
+
+size_t C_depthStore::bytes() const {
+  return u8.size()+2*u16.size()+4*u32.size()+8*opos.size();
+}
+
+const char * C_depthStore::data() const {
+  if (L==0) return 0;
+  switch (w) {
+    case 1: return reinterpret_cast<const char *>(&u8[0]);
+    case 2: return reinterpret_cast<const char *>(&u16[0]);
+    case 4: return reinterpret_cast<const char *>(&u32[0]);
+  }
+  return 0;
+}
+
+char * C_depthStore::alloc(int w1, int L1) {
+  clear();
+  if (L1<=0) return 0;
+  L=L1;
+  w=w1;
+  switch (w) {
+    case 1: u8.resize(L); return reinterpret_cast<char *>(&u8[0]);
+    case 2: u16.resize(L); return reinterpret_cast<char *>(&u16[0]);
+    case 4: u32.resize(L); return reinterpret_cast<char *>(&u32[0]);
+  }
+  L=0;
+  w=0;
+  return 0;
+}
+
+void C_depthStore::loaded() {
+  vmax=0;
+  for (int i=0; i<L; i++) {
+    int v=0;
+    switch (w) {
+      case 1: v=u8[i]; break;
+      case 2: v=u16[i]; break;
+      case 4: v=(u32[i]>2147483647u? 2147483647: int(u32[i])); break;
+    }
+    if (v>vmax) vmax=v;
+  }
+}
+
+long long C_depthStore::sum() const {
+  long long s=0;
+  for (int i=0; i<L; i++) {
+    switch (w) {
+      case 1: s+=u8[i]; break;
+      case 2: s+=u16[i]; break;
+      case 4: s+=u32[i]; break;
+    }
+  }
+  for (size_t k=0; k<oval.size(); k++) s+=oval[k]-DEPTHU8MAX;
+  return s;
+}
@@ -0,0 +1,53 @@
+/*
+ *  depthSpan.h
+ *  Spanner
+ *
+ *  compact per-base depth counts (uint8 with overflow table, uint16, uint32)
+ *
+ */
+#ifndef DEPTHSPAN_H
+#define DEPTHSPAN_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// integer depth per base in the narrowest width that holds the observed
+// maximum. uint8 keeps values >= DEPTHU8MAX in a sorted side table when they
+// are rare. Arrays with fractional or negative values are not packed
+//------------------------------------------------------------------------------
+const int DEPTHU8MAX=255;                    // uint8 marker of a side table value
+
+class C_depthStore {
+  public:
+    C_depthStore();
+    void clear();
+    bool pack(const vector<float> &);        // false: not integral, nothing packed
+    bool pack(const vector<int> &, int, bool);  // first n counts, or their prefix sums (true)
+    void unpack(vector<float> &) const;
+    float get(int) const;
+    bool tally(vector<long long> &) const;   // count of each value 0..max
+    int size() const;
+    int width() const;                       // bytes per base, 0 if empty
+    int max() const;
+    bool overflow() const;                   // uint8 with side table
+    size_t bytes() const;                    // memory held
+    const char * data() const;               // width() bytes per base, 0 if empty
+    char * alloc(int, int);                  // raw storage: width, length (0 if empty)
+    void loaded();                           // after alloc'd storage was filled
+    long long sum() const;
+  private:
+    int L;
+    int w;
+    int vmax;
+    vector<unsigned char> u8;
+    vector<unsigned short> u16;
+    vector<unsigned int> u32;
+    vector<int> opos;                        // side table positions (sorted)
+    vector<unsigned int> oval;               // side table values
+};
+
+#endif
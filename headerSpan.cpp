@@ -10,7 +10,7 @@
 #include "headerSpan.h"
 
 C_headerSpan::C_headerSpan() {               // constructor
-    V=207; 
+    V=SPANVERSION; 
     contigName="";                           
     setName="";                              
     typeName="";
@@ -31,6 +31,14 @@ C_headerSpan::C_headerSpan() {               // constructor
     ".cross5.cls.span",".cross3.cls.span"};
     vector<string> s1c(sc, sc + 8);
     spanextc = s1c;
+    //--------------------------------------------------------------------------
+    // Spanner build aberrant pair class file extensions (same order as spanextc)
+    //--------------------------------------------------------------------------
+    string sp[] = {".short.class.span",".long.class.span",".invert5.class.span",
+    ".invert3.class.span",".dangle5.class.span",".dangle3.class.span",
+    ".cross5.class.span",".cross3.class.span"};
+    vector<string> s1p(sp, sp + 8);
+    spanextp = s1p;
     /*
     vector<string> s1e(s + 6, s + 7);
     spanext1 = s1e;
@@ -53,10 +61,10 @@ ostream &operator<<(ostream &output,  C_headerSpan & h)
 //------------------------------------------------------------------------------
 // Constructor from file
 //------------------------------------------------------------------------------
-C_headerSpan::C_headerSpan(fstream & input) 
+C_headerSpan::C_headerSpan(istream & input) 
 {
   input.seekg (0, ios::beg);
-  if (!input.is_open()) { 
+  if (!input) { 
       cerr << "file not open in loadHeader" << endl;
   }
   // grab version number from latest default constructor
@@ -66,7 +74,7 @@ C_headerSpan::C_headerSpan(fstream & input)
   char buff[512];
   // read version 
   input.read(reinterpret_cast < char * > (&V), sizeof(int));
-  if (V!=V0) {
+  if ((V!=V0)&&(V!=SPANBLOCKVERSION)&&(V!=SPANCODEDVERSION)&&(V!=SPANDEPTHVERSION)) {
       cerr << "Spanner file version "<< V << " doesn't match expected version " << V0 << endl;
   }  
   // length of c-style string
@@ -96,7 +104,8 @@ C_headerSpan::C_headerSpan(fstream & input)
   // read record size
   input.read(reinterpret_cast < char * > (&reclen), sizeof(int));
   // read info long long light if version > 204
-  if (h.V>204) { 
+  light=0;
+  if (V>204) { 
     // read info 
     input.read(reinterpret_cast < char * > (&light), sizeof(light));
   }
@@ -105,12 +114,24 @@ C_headerSpan::C_headerSpan(fstream & input)
 }
 
 
+// block-indexed columnar record layout 
+bool C_headerSpan::blocked() const
+{
+  return ((V==SPANBLOCKVERSION)||(V==SPANCODEDVERSION));
+}
+
+// block columns are delta/bit-packed/dictionary coded
+bool C_headerSpan::coded() const
+{
+  return (V==SPANCODEDVERSION);
+}
+
 // I/O function write
-bool C_headerSpan::write(fstream & output) 
+bool C_headerSpan::write(ostream & output) 
 {
   // open output binary file. bomb if unable to open
   //fstream output(outfilename.c_str(), ios::out | ios::binary);
-  if (!output.is_open()) {
+  if (!output) {
       cerr << "Unable to write header into output file " << endl;
       return false;
   }
@@ -149,3 +170,10 @@ bool C_headerSpan::write(fstream & output)
   return true;
 }
 
+// header bytes for buffered writers 
+string C_headerSpan::pack() 
+{
+  ostringstream output(ios::out | ios::binary);
+  write(output);
+  return output.str();
+}
@@ -12,6 +12,7 @@
 #include <iostream>
 #include <ostream>
 #include <fstream>
+#include <sstream>
 #include <iomanip>
 #include <string>
 #include <vector>
@@ -26,6 +27,17 @@
 
 using namespace std;
 
+//------------------------------------------------------------------------------
+// span file versions: flat fixed length records (201-207),
+// block-indexed columnar records (208), block-indexed records with 
+// delta/bit-packed/dictionary coded columns (209), see blockSpan.h, and
+// depth arrays of 1 or 2 byte integer counts (210)
+//------------------------------------------------------------------------------
+const int SPANVERSION=207;
+const int SPANBLOCKVERSION=208;
+const int SPANCODEDVERSION=209;
+const int SPANDEPTHVERSION=210;
+
 //------------------------------------------------------------------------------
 // header  info container class
 //------------------------------------------------------------------------------
@@ -33,9 +45,12 @@ class C_headerSpan {
   friend ostream &operator<<(ostream &, C_headerSpan &);
   public:
     C_headerSpan();                                 // constructor
-    C_headerSpan(fstream &); 
+    C_headerSpan(istream &);                        // plain file or container member
     ~C_headerSpan(){};                              // destructor
-    bool write(fstream &); 
+    bool write(ostream &); 
+    string pack();                                  // header bytes as written by write()
+    bool blocked() const;                           // block-indexed record layout
+    bool coded() const;                             // coded block columns
     int V; 
     string contigName;                              // contig/anchor name
     string setName;                                 // set name
@@ -53,6 +68,8 @@ class C_headerSpan {
     vector<string> spanext; 
     // type file extensions for clusters
     vector<string> spanextc; 
+    // type file extensions for aberrant pair classes written at build time
+    vector<string> spanextp; 
     // type file extensions for single-end read analysis
     // vector<string> spanext1; 
 };
@@ -0,0 +1,53 @@
+/*
+ *  mapSpan.cpp
+ *  Spanner
+ *
+ *  memory mapped access to flat span record files
+ *
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mapSpan.h"
+
+//------------------------------------------------------------------------------
+// map whole file read-only; pages are faulted in sequentially by the loaders
+//------------------------------------------------------------------------------
+C_mappedFile::C_mappedFile(const string & filename) {
+  data=0;
+  size=0;
+  base=MAP_FAILED;
+  ok=false;
+  // member of an open span container: already mapped
+  if (findSpanPack(filename, data, size)) {
+    ok=true;
+    return;
+  }
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd<0) return;
+  struct stat sb;
+  if ((fstat(fd, &sb)<0)||(sb.st_size==0)) {
+    close(fd);
+    return;
+  }
+  size = sb.st_size;
+  base = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // mapping stays valid after the descriptor is closed
+  close(fd);
+  if (base==MAP_FAILED) {
+    cerr << "Unable to map file: " << filename << endl;
+    size=0;
+    return;
+  }
+  madvise(base, size, MADV_SEQUENTIAL);
+  data = reinterpret_cast<const char *>(base);
+  ok=true;
+}
+
+C_mappedFile::~C_mappedFile() {
+  if (base!=MAP_FAILED) {
+    munmap(base, size);
+  }
+}
@@ -0,0 +1,118 @@
+/*
+ *  mapSpan.h
+ *  Spanner
+ *
+ *  memory mapped access to flat span record files
+ *
+ */
+#ifndef MAPSPAN_H
+#define MAPSPAN_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include "headerSpan.h"
+#include "packSpan.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// on-disk records of current version (SPANVERSION) flat span files.
+// fields are packed exactly as the writers emit them so that a mapped file
+// can be used in place; sizeof() of each must equal the header reclen
+//------------------------------------------------------------------------------
+struct S_pairRecord {
+  unsigned int pos;
+  int lm;
+  char orient;
+  unsigned short len1;
+  unsigned short len2;
+  char q1;
+  char q2;
+  char mm1;
+  char mm2;
+  char constrain;
+  unsigned int ReadGroupCode;
+} __attribute__((packed));
+
+struct S_readRecord {
+  unsigned int pos;
+  unsigned short len;
+  unsigned short anchor;
+  char sense;
+  char q;
+  char mm;
+} __attribute__((packed));
+
+struct S_crossRecord {
+  S_readRecord read[2];
+  unsigned int ReadGroupCode;
+} __attribute__((packed));
+
+struct S_endRecord {
+  S_readRecord read;
+  unsigned int ReadGroupCode;
+} __attribute__((packed));
+
+struct S_multiRecord {
+  S_readRecord read[2];
+  int nmap;
+  int elements;
+  unsigned int ReadGroupCode;
+} __attribute__((packed));
+
+//------------------------------------------------------------------------------
+// read-only memory map of a whole file
+//------------------------------------------------------------------------------
+class C_mappedFile {
+  public:
+    C_mappedFile(const string &);
+    ~C_mappedFile();
+    const char * data;
+    size_t size;
+    bool ok;
+  private:
+    C_mappedFile(const C_mappedFile &);             // not copyable
+    C_mappedFile&operator=(const C_mappedFile &);
+    void * base;
+};
+
+//------------------------------------------------------------------------------
+// typed view of the records of a mapped flat span file.
+// ok is false for legacy versions, block-indexed files or a reclen that does
+// not match T - those go through the stream loaders
+//------------------------------------------------------------------------------
+template <class T> class C_spanRecords {
+  public:
+    C_spanRecords(const string & filename) : file(filename) {
+      rec=0;
+      n=0;
+      ok=false;
+      if (!file.ok) return;
+      C_spanInput input(filename.c_str(), ios::in | ios::binary);
+      if (!input) return;
+      h = C_headerSpan(input);
+      size_t offset = input.tellg();
+      input.close();
+      if ((h.V!=SPANVERSION)||(h.reclen!=sizeof(T))) return;
+      if ((offset+size_t(h.N)*sizeof(T))>file.size) {
+        cerr << "truncated span file: " << filename << endl;
+        return;
+      }
+      rec = reinterpret_cast<const T *>(file.data+offset);
+      n = h.N;
+      ok = true;
+    }
+    const T & operator[](size_t i) const { return rec[i]; }
+    const T * begin() const { return rec; }
+    const T * end() const { return rec+n; }
+    size_t size() const { return n; }
+    C_headerSpan h;
+    bool ok;
+  private:
+    C_mappedFile file;
+    const T * rec;
+    size_t n;
+};
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ *  maskSpan.cpp
+ *  Spanner
+ *
+ *  compact base mask (bitset with rank/select) and interval encoded mask files
+ *
+ */
+
+#include "maskSpan.h"
+
+static inline int popcount64(unsigned long long x) {
+  return __builtin_popcountll(x);
+}
+
+C_mask::C_mask() {
+  L=0;
+}
+
+C_mask::C_mask(int L1) {
+  L = (L1>0? L1: 0);
+  w.assign((size_t(L)+63)/64, 0);
+  index();
+}
+
+C_mask::C_mask(const vector<float> & x) {
+  L = x.size();
+  w.assign((size_t(L)+63)/64, 0);
+  for (int i=0; i<L; i++) {
+    if (x[i]>0) w[i>>6] |= 1ULL<<(i&63);
+  }
+  index();
+}
+
+void C_mask::set(int i) {
+  if ((i<0)||(i>=L)) return;
+  w[i>>6] |= 1ULL<<(i&63);
+}
+
+bool C_mask::test(int i) const {
+  if ((i<0)||(i>=L)) return false;
+  return (w[i>>6]>>(i&63))&1ULL;
+}
+
+void C_mask::index() {
+  r.resize(w.size()+1);
+  unsigned int n=0;
+  for (size_t k=0; k<w.size(); k++) {
+    r[k]=n;
+    n+=popcount64(w[k]);
+  }
+  r[w.size()]=n;
+  // word holding clear bit k*SELECTSAMPLE+1 for each k
+  z.clear();
+  long long next0=1;
+  for (size_t k=0; k<w.size(); k++) {
+    long long zeros = 64*(long long)(k+1)-r[k+1];
+    while (next0<=zeros) {
+      z.push_back(k);
+      next0+=SELECTSAMPLE;
+    }
+  }
+}
+
+int C_mask::size() const {
+  return L;
+}
+
+int C_mask::count() const {
+  return (r.size()>0? int(r.back()): 0);
+}
+
+int C_mask::rank(int p) const {
+  if (p<=0) return 0;
+  if (p>=L) return count();
+  int k = p>>6;
+  int b = p&63;
+  int n = r[k];
+  if (b>0) n+=popcount64(w[k]&((1ULL<<b)-1));
+  return n;
+}
+
+int C_mask::count(int p0, int p1) const {
+  if (p1<p0) return 0;
+  return rank(p1+1)-rank(p0);
+}
+
+// position of the k-th clear bit of x (k>=1, k<=64-popcount(x))
+static inline int select0word(unsigned long long x, int k) {
+  x=~x;
+  int b=0;
+  int c;
+  while ((c=popcount64(x&0xFFULL))<k) {
+    k-=c;
+    x>>=8;
+    b+=8;
+  }
+  while (true) {
+    if (x&1ULL) {
+      k--;
+      if (k==0) return b;
+    }
+    x>>=1;
+    b++;
+  }
+}
+
+// bases beyond the end of the mask count as clear
+int C_mask::select0(int k) const {
+  if (k<1) return -1;
+  int zeros = L-count();
+  if (k>zeros) return L+(k-zeros)-1;
+  // last word with fewer than k clear bits before it, between the samples
+  int j = (k-1)/SELECTSAMPLE;
+  int lo = z[j];
+  int hi = (j+1<int(z.size())? int(z[j+1]): int(w.size())-1);
+  while (lo<hi) {
+    int m = (lo+hi+1)/2;
+    if (64*m-int(r[m])<k) lo=m;
+    else hi=m-1;
+  }
+  return 64*lo+select0word(w[lo], k-(64*lo-int(r[lo])));
+}
+
+int C_mask::next(int p) const {
+  if (p<0) p=0;
+  if (p>=L) return -1;
+  int k = p>>6;
+  unsigned long long x = w[k]&(~0ULL<<(p&63));
+  while (true) {
+    if (x!=0) {
+      int i = 64*k+__builtin_ctzll(x);
+      return (i<L? i: -1);
+    }
+    k++;
+    if (k>=int(w.size())) return -1;
+    x = w[k];
+  }
+}
+
+int C_mask::prev(int p) const {
+  if (p<0) return -1;
+  if (p>=L) p=L-1;
+  int k = p>>6;
+  int b = p&63;
+  unsigned long long x = (b==63? w[k]: w[k]&((1ULL<<(b+1))-1));
+  while (true) {
+    if (x!=0) return 64*k+63-__builtin_clzll(x);
+    k--;
+    if (k<0) return -1;
+    x = w[k];
+  }
+}
+
+void C_mask::runs(vector<int> & s, vector<int> & n) const {
+  s.clear();
+  n.clear();
+  int i = next(0);
+  while (i>=0) {
+    int j=i;
+    while ((j+1<L)&&test(j+1)) j++;
+    s.push_back(i);
+    n.push_back(j-i+1);
+    i = next(j+1);
+  }
+}
+
+void C_mask::fromRuns(int L1, const vector<int> & s, const vector<int> & n) {
+  *this = C_mask(L1);
+  for (int k=0; k<int(s.size()); k++) {
+    for (int i=s[k]; i<s[k]+n[k]; i++) set(i);
+  }
+  index();
+}
+
+ostream &operator<<(ostream &output, const C_mask & m)
+{
+  output << "mask length:\t " << m.size() << "\t set:\t " << m.count() << endl;
+  return output;
+}
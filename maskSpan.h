@@ -0,0 +1,53 @@
+/*
+ *  maskSpan.h
+ *  Spanner
+ *
+ *  compact base mask (bitset with rank/select) and interval encoded mask files
+ *
+ */
+#ifndef MASKSPAN_H
+#define MASKSPAN_H
+
+#include <iostream>
+#include <ostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// clear bases between select0 samples
+const int SELECTSAMPLE=4096;
+
+//------------------------------------------------------------------------------
+// one bit per base. After set() calls index() must be called before the
+// rank/select queries. select0 starts from a sampled word directory, so it
+// searches a few words rather than the whole contig. On disk a mask is a 
+// list of set runs (start,length), see C_contig::writeMask
+//------------------------------------------------------------------------------
+class C_mask {
+  friend ostream &operator<<(ostream &, const C_mask &);
+  public:
+    C_mask();
+    C_mask(int);                             // length, all bases clear
+    C_mask(const vector<float> &);           // mark bases with value > 0
+    void set(int);
+    bool test(int) const;
+    void index();                            // build rank table
+    int size() const;                        // number of bases
+    int count() const;                       // number of set bases
+    int count(int, int) const;               // set bases in [p0,p1]
+    int rank(int) const;                     // set bases in [0,p)
+    int select0(int) const;                  // position of k-th clear base (k>=1)
+    int next(int) const;                     // first set base >= p or -1
+    int prev(int) const;                     // last set base <= p or -1
+    void runs(vector<int> &, vector<int> &) const;   // set run starts & lengths
+    void fromRuns(int, const vector<int> &, const vector<int> &);
+  private:
+    int L;
+    vector<unsigned long long> w;            // bits
+    vector<unsigned int> r;                  // set bits before each word
+    vector<unsigned int> z;                  // word of every SELECTSAMPLE-th clear bit
+};
+
+#endif
@@ -0,0 +1,598 @@
+/*
+ *  mergeSpan.cpp
+ *  Spanner
+ *
+ *  k-way merge of the span files of several lanes/runs into one set
+ *
+ */
+
+#include <queue>
+#include "mergeSpan.h"
+#include "packSpan.h"
+
+static bool endsWith(const string & s, const string & e)
+{
+  return ((s.size()>=e.size())&&(s.compare(s.size()-e.size(), e.size(), e)==0));
+}
+
+//------------------------------------------------------------------------------
+// flat records and block columns <-> record objects
+//------------------------------------------------------------------------------
+static void fromRecord(const S_readRecord & r, C_readmap & x)
+{
+  x.pos = r.pos;
+  x.len = r.len;
+  x.anchor = r.anchor;
+  x.sense = r.sense;
+  x.q = r.q;
+  x.mm = r.mm;
+}
+
+static void toRecord(const C_readmap & x, S_readRecord & r)
+{
+  r.pos = x.pos;
+  r.len = x.len;
+  r.anchor = x.anchor;
+  r.sense = x.sense;
+  r.q = x.q;
+  r.mm = x.mm;
+}
+
+static void fromColumns(const C_spanColumns & c, int c0, int j, C_readmap & x)
+{
+  x.pos = c.get<unsigned int>(c0,j);
+  x.len = c.get<unsigned short>(c0+1,j);
+  x.anchor = c.get<unsigned short>(c0+2,j);
+  x.sense = c.get<char>(c0+3,j);
+  x.q = c.get<char>(c0+4,j);
+  x.mm = c.get<char>(c0+5,j);
+}
+
+static void fromRecord(const S_pairRecord & r, C_localpair & x)
+{
+  x = C_localpair(r.pos,r.lm,0,r.len1,r.len2,r.orient,r.q1,r.q2,r.mm1,r.mm2,
+                  r.constrain,r.ReadGroupCode);
+}
+
+static void fromColumns(const C_spanColumns & c, int j, C_localpair & x)
+{
+  x.pos = c.get<unsigned int>(0,j);
+  x.lm = c.get<int>(1,j);
+  x.orient = c.get<char>(2,j);
+  x.len1 = c.get<unsigned short>(3,j);
+  x.len2 = c.get<unsigned short>(4,j);
+  x.q1 = c.get<char>(5,j);
+  x.q2 = c.get<char>(6,j);
+  x.mm1 = c.get<char>(7,j);
+  x.mm2 = c.get<char>(8,j);
+  x.constrain = c.get<char>(9,j);
+  x.ReadGroupCode = c.get<unsigned int>(10,j);
+}
+
+static void toRecord(const C_localpair & x, S_pairRecord & r)
+{
+  r.pos = x.pos;
+  r.lm = x.lm;
+  r.orient = x.orient;
+  r.len1 = x.len1;
+  r.len2 = x.len2;
+  r.q1 = x.q1;
+  r.q2 = x.q2;
+  r.mm1 = x.mm1;
+  r.mm2 = x.mm2;
+  r.constrain = x.constrain;
+  r.ReadGroupCode = x.ReadGroupCode;
+}
+
+static void fromRecord(const S_crossRecord & r, C_crosspair & x)
+{
+  for (int e=0; e<2; e++) fromRecord(r.read[e], x.read[e]);
+  x.ReadGroupCode = r.ReadGroupCode;
+}
+
+static void fromColumns(const C_spanColumns & c, int j, C_crosspair & x)
+{
+  for (int e=0; e<2; e++) fromColumns(c, 6*e, j, x.read[e]);
+  x.ReadGroupCode = c.get<unsigned int>(12,j);
+}
+
+static void toRecord(const C_crosspair & x, S_crossRecord & r)
+{
+  for (int e=0; e<2; e++) toRecord(x.read[e], r.read[e]);
+  r.ReadGroupCode = x.ReadGroupCode;
+}
+
+static void fromRecord(const S_endRecord & r, C_singleEnd & x)
+{
+  fromRecord(r.read, x);
+  x.ReadGroupCode = r.ReadGroupCode;
+}
+
+static void fromColumns(const C_spanColumns & c, int j, C_singleEnd & x)
+{
+  fromColumns(c, 0, j, x);
+  x.ReadGroupCode = c.get<unsigned int>(6,j);
+}
+
+static void toRecord(const C_singleEnd & x, S_endRecord & r)
+{
+  toRecord(x, r.read);
+  r.ReadGroupCode = x.ReadGroupCode;
+}
+
+static void fromRecord(const S_multiRecord & r, C_umpair & x)
+{
+  for (int e=0; e<2; e++) fromRecord(r.read[e], x.read[e]);
+  x.nmap = r.nmap;
+  x.elements = r.elements;
+  x.ReadGroupCode = r.ReadGroupCode;
+}
+
+static void fromColumns(const C_spanColumns & c, int j, C_umpair & x)
+{
+  for (int e=0; e<2; e++) fromColumns(c, 6*e, j, x.read[e]);
+  x.nmap = c.get<int>(12,j);
+  x.elements = c.get<int>(13,j);
+  x.ReadGroupCode = c.get<unsigned int>(14,j);
+}
+
+static void toRecord(const C_umpair & x, S_multiRecord & r)
+{
+  for (int e=0; e<2; e++) toRecord(x.read[e], r.read[e]);
+  r.nmap = x.nmap;
+  r.elements = x.elements;
+  r.ReadGroupCode = x.ReadGroupCode;
+}
+
+//------------------------------------------------------------------------------
+// records of one lane file in file order: mapped flat records, or one
+// decompressed block at a time
+//------------------------------------------------------------------------------
+template <class T, class R> class C_mergeCursor {
+  public:
+    C_mergeCursor(const string & fn, int ncol) : cols(ncol) {
+      filename=fn;
+      ok=false;
+      flat=0;
+      blocks=0;
+      i=0;
+      ib=-1;
+      j=0;
+      nj=0;
+      input.open(fn.c_str(), ios::in | ios::binary);
+      if (!input) {
+        cerr << "Unable to open span input file: " << fn << endl;
+        return;
+      }
+      C_headerSpan h(input);
+      if (h.blocked()) {
+        blocks = new C_spanBlockReader(input, h.coded());
+        ok = blocks->ok;
+      } else {
+        input.close();
+        flat = new C_spanRecords<R>(fn);
+        ok = flat->ok;
+      }
+      if (!ok) {
+        cerr << "span file version " << h.V << " can not be merged: " << fn << endl;
+      }
+    }
+    ~C_mergeCursor() {
+      delete flat;
+      delete blocks;
+    }
+    bool next() {
+      if (!ok) return false;
+      if (flat!=0) {
+        if (i>=flat->size()) return false;
+        fromRecord((*flat)[i++], x);
+        return true;
+      }
+      while (j>=nj) {
+        ib++;
+        if (ib>=int(blocks->index.block.size())) return false;
+        if (!blocks->readBlock(ib, cols)) {
+          cerr << "bad block " << ib << " in " << filename << endl;
+          ok=false;
+          return false;
+        }
+        j=0;
+        nj=blocks->index.block[ib].count;
+      }
+      fromColumns(cols, j++, x);
+      return true;
+    }
+    T x;                                         // current record
+    string filename;
+    bool ok;
+  private:
+    C_mergeCursor(const C_mergeCursor &);        // not copyable
+    C_mergeCursor&operator=(const C_mergeCursor &);
+    C_spanInput input;
+    C_spanRecords<R> * flat;
+    C_spanBlockReader * blocks;
+    C_spanColumns cols;
+    size_t i;
+    int ib, j, nj;
+};
+
+// heap order: smallest record on top, ties by lane (stable like list::sort)
+template <class T, class R> class C_mergeOrder {
+  public:
+    C_mergeOrder(vector<C_mergeCursor<T,R> *> & c1) : c(c1) {}
+    bool operator()(int a, int b) const {
+      if (c[b]->x < c[a]->x) return true;
+      if (c[a]->x < c[b]->x) return false;
+      return (b<a);
+    }
+    vector<C_mergeCursor<T,R> *> & c;
+};
+
+//------------------------------------------------------------------------------
+// flat output file; record count (and light) go into the header at close
+//------------------------------------------------------------------------------
+class C_mergeOutput {
+  public:
+    C_mergeOutput(const string & fn, const C_headerSpan & h1, const string & type, int reclen) : b(fn, false) {
+      h=h1;
+      h.V=SPANVERSION;
+      h.typeName=type;
+      h.reclen=reclen;
+      h.light=0;
+      h.N=0;
+      n=0;
+      string hb = h.pack();
+      b.append(hb.data(), hb.size());
+    }
+    template <class R> void put(const R & r) {
+      b.put(r);
+      n++;
+    }
+    bool close(long long light) {
+      if (!b.close()) return false;
+      h.N=n;
+      h.light=light;
+      fstream output(b.filename.c_str(), ios::in | ios::out | ios::binary);
+      if (!output) {
+        cerr << "Unable to update span header: " << b.filename << endl;
+        return false;
+      }
+      h.write(output);
+      output.close();
+      return true;
+    }
+    C_spanBuffer b;
+    C_headerSpan h;
+    long long n;
+};
+
+template <class T, class R> class C_mergeSink {
+  public:
+    C_mergeSink(C_mergeOutput & o) : out(o) {}
+    void operator()(const T & x) {
+      R r;
+      toRecord(x, r);
+      out.put(r);
+    }
+    C_mergeOutput & out;
+};
+
+// pairs and cross pairs also go to their aberrant class files (SPANCLS*)
+class C_pairSink {
+  public:
+    C_pairSink(C_mergeOutput & o, C_mergeOutput ** c, C_libraries & l) : out(o), cls(c), libraries(l) {}
+    void operator()(const C_localpair & x) {
+      S_pairRecord r;
+      toRecord(x, r);
+      out.put(r);
+      int k = aberrantPairClass(x, libraries);
+      if (k>=0) cls[k]->put(r);
+    }
+    C_mergeOutput & out;
+    C_mergeOutput ** cls;
+    C_libraries & libraries;
+};
+
+class C_crossSink {
+  public:
+    C_crossSink(C_mergeOutput & o, C_mergeOutput ** c) : out(o), cls(c) {}
+    void operator()(const C_crosspair & x) {
+      S_crossRecord r;
+      toRecord(x, r);
+      out.put(r);
+      int k = aberrantCrossClass(x);
+      if (k>=0) cls[k]->put(r);
+    }
+    C_mergeOutput & out;
+    C_mergeOutput ** cls;
+};
+
+//------------------------------------------------------------------------------
+// k-way merge of sorted lane files into sink; redundant records (as in
+// C_contig::uniquify) are dropped when redundant!=0. Returns records kept
+// or -1 on a read error
+//------------------------------------------------------------------------------
+template <class T, class R, class S>
+static long long mergeRecords(const vector<string> & in, int ncol,
+                              bool (*redundant)(const T &, const T &), S & sink)
+{
+  vector<C_mergeCursor<T,R> *> c;
+  bool good=true;
+  for (int i=0; i<int(in.size()); i++) {
+    c.push_back(new C_mergeCursor<T,R>(in[i], ncol));
+    good = good&&c[i]->ok;
+  }
+  long long n=0;
+  if (good) {
+    C_mergeOrder<T,R> order(c);
+    priority_queue<int, vector<int>, C_mergeOrder<T,R> > q(order);
+    for (int i=0; i<int(c.size()); i++) {
+      if (c[i]->next()) q.push(i);
+    }
+    T last;
+    bool have=false;
+    while (!q.empty()) {
+      int i=q.top();
+      q.pop();
+      if (!(have&&(redundant!=0)&&redundant(last, c[i]->x))) {
+        sink(c[i]->x);
+        last=c[i]->x;
+        have=true;
+        n++;
+      }
+      if (c[i]->next()) q.push(i);
+    }
+    for (int i=0; i<int(c.size()); i++) good = good&&c[i]->ok;
+  }
+  for (int i=0; i<int(c.size()); i++) delete c[i];
+  return (good? n: -1);
+}
+
+//------------------------------------------------------------------------------
+// merge tool
+//------------------------------------------------------------------------------
+C_spanMerge::C_spanMerge(string & in, RunControlParameters & pars1) {
+  pars = pars1;
+  ok=false;
+  string out = pars.getOutputDir();
+  vector<string> dirs;
+  split(dirs, in, ",");
+  for (int i=0; i<int(dirs.size()); i++) {
+    if (dirs[i]==out) {
+      cerr << "merge output area is also an input: " << out << endl;
+      return;
+    }
+    if (!scan(dirs[i])) return;
+  }
+  if (contigs.size()==0) {
+    cerr << "no span files to merge in " << in << endl;
+    return;
+  }
+  // set name from output area (as for directory input)
+  setName = out.substr(out.find_last_of("/")+1);
+  if ((setName.size()==0)||(setName==".")) setName="merged";
+  string prefix = pars.getPrefix();
+  if (prefix.size()>0) { prefix = prefix+".";}
+  area = out+"/"+prefix+setName+".";
+
+  cout << "write merged span output  " << endl;
+  string fname = area+"anchors.txt";
+  anchors.printAnchorInfo(fname);
+  spanfiles.push_back(fname);
+  fname = area+"library.span";
+  cout << "\t " << fname << "\t " << libraries.libmap.size() << endl;
+  libraries.writeLibraryInfo(fname, setName);
+  spanfiles.push_back(fname);
+
+  map<string, vector<string> >::iterator ic;
+  for (ic=contigs.begin(); ic!=contigs.end(); ++ic) {
+    if (!mergeContig(ic->first, ic->second)) return;
+  }
+  //---------------------------------------------------------------------------
+  // single-file container (as C_set::write)
+  //---------------------------------------------------------------------------
+  if (pars.getSpanPack()>0) {
+    fname = area+"span.pack";
+    cout << "\t " << fname << "\t " << spanfiles.size() << endl;
+    if (C_spanPack::write(fname, spanfiles)) {
+      for (int i=0; i<int(spanfiles.size()); i++) {
+        remove(spanfiles[i].c_str());
+      }
+    }
+  }
+  ok=true;
+}
+
+//------------------------------------------------------------------------------
+// lane sets of one directory: "<P>library.span" & "<P>anchors.txt" per set
+// prefix P, and "<P><contig>.pair.span" stubs (plain files or container members)
+//------------------------------------------------------------------------------
+bool C_spanMerge::scan(const string & dir)
+{
+  vector<string> names;
+  DIR * d = opendir(dir.c_str());
+  if (!d) {
+    cerr << "Unable to open merge input directory: " << dir << endl;
+    return false;
+  }
+  struct dirent * e;
+  while ((e = readdir(d)) != NULL) {
+    string f = e->d_name;
+    if (endsWith(f, "span.pack")) {
+      openSpanPack(dir+"/"+f);
+    } else {
+      names.push_back(f);
+    }
+  }
+  closedir(d);
+  vector<string> fp;
+  spanPackFiles(fp, dir);
+  for (int i=0; i<int(fp.size()); i++) {
+    names.push_back(fp[i].substr(fp[i].find_last_of("/")+1));
+  }
+  vector<string> sets;
+  for (int i=0; i<int(names.size()); i++) {
+    if (!endsWith(names[i], "library.span")) continue;
+    string P = names[i].substr(0, names[i].size()-12);
+    sets.push_back(P);
+    string f = dir+"/"+P+"anchors.txt";
+    C_anchorinfo a(f);
+    if ((anchors.L.size()>0)&&(!(anchors == a))) {
+      cerr << "\t mismatched anchors :\t"<< f << endl;
+      return false;
+    }
+    anchors = a;
+    f = dir+"/"+names[i];
+    C_libraries libs1(f);
+    C_librarymap::iterator imap;
+    for(imap=libs1.libmap.begin(); imap != libs1.libmap.end(); ++imap) {
+      if (libraries.libmap.count(imap->first)>0) {
+        cerr << "\t redundant ReadGroupCode:\t"<< imap->first << endl;
+        cerr << "\t from:\t"<< f << endl;
+        return false;
+      }
+      libraries.libmap[imap->first]=imap->second;
+    }
+  }
+  for (int i=0; i<int(names.size()); i++) {
+    if (!endsWith(names[i], ".pair.span")) continue;
+    string stub = names[i].substr(0, names[i].size()-10);
+    // longest set prefix
+    int k=-1;
+    for (int s=0; s<int(sets.size()); s++) {
+      if (stub.compare(0, sets[s].size(), sets[s])!=0) continue;
+      if ((k<0)||(sets[s].size()>sets[k].size())) k=s;
+    }
+    if (k<0) {
+      cerr << "no library.span for " << dir << "/" << stub << endl;
+      continue;
+    }
+    string f = dir+"/"+names[i];
+    C_spanInput input(f.c_str(), ios::in | ios::binary);
+    if (!input) {
+      cerr << "Unable to open input file: " << f << endl;
+      return false;
+    }
+    C_headerSpan h(input);
+    input.close();
+    contigs[h.contigName].push_back(dir+"/"+stub);
+    cout << "\t " << h.contigName << "\t " << f << endl;
+  }
+  return true;
+}
+
+bool C_spanMerge::mergeContig(const string & cn, const vector<string> & stubs)
+{
+  string cn1 = cn;
+  // replace evil character "|" with benign "_"
+  size_t found=cn1.find("|");
+  while (found!=string::npos) {
+    cn1.replace(found,1,"_");
+    found=cn1.find("|");
+  }
+  string basename = area+cn1;
+  C_headerSpan h;
+  h.setName = setName;
+  h.contigName = cn;
+  // lane files of each type; a lane without dangle or multi file is 
+  // skipped for that section only
+  vector<string> in[4];
+  for (int i=0; i<int(stubs.size()); i++) {
+    for (int t=0; t<4; t++) {
+      string f = stubs[i]+h.spanext[t];
+      if (t>1) {
+        C_spanInput input(f.c_str(), ios::in | ios::binary);
+        if (!input) {
+          cerr << "no " << h.spanext[t] << " file for lane " << stubs[i] << " - skipped in merge" << endl;
+          continue;
+        }
+        input.close();
+      }
+      in[t].push_back(f);
+    }
+  }
+  bool dedup = (pars.getDupRemove()>0);
+  vector<C_mergeOutput *> out;
+
+  //---------------------------------------------------------------------------
+  // local pairs & cross pairs with their aberrant classes
+  //---------------------------------------------------------------------------
+  C_mergeOutput * cls[8];
+  for (int c=0; c<8; c++) {
+    cls[c]=0;
+    bool cross = ((c==SPANCLSCROSS5)||(c==SPANCLSCROSS3));
+    if ((c>SPANCLSINVERT3)&&(!cross)) continue;
+    cls[c] = new C_mergeOutput(basename+h.spanextp[c], h, h.spanextp[c],
+                               (cross? sizeof(S_crossRecord): sizeof(S_pairRecord)));
+  }
+  C_mergeOutput * op = new C_mergeOutput(basename+h.spanext[0], h, h.spanext[0], sizeof(S_pairRecord));
+  C_pairSink sp(*op, cls, libraries);
+  long long np = mergeRecords<C_localpair,S_pairRecord>(in[0], 11, (dedup? &C_contig::isRedundantPair: 0), sp);
+  C_mergeOutput * ox = new C_mergeOutput(basename+h.spanext[1], h, h.spanext[1], sizeof(S_crossRecord));
+  C_crossSink sx(*ox, cls);
+  long long nx = mergeRecords<C_crosspair,S_crossRecord>(in[1], 13, (dedup? &C_contig::isRedundantCross: 0), sx);
+  //---------------------------------------------------------------------------
+  // dangling ends & unique-multiple pairs: uniquify at detection decides on
+  // these (variable read length platforms only), so all records are kept
+  //---------------------------------------------------------------------------
+  C_mergeOutput * od = new C_mergeOutput(basename+h.spanext[2], h, h.spanext[2], sizeof(S_endRecord));
+  C_mergeSink<C_singleEnd,S_endRecord> sd(*od);
+  long long nd = mergeRecords<C_singleEnd,S_endRecord>(in[2], 7, 0, sd);
+  C_mergeOutput * om = new C_mergeOutput(basename+h.spanext[3], h, h.spanext[3], sizeof(S_multiRecord));
+  C_mergeSink<C_umpair,S_multiRecord> sm(*om);
+  long long nm = mergeRecords<C_umpair,S_multiRecord>(in[3], 15, 0, sm);
+
+  bool good = (np>=0)&&(nx>=0)&&(nd>=0)&&(nm>=0);
+  long long pkey = aberrantKey(np, &libraries);
+  long long xkey = aberrantKey(nx, 0);
+  C_mergeOutput * o[4] = {op, ox, od, om};
+  for (int t=0; t<4; t++) {
+    cout << "\t " << o[t]->b.filename << "\t " << o[t]->n << endl;
+    good = o[t]->close(0)&&good;
+    spanfiles.push_back(o[t]->b.filename);
+    delete o[t];
+  }
+  for (int c=0; c<8; c++) {
+    if (cls[c]==0) continue;
+    bool cross = ((c==SPANCLSCROSS5)||(c==SPANCLSCROSS3));
+    cout << "\t " << cls[c]->b.filename << "\t " << cls[c]->n << endl;
+    good = cls[c]->close(cross? xkey: pkey)&&good;
+    spanfiles.push_back(cls[c]->b.filename);
+    delete cls[c];
+  }
+
+  //---------------------------------------------------------------------------
+  // repeat mask: union of the lane masks
+  //---------------------------------------------------------------------------
+  vector<int> s, n;
+  int L=0;
+  for (int i=0; i<int(stubs.size()); i++) {
+    string f = stubs[i]+".mask.span";
+    C_spanInput maskin(f.c_str(), ios::in | ios::binary);
+    if (!maskin) continue;
+    maskin.close();
+    C_contig c1;
+    c1.loadMask(f);
+    vector<int> s1, n1;
+    c1.repeatMask.runs(s1, n1);
+    s.insert(s.end(), s1.begin(), s1.end());
+    n.insert(n.end(), n1.begin(), n1.end());
+    L = (c1.repeatMask.size()>L? c1.repeatMask.size(): L);
+  }
+  if (L>0) {
+    C_contig c1;
+    string cn2 = cn;
+    c1.setContigName(cn2);
+    c1.setName = setName;
+    C_mask m1;
+    m1.fromRuns(L, s, n);
+    string fname = basename+".mask.span";
+    cout << "\t " << fname << "\t " << m1.count() << endl;
+    c1.writeMask(fname, m1);
+    spanfiles.push_back(fname);
+  }
+  if (!good) {
+    cerr << "merge failed for contig " << cn << endl;
+  }
+  return good;
+}
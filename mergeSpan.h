@@ -0,0 +1,46 @@
+/*
+ *  mergeSpan.h
+ *  Spanner
+ *
+ *  k-way merge of the span files of several lanes/runs into one set
+ *
+ */
+#ifndef MERGESPAN_H
+#define MERGESPAN_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include "PairedData.h"
+
+using namespace std;
+
+//------------------------------------------------------------------------------
+// "Spanner merge -i dir1,dir2,... -o outdir"
+// each lane's per-contig span files are already sorted, so the records of a
+// contig are merged in one pass over all lanes (one block or mapped record
+// per lane in memory), de-duplicated as C_contig::uniquify does, and written
+// as one flat span set with merged library.span, anchors, aberrant pair
+// classes and the union of the lane repeat masks (.mask.span; repeat depth
+// is not merged). A lane without a dangle or multi file is left out of that
+// section only. Detection then loads the merged directory instead of
+// re-sorting the lanes in memory
+//------------------------------------------------------------------------------
+class C_spanMerge {
+  public:
+    C_spanMerge(string &, RunControlParameters &);   // comma separated input dirs
+    bool ok;
+  private:
+    bool scan(const string &);                       // lane stubs & libraries of a dir
+    bool mergeContig(const string &, const vector<string> &);
+    RunControlParameters pars;
+    string setName;
+    string area;                                     // output dir + prefix + set
+    C_anchorinfo anchors;
+    C_libraries libraries;
+    map<string, vector<string> > contigs;            // contig name -> lane stubs
+    vector<string> spanfiles;
+};
+
+#endif
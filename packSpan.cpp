@@ -0,0 +1,363 @@
+/*
+ *  packSpan.cpp
+ *  Spanner
+ *
+ *  single-file span container per set and the input stream used by the
+ *  span loaders to read plain or packed span files
+ *
+ */
+
+#include <string.h>
+#include <dirent.h>
+#include "packSpan.h"
+#include "mapSpan.h"
+#include "headerSpan.h"
+
+static const char SPANPACKMAGIC[8]={'S','P','A','N','P','A','C','K'};
+
+// adler32 checksum
+static unsigned int adler32(const char * p, size_t n)
+{
+  unsigned int a=1, b=0;
+  const unsigned char * x = reinterpret_cast<const unsigned char *>(p);
+  while (n>0) {
+    size_t k = (n>5552? 5552: n);
+    n-=k;
+    while (k-->0) {
+      a+=*x++;
+      b+=a;
+    }
+    a%=65521;
+    b%=65521;
+  }
+  return (b<<16)|a;
+}
+
+// collapse repeated "/" so that "dir//name" and "dir/name" match
+static string spanPackKey(const string & f)
+{
+  string k;
+  for (size_t i=0; i<f.size(); i++) {
+    if ((f[i]=='/')&&(k.size()>0)&&(k[k.size()-1]=='/')) continue;
+    k+=f[i];
+  }
+  return k;
+}
+
+static void writeString(fstream & output, const string & s)
+{
+  int n = s.size();
+  output.write(reinterpret_cast<const char *>(&n), sizeof(int));
+  output.write(s.c_str(), n);
+}
+
+static bool readString(const char * & p, const char * e, string & s)
+{
+  int n;
+  if (p+sizeof(int)>e) return false;
+  memcpy(&n, p, sizeof(int));
+  p+=sizeof(int);
+  if ((n<0)||(p+n>e)) return false;
+  s.assign(p, n);
+  p+=n;
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// table of contents entry
+//------------------------------------------------------------------------------
+C_spanPackEntry::C_spanPackEntry() {
+  offset=0;
+  length=0;
+  checksum=0;
+}
+
+ostream &operator<<(ostream &output, const C_spanPackEntry & e)
+{
+  output << e.name << "\t " << e.contig << "\t " << e.type << "\t " << e.offset;
+  output << "\t " << e.length << "\t " << e.checksum;
+  return output;
+}
+
+//------------------------------------------------------------------------------
+// container
+//------------------------------------------------------------------------------
+C_spanPack::C_spanPack(const string & fn) {
+  filename=fn;
+  path=fn.substr(0, fn.find_last_of("/")+1);
+  ok=false;
+  file = new C_mappedFile(fn);
+  if (!file->ok) {
+    cerr << "Unable to open span container: " << fn << endl;
+    return;
+  }
+  const char * b = file->data;
+  const char * e = b+file->size;
+  size_t nh = sizeof(SPANPACKMAGIC)+sizeof(int);
+  if ((file->size<nh+sizeof(long long))||(memcmp(b, SPANPACKMAGIC, sizeof(SPANPACKMAGIC))!=0)) {
+    cerr << "not a span container: " << fn << endl;
+    return;
+  }
+  int V;
+  memcpy(&V, b+sizeof(SPANPACKMAGIC), sizeof(int));
+  if (V!=SPANPACKVERSION) {
+    cerr << "span container version "<< V << " doesn't match expected version " << SPANPACKVERSION << endl;
+    return;
+  }
+  long long offset;
+  memcpy(&offset, e-sizeof(long long), sizeof(long long));
+  e-=sizeof(long long);
+  if ((offset<(long long)nh)||(b+offset>e)) {
+    cerr << "bad span container index: " << fn << endl;
+    return;
+  }
+  const char * p = b+offset;
+  int n;
+  if (p+sizeof(int)>e) return;
+  memcpy(&n, p, sizeof(int));
+  p+=sizeof(int);
+  if (n<0) return;
+  toc.resize(n);
+  for (int i=0; i<n; i++) {
+    C_spanPackEntry & t = toc[i];
+    bool good = readString(p, e, t.name)&&readString(p, e, t.contig)&&readString(p, e, t.type);
+    good = good&&(p+2*sizeof(long long)+sizeof(int)<=e);
+    if (!good) {
+      cerr << "bad span container index entry " << i << ": " << fn << endl;
+      toc.clear();
+      return;
+    }
+    memcpy(&t.offset, p, sizeof(long long));
+    p+=sizeof(long long);
+    memcpy(&t.length, p, sizeof(long long));
+    p+=sizeof(long long);
+    memcpy(&t.checksum, p, sizeof(int));
+    p+=sizeof(int);
+    if ((t.offset<(long long)nh)||(t.length<0)||(t.offset+t.length>offset)) {
+      cerr << "bad span container member " << t.name << ": " << fn << endl;
+      toc.clear();
+      return;
+    }
+    member[spanPackKey(path+t.name)]=i;
+  }
+  checked.resize(n,0);
+  ok=true;
+}
+
+C_spanPack::~C_spanPack() {
+  delete file;
+}
+
+bool C_spanPack::write(const string & fn, const vector<string> & files)
+{
+  fstream output(fn.c_str(), ios::out | ios::binary);
+  if (!output) {
+      cerr << "Unable to open span container: " << fn << endl;
+      return false;
+  }
+  output.write(SPANPACKMAGIC, sizeof(SPANPACKMAGIC));
+  output.write(reinterpret_cast<const char *>(&SPANPACKVERSION), sizeof(int));
+  vector<C_spanPackEntry> t(files.size());
+  vector<char> b;
+  for (int i=0; i<int(files.size()); i++) {
+    fstream input(files[i].c_str(), ios::in | ios::binary);
+    if (!input) {
+      cerr << "Unable to open span file for container: " << files[i] << endl;
+      return false;
+    }
+    input.seekg(0, ios::end);
+    long long n = input.tellg();
+    input.seekg(0, ios::beg);
+    b.resize(n);
+    if (n>0) input.read(&b[0], n);
+    if (!input) {
+      cerr << "Unable to read span file for container: " << files[i] << endl;
+      return false;
+    }
+    t[i].name = files[i].substr(files[i].find_last_of("/")+1);
+    size_t k = t[i].name.rfind(".span");
+    if ((k!=string::npos)&&(k+5==t[i].name.size())) {
+      input.seekg(0, ios::beg);
+      C_headerSpan h(input);
+      t[i].contig = h.contigName;
+      t[i].type = h.typeName;
+    } else {
+      k = t[i].name.find_last_of(".");
+      t[i].type = (k==string::npos? "": t[i].name.substr(k));
+    }
+    input.close();
+    t[i].offset = output.tellp();
+    t[i].length = n;
+    t[i].checksum = adler32((n>0? &b[0]: 0), n);
+    if (n>0) output.write(&b[0], n);
+  }
+  long long offset = output.tellp();
+  int n = t.size();
+  output.write(reinterpret_cast<const char *>(&n), sizeof(int));
+  for (int i=0; i<n; i++) {
+    writeString(output, t[i].name);
+    writeString(output, t[i].contig);
+    writeString(output, t[i].type);
+    output.write(reinterpret_cast<const char *>(&t[i].offset), sizeof(long long));
+    output.write(reinterpret_cast<const char *>(&t[i].length), sizeof(long long));
+    output.write(reinterpret_cast<const char *>(&t[i].checksum), sizeof(int));
+  }
+  output.write(reinterpret_cast<const char *>(&offset), sizeof(long long));
+  bool good = bool(output);
+  output.close();
+  if (!good) {
+    cerr << "Unable to write span container: " << fn << endl;
+  }
+  return good;
+}
+
+bool C_spanPack::find(const string & fn, const char * & p, size_t & n)
+{
+  if (!ok) return false;
+  map<string, int>::iterator i = member.find(spanPackKey(fn));
+  if (i==member.end()) return false;
+  C_spanPackEntry & t = toc[i->second];
+  p = file->data+t.offset;
+  n = t.length;
+  if (!checked[i->second]) {
+    if (adler32(p, n)!=t.checksum) {
+      cerr << "checksum mismatch for " << t.name << " in span container " << filename << endl;
+      return false;
+    }
+    checked[i->second]=1;
+  }
+  return true;
+}
+
+ostream &operator<<(ostream &output, const C_spanPack & x)
+{
+  output << "span container:\t " << x.filename << "\t members:\t " << x.toc.size() << endl;
+  for (int i=0; i<int(x.toc.size()); i++) {
+    output << " " << i << "\t " << x.toc[i] << endl;
+  }
+  return output;
+}
+
+//------------------------------------------------------------------------------
+// open containers
+//------------------------------------------------------------------------------
+static vector<C_spanPack *> SpanPacks;
+
+bool openSpanPack(const string & fn)
+{
+  for (int i=0; i<int(SpanPacks.size()); i++) {
+    if (SpanPacks[i]->filename==fn) return true;
+  }
+  C_spanPack * p = new C_spanPack(fn);
+  if (!p->ok) {
+    delete p;
+    return false;
+  }
+  SpanPacks.push_back(p);
+  return true;
+}
+
+int openSpanPacks(const string & dir)
+{
+  int n=0;
+  DIR * d = opendir(dir.c_str());
+  if (!d) return 0;
+  struct dirent * e;
+  string ext = "span.pack";
+  while ((e = readdir(d)) != NULL) {
+    string f = e->d_name;
+    if ((f.size()>=ext.size())&&(f.compare(f.size()-ext.size(), ext.size(), ext)==0)) {
+      if (openSpanPack(dir+"/"+f)) n++;
+    }
+  }
+  closedir(d);
+  return n;
+}
+
+bool findSpanPack(const string & fn, const char * & p, size_t & n)
+{
+  for (int i=0; i<int(SpanPacks.size()); i++) {
+    if (SpanPacks[i]->find(fn, p, n)) return true;
+  }
+  return false;
+}
+
+int spanPackFiles(vector<string> & s, const string & dir)
+{
+  string d = spanPackKey(dir+"/");
+  for (int i=0; i<int(SpanPacks.size()); i++) {
+    if (spanPackKey(SpanPacks[i]->path)!=d) continue;
+    for (int j=0; j<int(SpanPacks[i]->toc.size()); j++) {
+      s.push_back(dir+"/"+SpanPacks[i]->toc[j].name);
+    }
+  }
+  return s.size();
+}
+
+//------------------------------------------------------------------------------
+// memory stream buffer
+//------------------------------------------------------------------------------
+void C_spanMemoryBuf::set(const char * p, size_t n)
+{
+  char * b = const_cast<char *>(p);
+  setg(b, b, b+n);
+}
+
+streambuf::pos_type C_spanMemoryBuf::seekoff(off_type off, ios_base::seekdir dir, ios_base::openmode which)
+{
+  char * p = gptr();
+  if (dir==ios_base::beg) p = eback();
+  if (dir==ios_base::end) p = egptr();
+  if ((off<eback()-p)||(off>egptr()-p)) return pos_type(off_type(-1));
+  p+=off;
+  setg(eback(), p, egptr());
+  return pos_type(off_type(p-eback()));
+}
+
+streambuf::pos_type C_spanMemoryBuf::seekpos(pos_type pos, ios_base::openmode which)
+{
+  return seekoff(off_type(pos), ios_base::beg, which);
+}
+
+//------------------------------------------------------------------------------
+// span input stream
+//------------------------------------------------------------------------------
+C_spanInput::C_spanInput() : istream(0) {
+  packed=false;
+  rdbuf(&fb);
+}
+
+C_spanInput::C_spanInput(const char * fn, ios::openmode mode) : istream(0) {
+  packed=false;
+  rdbuf(&fb);
+  open(fn, mode);
+}
+
+void C_spanInput::open(const char * fn, ios::openmode mode)
+{
+  const char * p;
+  size_t n;
+  if (findSpanPack(fn, p, n)) {
+    mb.set(p, n);
+    rdbuf(&mb);
+    packed=true;
+    return;
+  }
+  packed=false;
+  rdbuf(&fb);
+  if (!fb.open(fn, mode|ios::in)) setstate(ios::failbit);
+}
+
+bool C_spanInput::is_open() const
+{
+  return (packed||fb.is_open());
+}
+
+void C_spanInput::close()
+{
+  if (packed) {
+    packed=false;
+    return;
+  }
+  if (!fb.close()) setstate(ios::failbit);
+}
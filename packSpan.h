@@ -0,0 +1,108 @@
+/*
+ *  packSpan.h
+ *  Spanner
+ *
+ *  single-file span container per set and the input stream used by the
+ *  span loaders to read plain or packed span files
+ *
+ */
+#ifndef PACKSPAN_H
+#define PACKSPAN_H
+
+#include <iostream>
+#include <fstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <map>
+
+using namespace std;
+
+class C_mappedFile;
+
+//------------------------------------------------------------------------------
+// container layout:
+//   char[8] "SPANPACK", int version
+//   member files, byte for byte as written by C_set::write
+//   table of contents          int n + n*C_spanPackEntry
+//   long long                  file offset of table of contents (last 8 bytes)
+// members are found by their original file name, so the loaders open
+// "<dir>/<name>" whether the set was written as single files or as a container
+//------------------------------------------------------------------------------
+const int SPANPACKVERSION=1;
+
+//------------------------------------------------------------------------------
+// table of contents entry
+//------------------------------------------------------------------------------
+class C_spanPackEntry {
+  friend ostream &operator<<(ostream &, const C_spanPackEntry &);
+  public:
+    C_spanPackEntry();
+    string name;                 // original file name (no directory)
+    string contig;               // contig name from span header
+    string type;                 // span type name
+    long long offset;            // offset of member in container
+    long long length;            // member size (bytes)
+    unsigned int checksum;       // adler32 of member bytes
+};
+
+//------------------------------------------------------------------------------
+// read-only container: table of contents is read at open, member bytes stay
+// in the mapped file and are checked once on first access
+//------------------------------------------------------------------------------
+class C_spanPack {
+  friend ostream &operator<<(ostream &, const C_spanPack &);
+  public:
+    C_spanPack(const string &);
+    ~C_spanPack();
+    static bool write(const string &, const vector<string> &);   // container, member files
+    bool find(const string &, const char * &, size_t &);          // member by file name
+    vector<C_spanPackEntry> toc;
+    string filename;
+    string path;                 // directory of container
+    bool ok;
+  private:
+    C_spanPack(const C_spanPack &);          // not copyable
+    C_spanPack&operator=(const C_spanPack &);
+    C_mappedFile * file;
+    map<string, int> member;
+    vector<char> checked;
+};
+
+// open container and make its members visible to C_spanInput / C_mappedFile
+bool openSpanPack(const string &);
+// open every *span.pack container in directory
+int openSpanPacks(const string &);
+// member bytes for a packed "<dir>/<name>" file name
+bool findSpanPack(const string &, const char * &, size_t &);
+// names "<dir>/<name>" of packed files in directory
+int spanPackFiles(vector<string> &, const string &);
+
+//------------------------------------------------------------------------------
+// read-only stream buffer over mapped member bytes
+//------------------------------------------------------------------------------
+class C_spanMemoryBuf : public streambuf {
+  public:
+    void set(const char *, size_t);
+  protected:
+    pos_type seekoff(off_type, ios_base::seekdir, ios_base::openmode);
+    pos_type seekpos(pos_type, ios_base::openmode);
+};
+
+//------------------------------------------------------------------------------
+// input stream for span files: a plain file, or a member of an open container
+//------------------------------------------------------------------------------
+class C_spanInput : public istream {
+  public:
+    C_spanInput();
+    C_spanInput(const char *, ios::openmode);
+    void open(const char *, ios::openmode);
+    bool is_open() const;
+    void close();
+  private:
+    filebuf fb;
+    C_spanMemoryBuf mb;
+    bool packed;
+};
+
+#endif
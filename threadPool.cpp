@@ -0,0 +1,124 @@
+/*
+ *  threadPool.cpp
+ *  Spanner
+ *
+ *  fixed pool of worker threads running indexed task batches
+ *
+ */
+
+#include <unistd.h>
+#include "threadPool.h"
+
+static int ThreadCount=0;
+
+int getThreadCount() {
+  if (ThreadCount>0) return ThreadCount;
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n>0? int(n): 1);
+}
+
+void setThreadCount(int n) {
+  ThreadCount = n;
+}
+
+C_threadPool::C_threadPool(int n) {
+  Nthread = (n>0? n: getThreadCount());
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&start, NULL);
+  pthread_cond_init(&finish, NULL);
+  task=NULL;
+  arg=NULL;
+  Ntask=0;
+  itask=0;
+  ndone=0;
+  generation=0;
+  quit=false;
+  // the calling thread is one of the Nthread
+  for (int i=1; i<Nthread; i++) {
+    pthread_t t;
+    if (pthread_create(&t, NULL, work, this)!=0) {
+      cerr << "Unable to start worker thread " << i << endl;
+      break;
+    }
+    worker.push_back(t);
+  }
+  Nthread = worker.size()+1;
+}
+
+C_threadPool::~C_threadPool() {
+  pthread_mutex_lock(&lock);
+  quit=true;
+  pthread_cond_broadcast(&start);
+  pthread_mutex_unlock(&lock);
+  for (int i=0; i<int(worker.size()); i++) {
+    pthread_join(worker[i], NULL);
+  }
+  pthread_cond_destroy(&finish);
+  pthread_cond_destroy(&start);
+  pthread_mutex_destroy(&lock);
+}
+
+int C_threadPool::size() const {
+  return Nthread;
+}
+
+// hand out next task index of the current batch (lock held)
+bool C_threadPool::next(int & i) {
+  if (itask>=Ntask) return false;
+  i = itask++;
+  return true;
+}
+
+void C_threadPool::run(int n, T_task f, void * a) {
+  if (n<=0) return;
+  if (worker.size()==0) {
+    for (int i=0; i<n; i++) f(a,i);
+    return;
+  }
+  pthread_mutex_lock(&lock);
+  task=f;
+  arg=a;
+  Ntask=n;
+  itask=0;
+  ndone=0;
+  generation++;
+  pthread_cond_broadcast(&start);
+  int i;
+  while (next(i)) {
+    pthread_mutex_unlock(&lock);
+    f(a,i);
+    pthread_mutex_lock(&lock);
+    ndone++;
+  }
+  while (ndone<Ntask) {
+    pthread_cond_wait(&finish, &lock);
+  }
+  task=NULL;
+  pthread_mutex_unlock(&lock);
+}
+
+void * C_threadPool::work(void * p) {
+  C_threadPool * pool = reinterpret_cast<C_threadPool *>(p);
+  int seen=0;
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while ((!pool->quit)&&(pool->generation==seen)) {
+      pthread_cond_wait(&pool->start, &pool->lock);
+    }
+    if (pool->quit) break;
+    seen = pool->generation;
+    int i;
+    while (pool->next(i)) {
+      // task and argument belong to the batch that handed out i
+      T_task f = pool->task;
+      void * a = pool->arg;
+      pthread_mutex_unlock(&pool->lock);
+      f(a,i);
+      pthread_mutex_lock(&pool->lock);
+      pool->ndone++;
+      if (pool->ndone==pool->Ntask) pthread_cond_broadcast(&pool->finish);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
@@ -0,0 +1,54 @@
+/*
+ *  threadPool.h
+ *  Spanner
+ *
+ *  fixed pool of worker threads running indexed task batches
+ *
+ */
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <iostream>
+#include <vector>
+#include <pthread.h>
+
+using namespace std;
+
+// task function: (shared argument, task index)
+typedef void (*T_task)(void *, int);
+
+//------------------------------------------------------------------------------
+// thread pool: run(n, f, arg) calls f(arg,i) for i=0..n-1 on the workers and
+// the calling thread, and returns when all n tasks are done. Tasks are handed
+// out in index order; with one thread everything runs inline
+//------------------------------------------------------------------------------
+class C_threadPool {
+  public:
+    C_threadPool(int);                       // total threads including caller (0=default)
+    ~C_threadPool();
+    void run(int, T_task, void *);
+    int size() const;
+  private:
+    C_threadPool(const C_threadPool &);      // not copyable
+    C_threadPool&operator=(const C_threadPool &);
+    static void * work(void *);
+    bool next(int &);
+    int Nthread;
+    vector<pthread_t> worker;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t finish;
+    T_task task;
+    void * arg;
+    int Ntask;
+    int itask;
+    int ndone;
+    int generation;
+    bool quit;
+};
+
+// default number of threads (command line --threads, else online cores)
+int getThreadCount();
+void setThreadCount(int);
+
+#endif
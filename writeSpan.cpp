@@ -0,0 +1,153 @@
+/*
+ *  writeSpan.cpp
+ *  Spanner
+ *
+ *  buffered span file output and background span writer thread
+ *
+ */
+
+#include <string.h>
+#include "writeSpan.h"
+
+//------------------------------------------------------------------------------
+// staging buffer
+//------------------------------------------------------------------------------
+C_spanBuffer::C_spanBuffer(const string & fn, bool deferred1) {
+  filename=fn;
+  deferred=deferred1;
+  ok=true;
+  if (!deferred) {
+    output.open(filename.c_str(), ios::out | ios::binary);
+    if (!output) {
+      cerr << "Unable to open file: " << filename << endl;
+      ok=false;
+    }
+    b.reserve(SPANWRITEBUFFER);
+  }
+}
+
+C_spanBuffer::~C_spanBuffer() {
+  if (output.is_open()) close();
+}
+
+void C_spanBuffer::append(const void * x, size_t n) {
+  const char * c = reinterpret_cast<const char *>(x);
+  b.insert(b.end(), c, c+n);
+  if ((!deferred)&&(b.size()>=SPANWRITEBUFFER)) flush();
+}
+
+bool C_spanBuffer::flush() {
+  if (!ok) {
+    b.clear();
+    return false;
+  }
+  if (b.size()>0) {
+    output.write(&b[0], b.size());
+    b.clear();
+  }
+  return bool(output);
+}
+
+size_t C_spanBuffer::size() const {
+  return b.size();
+}
+
+bool C_spanBuffer::close() {
+  if (deferred&&(!output.is_open())) {
+    output.open(filename.c_str(), ios::out | ios::binary);
+    if (!output) {
+      cerr << "Unable to open file: " << filename << endl;
+      ok=false;
+    }
+  }
+  // deferred buffers go out in SPANWRITEBUFFER sized writes
+  size_t p0=0;
+  while (ok&&(p0<b.size())) {
+    size_t n = b.size()-p0;
+    if (n>SPANWRITEBUFFER) n=SPANWRITEBUFFER;
+    output.write(&b[p0], n);
+    p0+=n;
+  }
+  b.clear();
+  vector<char>().swap(b);
+  bool good = ok&&bool(output);
+  if (output.is_open()) output.close();
+  if (!good) {
+    cerr << "Unable to write file: " << filename << endl;
+  }
+  return good;
+}
+
+//------------------------------------------------------------------------------
+// background writer thread
+//------------------------------------------------------------------------------
+C_spanWriterThread::C_spanWriterThread() {
+  pthread_mutex_init(&lock, NULL);
+  pthread_cond_init(&changed, NULL);
+  done=false;
+  queued=0;
+  started = (pthread_create(&thread, NULL, run, this)==0);
+  if (!started) {
+    cerr << "Unable to start span writer thread - writing in foreground " << endl;
+  }
+}
+
+C_spanWriterThread::~C_spanWriterThread() {
+  finish();
+  pthread_cond_destroy(&changed);
+  pthread_mutex_destroy(&lock);
+}
+
+void C_spanWriterThread::push(C_spanBuffer * b1) {
+  if (!started) {
+    b1->close();
+    delete b1;
+    return;
+  }
+  // a buffer larger than SPANWRITEQUEUE still goes out, alone
+  size_t n = b1->size();
+  pthread_mutex_lock(&lock);
+  while ((!queue.empty())&&(queued+n>SPANWRITEQUEUE)) {
+    pthread_cond_wait(&changed, &lock);
+  }
+  queue.push_back(b1);
+  queued+=n;
+  pthread_cond_broadcast(&changed);
+  pthread_mutex_unlock(&lock);
+}
+
+void C_spanWriterThread::finish() {
+  if (!started) return;
+  pthread_mutex_lock(&lock);
+  done=true;
+  pthread_cond_broadcast(&changed);
+  pthread_mutex_unlock(&lock);
+  pthread_join(thread, NULL);
+  started=false;
+}
+
+void * C_spanWriterThread::run(void * arg) {
+  C_spanWriterThread * w = reinterpret_cast<C_spanWriterThread *>(arg);
+  while (true) {
+    pthread_mutex_lock(&w->lock);
+    while (w->queue.empty()&&(!w->done)) {
+      pthread_cond_wait(&w->changed, &w->lock);
+    }
+    if (w->queue.empty()) {
+      pthread_mutex_unlock(&w->lock);
+      break;
+    }
+    C_spanBuffer * b1 = w->queue.front();
+    size_t n = b1->size();
+    pthread_mutex_unlock(&w->lock);
+    // I/O outside the lock
+    b1->close();
+    delete b1;
+    pthread_mutex_lock(&w->lock);
+    w->queue.pop_front();
+    w->queued-=n;
+    pthread_cond_broadcast(&w->changed);
+    pthread_mutex_unlock(&w->lock);
+  }
+  return NULL;
+}
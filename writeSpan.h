@@ -0,0 +1,70 @@
+/*
+ *  writeSpan.h
+ *  Spanner
+ *
+ *  buffered span file output and background span writer thread
+ *
+ */
+#ifndef WRITESPAN_H
+#define WRITESPAN_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <pthread.h>
+
+using namespace std;
+
+const size_t SPANWRITEBUFFER=8388608;     // bytes per flush (8 MB)
+const size_t SPANWRITEQUEUE=67108864;      // max bytes queued for the writer thread (64 MB)
+
+//------------------------------------------------------------------------------
+// staging buffer for one output file.
+// streaming buffers flush to the file every SPANWRITEBUFFER bytes,
+// deferred buffers keep all bytes until close() (used by C_spanWriterThread)
+//------------------------------------------------------------------------------
+class C_spanBuffer {
+  public:
+    C_spanBuffer(const string &, bool);      // file name, deferred
+    ~C_spanBuffer();
+    void append(const void *, size_t);
+    template <class T> void put(const T & x) {
+      append(&x, sizeof(T));
+    }
+    bool close();                            // write remaining bytes & close file
+    size_t size() const;                     // bytes held
+    string filename;
+    bool deferred;
+    bool ok;
+  private:
+    C_spanBuffer(const C_spanBuffer &);      // not copyable
+    C_spanBuffer&operator=(const C_spanBuffer &);
+    bool flush();
+    vector<char> b;
+    fstream output;
+};
+
+//------------------------------------------------------------------------------
+// background writer: closes queued deferred buffers in order on its own thread
+// so that serialisation of the next contig overlaps the file I/O of the last
+//------------------------------------------------------------------------------
+class C_spanWriterThread {
+  public:
+    C_spanWriterThread();
+    ~C_spanWriterThread();
+    void push(C_spanBuffer *);               // takes ownership, blocks while queue is over SPANWRITEQUEUE bytes
+    void finish();                           // wait until all queued buffers are written
+  private:
+    static void * run(void *);
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    deque<C_spanBuffer *> queue;
+    size_t queued;                           // bytes held by queued buffers
+    bool started;
+    bool done;
+};
+
+#endif